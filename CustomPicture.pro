@@ -10,33 +10,64 @@ CONFIG += c++17
 
 SOURCES += \
     backend/CameraManager.cpp \
+    backend/CameraProfile.cpp \
     backend/ImageComposer.cpp \
+    backend/LiveVideoItem.cpp \
+    backend/SnapshotWriter.cpp \
     backend/TemplateManager.cpp \
     backend/backenddisk.cpp \
     backend/backendmem.cpp \
+    avatarcompositor.cpp \
+    avatarpreview.cpp \
+    batchfilterengine.cpp \
     bigheadpicturewindow.cpp \
     cmerawindows.cpp \
+    colorlut.cpp \
+    convolutionengine.cpp \
+    edithistory.cpp \
     editablepixmapitem.cpp \
+    filtergraph.cpp \
     imageeditor.cpp \
     main.cpp \
     mainwindow.cpp \
     mainwindow2.cpp \
-    postertemplate.cpp
+    maskcache.cpp \
+    mippyramid.cpp \
+    postertemplate.cpp \
+    previewrenderer.cpp \
+    tiledexporter.cpp \
+    tilescheduler.cpp
 
 HEADERS += \
     backend/CameraManager.h \
+    backend/CameraProfile.h \
     backend/ImageComposer.h \
     backend/LiveImageProvider.h \
+    backend/LiveVideoItem.h \
+    backend/SnapshotWriter.h \
     backend/TemplateManager.h \
     backend/backenddisk.h \
     backend/backendmem.h \
+    avatarcompositor.h \
+    avatarpreview.h \
+    batchfilterengine.h \
     bigheadpicturewindow.h \
     cmerawindows.h \
+    colorlut.h \
+    convolutionengine.h \
+    edithistory.h \
     editablepixmapitem.h \
+    filtergraph.h \
     imageeditor.h \
     mainwindow.h \
     mainwindow2.h \
-    postertemplate.h
+    maskcache.h \
+    mippyramid.h \
+    postertemplate.h \
+    previewrenderer.h \
+    simdsupport.h \
+    tiledexporter.h \
+    tilescheduler.h
 
 FORMS += \
     bigheadpicturewindow.ui \
@@ -69,7 +100,7 @@ contains(QT_DEVICE_TARGET, "RK3568") {
             -lopencv_videoio \
             -lopencv_highgui
 
-    LIBS += -lpthread -ldl -lz
+    LIBS += -lpthread -ldl -lz -ljpeg
 
     message("Cross-build: using RK3568 sysroot OpenCV")
 
@@ -89,7 +120,7 @@ else {
             -lopencv_highgui
 
     # ----  4. 系统辅助库 ----
-    LIBS += -lpthread -ldl -lz
+    LIBS += -lpthread -ldl -lz -ljpeg
 
     message("Local build: using /usr/local OpenCV")
 }
@@ -0,0 +1,187 @@
+#include "avatarcompositor.h"
+#include "imageeditor.h"
+#include "maskcache.h"
+#include "mippyramid.h"
+#include "tilescheduler.h"
+#include <QPainterPath>
+#include <QVector>
+
+namespace {
+
+// x * (256 - w) / 256 + y * w / 256，两个通道一组
+inline QRgb interpolate256(QRgb x, QRgb y, uint w)
+{
+    const uint iw = 256 - w;
+    uint rb = ((x & 0x00ff00ffu) * iw + (y & 0x00ff00ffu) * w) >> 8;
+    uint ag = ((x >> 8) & 0x00ff00ffu) * iw + ((y >> 8) & 0x00ff00ffu) * w;
+    return (rb & 0x00ff00ffu) | (ag & 0xff00ff00u);
+}
+
+inline QRgb over(QRgb src, QRgb dst)
+{
+    return src + MaskCache::multiply(dst, 255 - qAlpha(src));
+}
+
+// 输出坐标 i 对应的源坐标（像素中心对齐），拆成整数部分和 8 位小数权重
+struct Tap {
+    int first;
+    int second;
+    uint weight;
+};
+
+Tap tapFor(int i, qreal scale, qreal offset, int size)
+{
+    const qreal pos = qMax<qreal>(0, offset + (i + 0.5) / scale - 0.5);
+    const int fixed = int(pos * 256);
+    Tap tap;
+    tap.first = qMin(fixed >> 8, size - 1);
+    tap.second = qMin(tap.first + 1, size - 1);
+    tap.weight = uint(fixed & 0xff);
+    return tap;
+}
+
+} // namespace
+
+AvatarCompositor::AvatarCompositor()
+    : m_backgroundColor(Qt::white)
+    , m_ringColor(Qt::white)
+    , m_ringWidth(3)
+{
+    setOutputSize(QSize(400, 400));
+}
+
+void AvatarCompositor::setOutputSize(const QSize &size)
+{
+    m_outputSize = size;
+    const int diameter = qMin(size.width(), size.height()) / 2;
+    m_avatarRect = QRect((size.width() - diameter) / 2, (size.height() - diameter) / 2, diameter, diameter);
+    updateBackground();
+}
+
+void AvatarCompositor::setBackground(const QImage &image)
+{
+    m_backgroundSource = image;
+    updateBackground();
+}
+
+void AvatarCompositor::setBackground(const QColor &color)
+{
+    m_backgroundSource = QImage();
+    m_backgroundColor = color;
+    updateBackground();
+}
+
+void AvatarCompositor::setRing(const QColor &color, qreal width)
+{
+    m_ringColor = color;
+    m_ringWidth = width;
+}
+
+void AvatarCompositor::updateBackground()
+{
+    if (m_outputSize.isEmpty()) {
+        m_background = QImage();
+        return;
+    }
+
+    if (m_backgroundSource.isNull()) {
+        m_background = QImage(m_outputSize, QImage::Format_ARGB32_Premultiplied);
+        m_background.fill(m_backgroundColor);
+        return;
+    }
+
+    QImage scaled = m_backgroundSource;
+    if (scaled.size() != m_outputSize) {
+        scaled = scaled.scaled(m_outputSize, Qt::KeepAspectRatioByExpanding, Qt::SmoothTransformation);
+        scaled = scaled.copy((scaled.width() - m_outputSize.width()) / 2,
+                             (scaled.height() - m_outputSize.height()) / 2,
+                             m_outputSize.width(), m_outputSize.height());
+    }
+    m_background = ImageEditor::toWorkingFormat(scaled);
+}
+
+QImage AvatarCompositor::compose(const QImage &camera) const
+{
+    QImage result = m_background.copy();
+    const QRect area = m_avatarRect.intersected(result.rect());
+    if (camera.isNull() || area.isEmpty()) {
+        return result;
+    }
+
+    // 铺满头像区域的缩放比例；缩小超过一半时先用金字塔对半降采样，双线性只负责最后不到 2 倍
+    QImage source = ImageEditor::toWorkingFormat(camera);
+    qreal scale = qMax(qreal(m_avatarRect.width()) / source.width(),
+                       qreal(m_avatarRect.height()) / source.height());
+    while (scale <= 0.5 && source.width() > 1 && source.height() > 1) {
+        source = MipPyramid::downsample(source);
+        scale = qMax(qreal(m_avatarRect.width()) / source.width(),
+                     qreal(m_avatarRect.height()) / source.height());
+    }
+    const qreal offsetX = (source.width() - m_avatarRect.width() / scale) / 2;
+    const qreal offsetY = (source.height() - m_avatarRect.height() / scale) / 2;
+
+    const QImage mask = MaskCache::ellipse(m_avatarRect.size());
+    QImage ring;
+    if (m_ringWidth > 0) {
+        const qreal width = m_ringWidth;
+        ring = MaskCache::coverage(QStringLiteral("ring:") + QString::number(width), m_avatarRect.size(),
+                                   [width](const QRectF &rect) {
+            QPainterPath path;
+            path.addEllipse(rect);
+            path.addEllipse(rect.adjusted(width, width, -width, -width));
+            return path;
+        });
+    }
+    const QRgb ringColor = qPremultiply(m_ringColor.rgba());
+
+    QVector<Tap> columns(area.width());
+    for (int x = 0; x < area.width(); ++x) {
+        columns[x] = tapFor(area.x() - m_avatarRect.x() + x, scale, offsetX, source.width());
+    }
+    const Tap *columnTaps = columns.constData();
+
+    const uchar *srcBits = source.constBits();
+    const int srcBytesPerLine = source.bytesPerLine();
+    uchar *dstBits = result.bits();
+    const int dstBytesPerLine = result.bytesPerLine();
+    const uchar *maskBits = mask.constBits();
+    const int maskBytesPerLine = mask.bytesPerLine();
+    const uchar *ringBits = ring.isNull() ? nullptr : ring.constBits();
+    const int ringBytesPerLine = ring.bytesPerLine();
+    const int maskLeft = area.x() - m_avatarRect.x();
+    const int width = area.width();
+
+    TileScheduler::forEachStrip(area.height(), dstBytesPerLine, 0, [&](int firstRow, int lastRow) {
+        for (int row = firstRow; row < lastRow; ++row) {
+            const int y = area.y() + row;
+            const int maskY = y - m_avatarRect.y();
+            const Tap tapY = tapFor(maskY, scale, offsetY, source.height());
+            const QRgb *src0 = reinterpret_cast<const QRgb *>(srcBits + tapY.first * srcBytesPerLine);
+            const QRgb *src1 = reinterpret_cast<const QRgb *>(srcBits + tapY.second * srcBytesPerLine);
+            QRgb *dst = reinterpret_cast<QRgb *>(dstBits + y * dstBytesPerLine) + area.x();
+            const uchar *cover = maskBits + maskY * maskBytesPerLine + maskLeft;
+            const uchar *ringCover = ringBits ? ringBits + maskY * ringBytesPerLine + maskLeft : nullptr;
+
+            for (int x = 0; x < width; ++x) {
+                const uint a = cover[x];
+                if (a == 0) {
+                    continue;
+                }
+                const Tap &tapX = columnTaps[x];
+                const QRgb top = interpolate256(src0[tapX.first], src0[tapX.second], tapX.weight);
+                const QRgb bottom = interpolate256(src1[tapX.first], src1[tapX.second], tapX.weight);
+                QRgb pixel = interpolate256(top, bottom, tapY.weight);
+                if (a != 255) {
+                    pixel = MaskCache::multiply(pixel, a);
+                }
+                pixel = over(pixel, dst[x]);
+                if (ringCover && ringCover[x]) {
+                    pixel = over(MaskCache::multiply(ringColor, ringCover[x]), pixel);
+                }
+                dst[x] = pixel;
+            }
+        }
+    });
+
+    return result;
+}
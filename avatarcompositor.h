@@ -0,0 +1,46 @@
+#ifndef AVATARCOMPOSITOR_H
+#define AVATARCOMPOSITOR_H
+
+#include <QImage>
+#include <QColor>
+#include <QRect>
+#include <QSize>
+
+// 大头照合成：背景 + 圆形头像 + 边框圆环
+// 相机图像的缩放（铺满并居中裁剪，双线性）、圆形遮罩和叠加在同一遍逐像素循环里完成，
+// 遮罩和圆环用 MaskCache 里缓存的覆盖率图，边缘抗锯齿。
+// 背景在设置时就缩放到输出尺寸，compose() 只读成员，可以在工作线程里逐帧调用
+class AvatarCompositor
+{
+public:
+    AvatarCompositor();
+
+    // 输出尺寸，改变时头像区域恢复为默认（居中，直径为短边的一半）
+    void setOutputSize(const QSize &size);
+    QSize outputSize() const { return m_outputSize; }
+
+    void setAvatarRect(const QRect &rect) { m_avatarRect = rect; }
+    QRect avatarRect() const { return m_avatarRect; }
+
+    // 背景图按输出尺寸铺满居中裁剪；空图时用纯色
+    void setBackground(const QImage &image);
+    void setBackground(const QColor &color);
+
+    // 圆环画在头像区域内侧，宽度 <= 0 时不画
+    void setRing(const QColor &color, qreal width);
+
+    QImage compose(const QImage &camera) const;
+
+private:
+    void updateBackground();
+
+    QSize m_outputSize;
+    QRect m_avatarRect;
+    QImage m_backgroundSource;
+    QColor m_backgroundColor;
+    QImage m_background;        // 已缩放到输出尺寸的工作格式背景
+    QColor m_ringColor;
+    qreal m_ringWidth;
+};
+
+#endif // AVATARCOMPOSITOR_H
@@ -0,0 +1,197 @@
+#include "avatarpreview.h"
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QVideoSurfaceFormat>
+
+namespace {
+
+const qreal kDefaultMaxFps = 25.0;
+
+inline uchar clampByte(int value)
+{
+    return uchar(value < 0 ? 0 : (value > 255 ? 255 : value));
+}
+
+// BT.601 有限范围 YUV 转 RGB，定点 Q8
+inline QRgb yuvToRgb(int y, int u, int v)
+{
+    const int c = 298 * (y - 16) + 128;
+    const int d = u - 128;
+    const int e = v - 128;
+    return qRgb(clampByte((c + 409 * e) >> 8),
+                clampByte((c - 100 * d - 208 * e) >> 8),
+                clampByte((c + 516 * d) >> 8));
+}
+
+// 打包的 4:2:2（YUYV 或 UYVY），每 4 字节两个像素共用一对色度
+QImage decodePacked422(const uchar *bits, const QSize &size, int bytesPerLine, bool uyvy)
+{
+    QImage image(size, QImage::Format_RGB32);
+    const int y0 = uyvy ? 1 : 0;
+    const int u = uyvy ? 0 : 1;
+    const int y1 = uyvy ? 3 : 2;
+    const int v = uyvy ? 2 : 3;
+    for (int row = 0; row < size.height(); ++row) {
+        const uchar *src = bits + row * bytesPerLine;
+        QRgb *dst = reinterpret_cast<QRgb *>(image.scanLine(row));
+        for (int x = 0; x + 1 < size.width(); x += 2, src += 4) {
+            dst[x] = yuvToRgb(src[y0], src[u], src[v]);
+            dst[x + 1] = yuvToRgb(src[y1], src[u], src[v]);
+        }
+        if (size.width() & 1) {
+            dst[size.width() - 1] = yuvToRgb(src[y0], src[u], src[v]);
+        }
+    }
+    return image;
+}
+
+} // namespace
+
+// 解码一帧并合成，结果带着开始时的版本号排队送回 GUI 线程
+class AvatarFrameTask : public QRunnable
+{
+public:
+    AvatarFrameTask(AvatarPreview *preview, const QByteArray &data, QVideoFrame::PixelFormat format,
+                    const QSize &size, int bytesPerLine, bool bottomToTop,
+                    const AvatarCompositor &compositor, int generation)
+        : preview(preview), data(data), format(format), size(size), bytesPerLine(bytesPerLine)
+        , bottomToTop(bottomToTop), compositor(compositor), generation(generation) {}
+
+    void run() override
+    {
+        const QImage camera = AvatarPreview::decode(data, format, size, bytesPerLine, bottomToTop);
+        if (!camera.isNull() && preview->m_generation.load() == generation) {
+            const QImage result = compositor.compose(camera);
+            QMetaObject::invokeMethod(preview, "deliverFrame", Qt::QueuedConnection,
+                                      Q_ARG(QImage, result), Q_ARG(int, generation));
+        }
+        preview->m_busy.store(false);
+    }
+
+private:
+    AvatarPreview *preview;
+    QByteArray data;
+    QVideoFrame::PixelFormat format;
+    QSize size;
+    int bytesPerLine;
+    bool bottomToTop;
+    AvatarCompositor compositor;
+    int generation;
+};
+
+AvatarPreview::AvatarPreview(QObject *parent)
+    : QAbstractVideoSurface(parent)
+    , m_generation(0)
+    , m_busy(false)
+    , m_dropped(0)
+    , m_lastFrameMs(0)
+    , m_minInterval(0)
+{
+    // 同一时刻只合成一帧，合成内部照常按条带并行
+    m_pool.setMaxThreadCount(1);
+    setMaxFps(kDefaultMaxFps);
+    m_clock.start();
+}
+
+AvatarPreview::~AvatarPreview()
+{
+    m_generation.fetch_add(1);
+    m_pool.waitForDone();
+}
+
+QList<QVideoFrame::PixelFormat> AvatarPreview::supportedPixelFormats(
+    QAbstractVideoBuffer::HandleType type) const
+{
+    if (type != QAbstractVideoBuffer::NoHandle) {
+        return QList<QVideoFrame::PixelFormat>();
+    }
+    return QList<QVideoFrame::PixelFormat>()
+           << QVideoFrame::Format_RGB32
+           << QVideoFrame::Format_ARGB32
+           << QVideoFrame::Format_ARGB32_Premultiplied
+           << QVideoFrame::Format_RGB24
+           << QVideoFrame::Format_RGB565
+           << QVideoFrame::Format_YUYV
+           << QVideoFrame::Format_UYVY
+           << QVideoFrame::Format_Jpeg;
+}
+
+bool AvatarPreview::present(const QVideoFrame &frame)
+{
+    // 上一帧还在合成或没到帧间隔就丢掉这一帧
+    const qint64 now = m_clock.elapsed();
+    if (m_busy.load() || now - m_lastFrameMs < m_minInterval) {
+        m_dropped.fetch_add(1);
+        return true;
+    }
+
+    QVideoFrame mapped(frame);
+    if (!mapped.map(QAbstractVideoBuffer::ReadOnly)) {
+        return false;
+    }
+    const QByteArray data(reinterpret_cast<const char *>(mapped.bits()), mapped.mappedBytes());
+    const int bytesPerLine = mapped.bytesPerLine();
+    mapped.unmap();
+
+    m_lastFrameMs = now;
+    m_busy.store(true);
+    const bool bottomToTop = surfaceFormat().scanLineDirection() == QVideoSurfaceFormat::BottomToTop;
+    m_pool.start(new AvatarFrameTask(this, data, frame.pixelFormat(), frame.size(), bytesPerLine,
+                                     bottomToTop, compositor(), m_generation.load()));
+    return true;
+}
+
+void AvatarPreview::stop()
+{
+    m_generation.fetch_add(1);
+    QAbstractVideoSurface::stop();
+}
+
+void AvatarPreview::setCompositor(const AvatarCompositor &compositor)
+{
+    QMutexLocker locker(&m_mutex);
+    m_compositor = compositor;
+}
+
+AvatarCompositor AvatarPreview::compositor() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_compositor;
+}
+
+void AvatarPreview::setMaxFps(qreal fps)
+{
+    m_minInterval = fps > 0 ? int(1000.0 / fps) : 0;
+}
+
+void AvatarPreview::deliverFrame(const QImage &image, int generation)
+{
+    if (generation == m_generation.load()) {
+        emit frameReady(image);
+    }
+}
+
+QImage AvatarPreview::decode(const QByteArray &data, QVideoFrame::PixelFormat format, const QSize &size,
+                             int bytesPerLine, bool bottomToTop)
+{
+    const uchar *bits = reinterpret_cast<const uchar *>(data.constData());
+    if (size.isEmpty() || (format != QVideoFrame::Format_Jpeg && data.size() < bytesPerLine * size.height())) {
+        return QImage();
+    }
+
+    QImage image;
+    if (format == QVideoFrame::Format_Jpeg) {
+        image = QImage::fromData(data, "JPG");
+    } else if (format == QVideoFrame::Format_YUYV || format == QVideoFrame::Format_UYVY) {
+        image = decodePacked422(bits, size, bytesPerLine, format == QVideoFrame::Format_UYVY);
+    } else {
+        const QImage::Format imageFormat = QVideoFrame::imageFormatFromPixelFormat(format);
+        if (imageFormat == QImage::Format_Invalid) {
+            return QImage();
+        }
+        // data 在任务结束后释放，必须深拷贝
+        image = QImage(bits, size.width(), size.height(), bytesPerLine, imageFormat).copy();
+    }
+
+    return bottomToTop ? image.mirrored(false, true) : image;
+}
@@ -0,0 +1,61 @@
+#ifndef AVATARPREVIEW_H
+#define AVATARPREVIEW_H
+
+#include "avatarcompositor.h"
+#include <QAbstractVideoSurface>
+#include <QElapsedTimer>
+#include <QImage>
+#include <QMutex>
+#include <QThreadPool>
+#include <QVideoFrame>
+#include <atomic>
+
+// 大头照实时预览
+// 作为 QCamera 的取景输出接收每一帧，在后台线程里用 AvatarCompositor 按显示尺寸合成背景和圆形头像，
+// 结果通过 frameReady 信号排队送回 GUI 线程。present() 里只拷一次原始数据，
+// YUV / JPEG 解码和合成都在工作线程做；上一帧还没合成完或没到帧间隔时新帧直接丢弃。
+class AvatarPreview : public QAbstractVideoSurface
+{
+    Q_OBJECT
+
+public:
+    explicit AvatarPreview(QObject *parent = nullptr);
+    ~AvatarPreview();
+
+    QList<QVideoFrame::PixelFormat> supportedPixelFormats(
+        QAbstractVideoBuffer::HandleType type = QAbstractVideoBuffer::NoHandle) const override;
+    bool present(const QVideoFrame &frame) override;
+    void stop() override;
+
+    // 合成参数（输出尺寸即显示尺寸，背景在这里就缩放好）；可随时替换，下一帧生效
+    void setCompositor(const AvatarCompositor &compositor);
+    AvatarCompositor compositor() const;
+
+    void setMaxFps(qreal fps);
+    quint64 framesDropped() const { return m_dropped.load(); }
+
+signals:
+    void frameReady(const QImage &image);
+
+private slots:
+    void deliverFrame(const QImage &image, int generation);
+
+private:
+    friend class AvatarFrameTask;
+
+    static QImage decode(const QByteArray &data, QVideoFrame::PixelFormat format, const QSize &size,
+                         int bytesPerLine, bool bottomToTop);
+
+    mutable QMutex m_mutex;
+    AvatarCompositor m_compositor;
+
+    QThreadPool m_pool;
+    std::atomic<int> m_generation;      // stop() 时加一，之后送回的旧帧丢掉
+    std::atomic<bool> m_busy;
+    std::atomic<quint64> m_dropped;
+    QElapsedTimer m_clock;
+    qint64 m_lastFrameMs;
+    int m_minInterval;
+};
+
+#endif // AVATARPREVIEW_H
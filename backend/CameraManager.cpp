@@ -1,14 +1,214 @@
 #include "CameraManager.h"
+#include <QDebug>
+#include <chrono>
+
+CameraManager::CameraManager(QObject *parent)
+    : QObject(parent)
+{
+    qRegisterMetaType<cv::Mat>("cv::Mat");      // stillCaptured 跨线程排队
+}
+
+CameraManager::~CameraManager() {
+    stop();
+}
 
 bool CameraManager::start() {
-    cap.open(9, cv::CAP_V4L2);
-    cap.set(cv::CAP_PROP_FRAME_WIDTH, 1280);
-    cap.set(cv::CAP_PROP_FRAME_HEIGHT, 720);
-    return cap.isOpened();
+    if (running.load()) return true;
+
+    if (!activeProfile.isValid())
+        activeProfile = CameraProfile::resolve(targets);
+    if (!openDevice()) {
+        /* 存档里的配置打不开（设备换口、被占用）：丢掉存档重新协商一次 */
+        if (!activeProfile.isValid()) return false;
+        CameraProfile::forget(targets);
+        activeProfile = CameraProfile::resolve(targets);
+        if (!openDevice()) return false;
+    }
+
+    /* 按实际协商出的分辨率预分配槽位，之后 read() 直接复用内存；
+       压缩帧每帧长度不同，没法预分配 */
+    const int w = static_cast<int>(cap.get(cv::CAP_PROP_FRAME_WIDTH));
+    const int h = static_cast<int>(cap.get(cv::CAP_PROP_FRAME_HEIGHT));
+    const bool raw = frameMode == RawMjpeg &&
+                     (!activeProfile.isValid() || activeProfile.preview.isMjpeg());
+    for (cv::Mat &slot : frameSlots) {
+        slot.release();
+        if (!raw && w > 0 && h > 0) slot.create(h, w, CV_8UC3);
+    }
+    hasFrame = false;
+
+    startWorker();
+    return true;
 }
 
-cv::Mat CameraManager::capture() {
+bool CameraManager::openDevice() {
+    if (cap.isOpened()) cap.release();
+
+    if (!activeProfile.isValid()) {
+        /* 没有可协商的设备（非 Linux 或驱动不支持枚举）：沿用原来的固定参数 */
+        cap.open(9, cv::CAP_V4L2);
+        if (!cap.isOpened()) return false;
+        CameraMode legacy;
+        legacy.fourcc = cv::VideoWriter::fourcc('M', 'J', 'P', 'G');
+        legacy.width = 1280;
+        legacy.height = 720;
+        applyMode(legacy);
+        return true;
+    }
+
+    cap.open(activeProfile.device.toStdString(), cv::CAP_V4L2);
+    if (!cap.isOpened()) return false;
+    applyMode(activeProfile.preview);
+    return true;
+}
+
+void CameraManager::applyMode(const CameraMode &mode) {
+    /* MJPG 在 RawMjpeg 模式下不让 OpenCV 解码；其它格式必须由 OpenCV 转成 BGR */
+    const bool raw = frameMode == RawMjpeg && mode.isMjpeg();
+    cap.set(cv::CAP_PROP_FOURCC, static_cast<double>(mode.fourcc));
+    cap.set(cv::CAP_PROP_CONVERT_RGB, raw ? 0 : 1);
+    cap.set(cv::CAP_PROP_FRAME_WIDTH, mode.width);
+    cap.set(cv::CAP_PROP_FRAME_HEIGHT, mode.height);
+    if (mode.fps > 0.0) cap.set(cv::CAP_PROP_FPS, mode.fps);
+}
+
+void CameraManager::startWorker() {
+    writeIdx = 0;
+    readIdx = 1;
+    midState.store(2);
+
+    running.store(true);
+    worker = std::thread(&CameraManager::captureLoop, this);
+}
+
+void CameraManager::stopWorker() {
+    running.store(false);
+    if (worker.joinable()) worker.join();
+}
+
+void CameraManager::stop() {
+    stopWorker();
+    stillRequested.store(false);
+    if (cap.isOpened()) cap.release();
+}
+
+double CameraManager::previewFps() const {
+    if (activeProfile.isValid() && activeProfile.preview.fps > 0.0)
+        return activeProfile.preview.fps;
+    return 30.0;
+}
+
+void CameraManager::captureLoop() {
+    while (running.load(std::memory_order_relaxed)) {
+        if (stillRequested.exchange(false, std::memory_order_acq_rel)) {
+            emit stillCaptured(readStill());
+            continue;
+        }
+
+        cv::Mat &buf = frameSlots[writeIdx];
+        if (!cap.read(buf) || buf.empty()) {
+            failedCount.fetch_add(1, std::memory_order_relaxed);
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            continue;
+        }
+        capturedCount.fetch_add(1, std::memory_order_relaxed);
+
+        /* 发布：写好的槽位换到中间，换回来的旧中间槽位留给下一帧写 */
+        int prev = midState.exchange(writeIdx | kFreshBit, std::memory_order_acq_rel);
+        if (prev & kFreshBit)
+            droppedCount.fetch_add(1, std::memory_order_relaxed);
+        writeIdx = prev & kIndexMask;
+    }
+}
+
+bool CameraManager::grabLatest(cv::Mat &frame) {
+    if (!(midState.load(std::memory_order_acquire) & kFreshBit))
+        return false;
+
+    /* 只有采集线程会放入新帧，所以这里换到的一定是最新的一帧 */
+    int prev = midState.exchange(readIdx, std::memory_order_acq_rel);
+    readIdx = prev & kIndexMask;
+    hasFrame = true;
+    frame = frameSlots[readIdx];
+    return true;
+}
+
+void CameraManager::setPreviewScale(int denominator) {
+    previewScale = denominator >= 8 ? 8 : denominator >= 4 ? 4 : denominator >= 2 ? 2
+                 : denominator == 1 ? 1 : 0;
+}
+
+bool CameraManager::isCompressed(const cv::Mat &frame) {
+    /* 驱动/后端不支持 CONVERT_RGB=0 时拿到的仍是 BGR，按普通帧处理 */
+    return frame.rows == 1 && frame.type() == CV_8UC1;
+}
+
+bool CameraManager::grabPreview(cv::Mat &bgr) {
     cv::Mat frame;
-    cap >> frame;
-    return frame;
+    if (!grabLatest(frame)) return false;
+
+    /* 没有显式设置时按预览流和预览目标的比例缩小 */
+    const int scale = previewScale > 0 ? previewScale
+                    : activeProfile.isValid() ? activeProfile.previewScale(targets) : 1;
+    if (isCompressed(frame)) {
+        int flags = scale == 8 ? cv::IMREAD_REDUCED_COLOR_8
+                  : scale == 4 ? cv::IMREAD_REDUCED_COLOR_4
+                  : scale == 2 ? cv::IMREAD_REDUCED_COLOR_2
+                                      : cv::IMREAD_COLOR;
+        cv::imdecode(frame, flags, &bgr);                  // 解进调用方的缓冲
+        return !bgr.empty();
+    }
+
+    if (scale == 1) {
+        bgr = frame;
+    } else {
+        cv::resize(frame, bgr, cv::Size(frame.cols / scale, frame.rows / scale),
+                   0, 0, cv::INTER_AREA);
+    }
+    return true;
+}
+
+cv::Mat CameraManager::captureFullResolution() {
+    /* 预分配的槽位在第一帧发布之前是未初始化的内存 */
+    cv::Mat frame;
+    grabLatest(frame);
+    if (!hasFrame) return cv::Mat();
+    const cv::Mat &latest = frameSlots[readIdx];
+    if (isCompressed(latest))
+        return cv::imdecode(latest, cv::IMREAD_COLOR);
+    return latest.clone();
+}
+
+cv::Mat CameraManager::capture() {
+    return captureFullResolution();
+}
+
+void CameraManager::requestStill() {
+    if (!running.load()) {
+        emit stillCaptured(captureFullResolution());
+        return;
+    }
+    stillRequested.store(true, std::memory_order_release);
+}
+
+cv::Mat CameraManager::readStill() {
+    /* 只在采集线程里调用，设备一直归采集线程，不用停线程。
+       切到拍照模式后头几帧常是旧参数或曝光没稳定，丢掉 */
+    cv::Mat raw, still;
+    if (activeProfile.isValid() && !activeProfile.sharesStream()) {
+        applyMode(activeProfile.still);
+        const int kWarmupFrames = 2;
+        for (int i = 0; i < kWarmupFrames + 3 && still.empty(); ++i) {
+            if (!cap.read(raw) || raw.empty() || i < kWarmupFrames) continue;
+            still = isCompressed(raw) ? cv::imdecode(raw, cv::IMREAD_COLOR) : raw.clone();
+        }
+        applyMode(activeProfile.preview);
+        if (still.empty())
+            qWarning("[camera] still capture at %dx%d failed, using preview frame",
+                     activeProfile.still.width, activeProfile.still.height);
+    }
+
+    if (still.empty() && cap.read(raw) && !raw.empty())
+        still = isCompressed(raw) ? cv::imdecode(raw, cv::IMREAD_COLOR) : raw.clone();
+    return still;
 }
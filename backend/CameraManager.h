@@ -2,12 +2,103 @@
 #define RK3568 1
 #include <QObject>
 #include <opencv2/opencv.hpp>
+#include <array>
+#include <atomic>
+#include <thread>
+
+#include "CameraProfile.h"
+
+/*
+ * 摄像头采集：独立线程以传感器帧率读帧，写入预分配的三槽位缓冲。
+ * 采集线程与消费者之间只通过一个原子变量交换槽位，互不阻塞；
+ * 消费者来不及取走的帧会被新帧覆盖并计入 framesDropped()。
+ * 消费端（grabLatest/capture）只允许在同一个线程里调用。
+ */
 class CameraManager : public QObject {
     Q_OBJECT
 public:
+    /* Decoded : OpenCV 在采集线程里把每帧解成 BGR（原来的行为）
+       RawMjpeg: 请求 MJPG，槽位里只放压缩数据，消费者按需解码——
+                 预览用 libjpeg 的 DCT 缩放只解 1/2、1/4、1/8，拍照时才全分辨率解码 */
+    enum FrameMode { Decoded, RawMjpeg };
+
+    explicit CameraManager(QObject *parent = nullptr);
+    ~CameraManager() override;
+
+    void setFrameMode(FrameMode mode) { frameMode = mode; }      // start() 之前设置
+    FrameMode mode() const { return frameMode; }
+    void setPreviewScale(int denominator);                      // 1/2/4/8，0 = 按配置自动
+
+    /* 设备和模式：不设置时 start() 用 CameraProfile::resolve(targets) 协商（有存档直接用） */
+    void setTargets(const CameraTargets &t) { targets = t; }
+    void setProfile(const CameraProfile &p) { activeProfile = p; }
+    const CameraProfile &profile() const { return activeProfile; }
+    double previewFps() const;                                  // 给消费端定时器用
+
     bool start();
+    void stop();
+
+    /* 非阻塞取最新帧：有新帧返回 true。
+       frame 指向消费者独占的槽位，在下一次 grabLatest()/capture() 之前有效，不要原地修改。
+       RawMjpeg 模式下是 1xN 的压缩数据 */
+    bool grabLatest(cv::Mat &frame);
+
+    /* 取最新帧并解成预览分辨率的 BGR：有新帧返回 true。
+       RawMjpeg 模式解码进调用方的 bgr（尺寸不变时复用内存）；
+       Decoded 且缩放为 1 时 bgr 直接指向槽位，同 grabLatest() 不要原地修改 */
+    bool grabPreview(cv::Mat &bgr);
+
+    /* 最新一帧的全分辨率 BGR 拷贝（不切换模式；没有新帧时用上一帧，一帧都还没发布时为空） */
+    cv::Mat captureFullResolution();
+
+    /* 拍照：不阻塞，结果通过 stillCaptured() 送回。
+       采集线程读下一帧时处理：配置里拍照模式和预览流不同时临时切到拍照模式取一帧再切回来，
+       否则直接用预览流的下一帧；都失败时送回空 Mat。没在采集时立即送回 captureFullResolution() */
+    void requestStill();
+
+    /* 兼容旧接口，同 captureFullResolution() */
     cv::Mat capture();
 
+    quint64 framesCaptured() const { return capturedCount.load(std::memory_order_relaxed); }
+    quint64 framesDropped() const  { return droppedCount.load(std::memory_order_relaxed); }
+    quint64 readFailures() const   { return failedCount.load(std::memory_order_relaxed); }
+
+signals:
+    /* 在采集线程里发出，接收者在 GUI 线程时自动走排队连接 */
+    void stillCaptured(const cv::Mat &frame);
+
 private:
+    void captureLoop();
+    void startWorker();
+    void stopWorker();
+    bool openDevice();
+    void applyMode(const CameraMode &mode);
+    cv::Mat readStill();
+    static bool isCompressed(const cv::Mat &frame);
+
+    FrameMode frameMode = Decoded;
+    int previewScale = 0;
+    CameraTargets targets;
+    CameraProfile activeProfile;
+
+    static constexpr int kSlots = 3;
+    static constexpr int kIndexMask = 0x3;
+    static constexpr int kFreshBit = 0x4;
+
     cv::VideoCapture cap;
+    std::thread worker;
+    std::atomic<bool> running{false};
+    std::atomic<bool> stillRequested{false};
+
+    std::array<cv::Mat, kSlots> frameSlots;
+    int writeIdx = 0;                 // 只归采集线程
+    int readIdx = 1;                  // 只归消费者
+    bool hasFrame = false;            // readIdx 槽位里是否是已发布的帧，只归消费者
+    std::atomic<int> midState{2};     // 中间槽位索引 | kFreshBit(有未取走的新帧)
+
+    std::atomic<quint64> capturedCount{0};
+    std::atomic<quint64> droppedCount{0};
+    std::atomic<quint64> failedCount{0};
 };
+
+Q_DECLARE_METATYPE(cv::Mat)
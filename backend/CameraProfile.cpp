@@ -0,0 +1,340 @@
+#include "CameraProfile.h"
+#include <QDir>
+#include <QRegularExpression>
+#include <QSettings>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+
+#ifdef Q_OS_LINUX
+#include <fcntl.h>
+#include <linux/videodev2.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr quint32 fourccOf(char a, char b, char c, char d) {
+    return quint32(quint8(a)) | (quint32(quint8(b)) << 8) |
+           (quint32(quint8(c)) << 16) | (quint32(quint8(d)) << 24);
+}
+
+const quint32 kMjpg = fourccOf('M', 'J', 'P', 'G');
+const quint32 kYuyv = fourccOf('Y', 'U', 'Y', 'V');
+const quint32 kUyvy = fourccOf('U', 'Y', 'V', 'Y');
+const quint32 kNv12 = fourccOf('N', 'V', '1', '2');
+
+const int kSettingsVersion = 1;
+
+/* OpenCV 能直接转成 BGR 的格式；H264 之类的码流不要 */
+bool isSupportedFormat(quint32 fourcc) {
+    return fourcc == kMjpg || fourcc == kYuyv || fourcc == kUyvy || fourcc == kNv12;
+}
+
+/* 帧率未知（驱动不报间隔）时当作满足 */
+bool meetsFps(const CameraMode &m, double fps) {
+    return m.fps <= 0.0 || m.fps + 0.5 >= fps;
+}
+
+bool meetsSize(const CameraMode &m, int w, int h) {
+    return m.width >= w && m.height >= h;
+}
+
+int scaleFor(const CameraMode &m, int targetW, int targetH) {
+    int scale = 1;
+    while (scale < 8 && m.width / (scale * 2) >= targetW && m.height / (scale * 2) >= targetH)
+        scale *= 2;
+    return scale;
+}
+
+/* 每帧预览的大致 CPU 开销（按像素计）：
+   MJPEG 熵解码总要过一遍全图，IDCT 和转色只做缩小后的部分；
+   YUV 要整图转色，比预览大时还得再缩放一次 */
+double previewCost(const CameraMode &m, const CameraTargets &t) {
+    const double px = double(m.pixels());
+    const int scale = scaleFor(m, t.previewWidth, t.previewHeight);
+    if (m.isMjpeg())
+        return px * 0.4 + px / (scale * scale) * 1.2;
+    return px * 1.0 + (scale > 1 ? px * 0.5 : 0.0);
+}
+
+QString encodeMode(const CameraMode &m) {
+    if (!m.isValid()) return QString();
+    return QString("%1 %2x%3@%4").arg(m.fourccString()).arg(m.width).arg(m.height).arg(m.fps);
+}
+
+CameraMode decodeMode(const QString &s) {
+    static const QRegularExpression re("^(\\S{4}) (\\d+)x(\\d+)@([0-9.]+)$");
+    CameraMode m;
+    QRegularExpressionMatch match = re.match(s);
+    if (!match.hasMatch()) return m;
+    const QByteArray cc = match.captured(1).toLatin1();
+    m.fourcc = fourccOf(cc[0], cc[1], cc[2], cc[3]);
+    m.width = match.captured(2).toInt();
+    m.height = match.captured(3).toInt();
+    m.fps = match.captured(4).toDouble();
+    return m;
+}
+
+#ifdef Q_OS_LINUX
+int xioctl(int fd, unsigned long request, void *arg) {
+    int r;
+    do {
+        r = ::ioctl(fd, request, arg);
+    } while (r == -1 && errno == EINTR);
+    return r;
+}
+
+/* 某个 格式+分辨率 下的最高帧率，驱动不支持枚举时返回 0 */
+double maxFps(int fd, quint32 fourcc, int w, int h) {
+    v4l2_frmivalenum ival{};
+    ival.pixel_format = fourcc;
+    ival.width = quint32(w);
+    ival.height = quint32(h);
+    double best = 0.0;
+    for (ival.index = 0; xioctl(fd, VIDIOC_ENUM_FRAMEINTERVALS, &ival) == 0; ++ival.index) {
+        const v4l2_fract &f = ival.type == V4L2_FRMIVAL_TYPE_DISCRETE ? ival.discrete
+                                                                      : ival.stepwise.min;
+        if (f.numerator > 0)
+            best = std::max(best, double(f.denominator) / f.numerator);
+        if (ival.type != V4L2_FRMIVAL_TYPE_DISCRETE) break;
+    }
+    return best;
+}
+#endif
+
+} // namespace
+
+bool CameraMode::isMjpeg() const {
+    return fourcc == kMjpg;
+}
+
+QString CameraMode::fourccString() const {
+    char s[5] = { char(fourcc & 0xff), char((fourcc >> 8) & 0xff),
+                  char((fourcc >> 16) & 0xff), char((fourcc >> 24) & 0xff), 0 };
+    return QString::fromLatin1(s);
+}
+
+int CameraProfile::deviceIndex() const {
+    static const QRegularExpression re("video(\\d+)$");
+    QRegularExpressionMatch match = re.match(device);
+    return match.hasMatch() ? match.captured(1).toInt() : -1;
+}
+
+int CameraProfile::previewScale(const CameraTargets &targets) const {
+    return scaleFor(preview, targets.previewWidth, targets.previewHeight);
+}
+
+QString CameraProfile::queryCard(const QString &device) {
+#ifdef Q_OS_LINUX
+    int fd = ::open(device.toLocal8Bit().constData(), O_RDWR | O_NONBLOCK);
+    if (fd < 0) return QString();
+
+    v4l2_capability cap{};
+    QString card;
+    if (xioctl(fd, VIDIOC_QUERYCAP, &cap) == 0) {
+        const quint32 caps = (cap.capabilities & V4L2_CAP_DEVICE_CAPS) ? cap.device_caps
+                                                                       : cap.capabilities;
+        /* UVC 的 metadata 节点、编解码 M2M 节点都没有单平面采集能力 */
+        if ((caps & V4L2_CAP_VIDEO_CAPTURE) && (caps & V4L2_CAP_STREAMING))
+            card = QString::fromLatin1(reinterpret_cast<const char *>(cap.card),
+                                      int(qstrnlen(reinterpret_cast<const char *>(cap.card),
+                                                   sizeof(cap.card))));
+    }
+    ::close(fd);
+    return card;
+#else
+    Q_UNUSED(device);
+    return QString();
+#endif
+}
+
+QStringList CameraProfile::captureDevices() {
+    QDir dev("/dev");
+    QStringList nodes = dev.entryList(QStringList() << "video*", QDir::System | QDir::Files);
+    std::sort(nodes.begin(), nodes.end(), [](const QString &a, const QString &b) {
+        return a.mid(5).toInt() < b.mid(5).toInt();
+    });
+
+    QStringList result;
+    for (const QString &n : nodes) {
+        const QString path = dev.filePath(n);
+        if (!queryCard(path).isEmpty()) result << path;
+    }
+    return result;
+}
+
+QVector<CameraMode> CameraProfile::enumerateModes(const QString &device) {
+    QVector<CameraMode> modes;
+#ifdef Q_OS_LINUX
+    int fd = ::open(device.toLocal8Bit().constData(), O_RDWR | O_NONBLOCK);
+    if (fd < 0) return modes;
+
+    v4l2_fmtdesc fmt{};
+    fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    for (fmt.index = 0; xioctl(fd, VIDIOC_ENUM_FMT, &fmt) == 0; ++fmt.index) {
+        if (!isSupportedFormat(fmt.pixelformat)) continue;
+
+        v4l2_frmsizeenum size{};
+        size.pixel_format = fmt.pixelformat;
+        for (size.index = 0; xioctl(fd, VIDIOC_ENUM_FRAMESIZES, &size) == 0; ++size.index) {
+            if (size.type == V4L2_FRMSIZE_TYPE_DISCRETE) {
+                CameraMode m;
+                m.fourcc = fmt.pixelformat;
+                m.width = int(size.discrete.width);
+                m.height = int(size.discrete.height);
+                m.fps = maxFps(fd, m.fourcc, m.width, m.height);
+                modes.append(m);
+                continue;
+            }
+
+            /* 连续/步进尺寸：取几个常用分辨率和最大值 */
+            const v4l2_frmsize_stepwise &sw = size.stepwise;
+            static const int common[][2] = { {320, 240}, {640, 480}, {1280, 720},
+                                             {1920, 1080}, {2592, 1944} };
+            QVector<QPair<int, int>> sizes;
+            for (const auto &c : common) sizes.append(qMakePair(c[0], c[1]));
+            sizes.append(qMakePair(int(sw.max_width), int(sw.max_height)));
+            for (const auto &s : sizes) {
+                const quint32 w = quint32(s.first), h = quint32(s.second);
+                if (w < sw.min_width || w > sw.max_width || h < sw.min_height || h > sw.max_height)
+                    continue;
+                if (sw.step_width > 1 && (w - sw.min_width) % sw.step_width) continue;
+                if (sw.step_height > 1 && (h - sw.min_height) % sw.step_height) continue;
+                CameraMode m;
+                m.fourcc = fmt.pixelformat;
+                m.width = int(w);
+                m.height = int(h);
+                m.fps = maxFps(fd, m.fourcc, m.width, m.height);
+                modes.append(m);
+            }
+            break;
+        }
+    }
+    ::close(fd);
+#else
+    Q_UNUSED(device);
+#endif
+    return modes;
+}
+
+CameraProfile CameraProfile::negotiate(const QString &device, const CameraTargets &t) {
+    CameraProfile profile;
+    const QVector<CameraMode> modes = enumerateModes(device);
+    if (modes.isEmpty()) return profile;
+
+    /* 预览：够尺寸、够帧率的模式里挑开销最小的，同开销取帧率高的 */
+    const CameraMode *bestPreview = nullptr;
+    for (const CameraMode &m : modes) {
+        if (!meetsSize(m, t.previewWidth, t.previewHeight) || !meetsFps(m, t.previewFps))
+            continue;
+        if (!bestPreview) { bestPreview = &m; continue; }
+        const double c = previewCost(m, t), bc = previewCost(*bestPreview, t);
+        if (c < bc || (c == bc && m.fps > bestPreview->fps)) bestPreview = &m;
+    }
+    /* 没有完全满足的：退而求其次，帧率优先，其次尺寸 */
+    if (!bestPreview) {
+        for (const CameraMode &m : modes) {
+            if (!bestPreview || m.fps > bestPreview->fps ||
+                (m.fps == bestPreview->fps && m.pixels() > bestPreview->pixels()))
+                bestPreview = &m;
+        }
+    }
+
+    /* 拍照：预览模式本身就够清晰就不切换；否则取满足尺寸的最小模式，
+       同尺寸优先 MJPEG（USB 带宽小，高分辨率下帧率也更稳） */
+    const CameraMode *bestStill = nullptr;
+    if (meetsSize(*bestPreview, t.stillWidth, t.stillHeight)) {
+        bestStill = bestPreview;
+    } else {
+        for (const CameraMode &m : modes) {
+            if (!meetsSize(m, t.stillWidth, t.stillHeight) || !meetsFps(m, t.stillFps))
+                continue;
+            if (!bestStill || m.pixels() < bestStill->pixels() ||
+                (m.pixels() == bestStill->pixels() && m.isMjpeg() && !bestStill->isMjpeg()))
+                bestStill = &m;
+        }
+    }
+    if (!bestStill) {
+        for (const CameraMode &m : modes) {
+            if (!bestStill || m.pixels() > bestStill->pixels() ||
+                (m.pixels() == bestStill->pixels() && m.isMjpeg() && !bestStill->isMjpeg()))
+                bestStill = &m;
+        }
+    }
+
+    profile.device = device;
+    profile.card = queryCard(device);
+    profile.preview = *bestPreview;
+    profile.still = *bestStill;
+    return profile;
+}
+
+QString CameraProfile::settingsGroup(const CameraTargets &t) {
+    return QString("camera/%1x%2@%3_%4x%5@%6")
+            .arg(t.previewWidth).arg(t.previewHeight).arg(t.previewFps)
+            .arg(t.stillWidth).arg(t.stillHeight).arg(t.stillFps);
+}
+
+CameraProfile CameraProfile::load(const CameraTargets &targets) {
+    CameraProfile profile;
+    QSettings settings;
+    settings.beginGroup(settingsGroup(targets));
+    if (settings.value("version").toInt() == kSettingsVersion) {
+        profile.device = settings.value("device").toString();
+        profile.card = settings.value("card").toString();
+        profile.preview = decodeMode(settings.value("preview").toString());
+        profile.still = decodeMode(settings.value("still").toString());
+    }
+    settings.endGroup();
+    return profile;
+}
+
+void CameraProfile::save(const CameraProfile &profile, const CameraTargets &targets) {
+    QSettings settings;
+    settings.beginGroup(settingsGroup(targets));
+    settings.setValue("version", kSettingsVersion);
+    settings.setValue("device", profile.device);
+    settings.setValue("card", profile.card);
+    settings.setValue("preview", encodeMode(profile.preview));
+    settings.setValue("still", encodeMode(profile.still));
+    settings.endGroup();
+}
+
+void CameraProfile::forget(const CameraTargets &targets) {
+    QSettings settings;
+    settings.remove(settingsGroup(targets));
+}
+
+CameraProfile CameraProfile::resolve(const CameraTargets &targets, const QString &preferredDevice) {
+    /* 存档里的设备还在、还是同一个摄像头，就直接用 */
+    CameraProfile saved = load(targets);
+    if (saved.isValid() && !saved.card.isEmpty() &&
+        (preferredDevice.isEmpty() || saved.device == preferredDevice) &&
+        queryCard(saved.device) == saved.card) {
+        fprintf(stderr, "[camera] using saved profile %s preview=%s still=%s\n",
+                saved.device.toLocal8Bit().constData(),
+                encodeMode(saved.preview).toLocal8Bit().constData(),
+                encodeMode(saved.still).toLocal8Bit().constData());
+        return saved;
+    }
+
+    QStringList devices = captureDevices();
+    if (!preferredDevice.isEmpty() && devices.removeAll(preferredDevice) > 0)
+        devices.prepend(preferredDevice);
+
+    for (const QString &device : devices) {
+        CameraProfile profile = negotiate(device, targets);
+        if (!profile.isValid()) continue;
+        fprintf(stderr, "[camera] negotiated %s (%s) preview=%s still=%s\n",
+                device.toLocal8Bit().constData(), profile.card.toLocal8Bit().constData(),
+                encodeMode(profile.preview).toLocal8Bit().constData(),
+                encodeMode(profile.still).toLocal8Bit().constData());
+        save(profile, targets);
+        return profile;
+    }
+
+    fprintf(stderr, "[camera] no V4L2 capture device could be negotiated\n");
+    return CameraProfile();
+}
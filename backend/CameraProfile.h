@@ -0,0 +1,68 @@
+#pragma once
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+/*
+ * 摄像头配置协商：用 V4L2 枚举每个采集设备支持的 格式/分辨率/帧率，
+ * 按预览和拍照两个目标挑开销最小的模式，结果存进 QSettings，
+ * 下次启动直接用存下来的配置，不再靠反复 open 试参数。
+ */
+
+/* 一个可用的采集模式（fourcc + 分辨率 + 最高帧率） */
+struct CameraMode {
+    quint32 fourcc = 0;          // V4L2 四字符码，如 'MJPG'、'YUYV'
+    int width = 0;
+    int height = 0;
+    double fps = 0.0;
+
+    bool isValid() const { return fourcc != 0 && width > 0 && height > 0; }
+    bool isMjpeg() const;
+    qint64 pixels() const { return qint64(width) * height; }
+    QString fourccString() const;
+    bool operator==(const CameraMode &o) const {
+        return fourcc == o.fourcc && width == o.width && height == o.height;
+    }
+    bool operator!=(const CameraMode &o) const { return !(*this == o); }
+};
+
+/* 协商目标：预览要流畅，拍照要清晰 */
+struct CameraTargets {
+    int previewWidth = 640;
+    int previewHeight = 480;
+    double previewFps = 25.0;
+    int stillWidth = 1280;
+    int stillHeight = 720;
+    double stillFps = 5.0;       // 拍照只取一帧，帧率够切换后稳定出图即可
+};
+
+struct CameraProfile {
+    QString device;              // /dev/videoN
+    QString card;                // VIDIOC_QUERYCAP 的 card 名，用来识别换了摄像头
+    CameraMode preview;          // 预览流
+    CameraMode still;            // 拍照时用的模式；和 preview 相同表示不用切换
+
+    bool isValid() const { return !device.isEmpty() && preview.isValid(); }
+    bool sharesStream() const { return !still.isValid() || still == preview; }
+    int deviceIndex() const;     // /dev/video9 -> 9，解析失败返回 -1
+
+    /* 预览流比预览目标大多少倍：MJPEG 用 DCT 缩放解码（1/2/4/8） */
+    int previewScale(const CameraTargets &targets) const;
+
+    /* 整套流程：读存档并校验设备还在，否则重新枚举协商并存档。
+       存档按 targets 分开保存；preferredDevice 非空时先试它 */
+    static CameraProfile resolve(const CameraTargets &targets = CameraTargets(),
+                                 const QString &preferredDevice = QString());
+
+    static QStringList captureDevices();                       // 支持视频采集的 /dev/video*
+    static QVector<CameraMode> enumerateModes(const QString &device);
+    static CameraProfile negotiate(const QString &device, const CameraTargets &targets);
+
+    static CameraProfile load(const CameraTargets &targets);
+    static void save(const CameraProfile &profile, const CameraTargets &targets);
+    static void forget(const CameraTargets &targets);          // 清掉存档，下次重新协商
+
+private:
+    static QString queryCard(const QString &device);           // 打不开/不是采集设备返回空
+    static QString settingsGroup(const CameraTargets &targets);
+};
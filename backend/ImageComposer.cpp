@@ -1,79 +1,140 @@
 #include "ImageComposer.h"
 #include "qfileinfo.h"
 
-bool ImageComposer::compose(const cv::Mat& cameraFrame,
-                            const TemplateLayout& layout,
-                            const std::string& outPath)
+cv::Rect ImageComposer::portraitRect(const cv::Mat& cameraFrame)
 {
-
-    QFile file(layout.paperPath);
-    if (!file.open(QIODevice::ReadOnly)) {
-        std::cout << "open failed: "
-                  << file.errorString().toLocal8Bit().data()   // 或 .toStdString()
-                  << std::endl;
-        return {};
-    }
-    if (!file.open(QIODevice::ReadOnly)) return {};
-    QByteArray ba = file.readAll();
-    std::vector<uchar> buf(ba.begin(), ba.end());
-    cv::Mat paper = cv::imdecode(buf, cv::IMREAD_COLOR);
-    if (paper.empty()) return false;
-
     // 简单裁剪人像（居中）
     int w = cameraFrame.cols * 0.6;
     int h = cameraFrame.rows * 0.7;
     int x = (cameraFrame.cols - w) / 2;
     int y = (cameraFrame.rows - h) / 4;
+    return cv::Rect(x, y, w, h);
+}
 
-    cv::Mat portrait = cameraFrame(cv::Rect(x, y, w, h)).clone();
+void ImageComposer::blitPortrait(const cv::Mat& cameraFrame,
+                                 const QRect& photoRect,
+                                 cv::Mat& paper)
+{
+    cv::Mat portrait = cameraFrame(portraitRect(cameraFrame)).clone();
 
     cv::resize(portrait, portrait,
-               cv::Size(layout.photoRect.width(),
-                        layout.photoRect.height()));
+               cv::Size(photoRect.width(),
+                        photoRect.height()));
 
     portrait.copyTo(
-        paper(cv::Rect(layout.photoRect.x(),
-                       layout.photoRect.y(),
+        paper(cv::Rect(photoRect.x(),
+                       photoRect.y(),
                        portrait.cols,
-                       portrait.rows))
-        );
+                       portrait.rows)));
+}
+
+bool ImageComposer::compose(const cv::Mat& cameraFrame,
+                            const TemplateLayout& layout,
+                            const std::string& outPath)
+{
+    cv::Mat paper;
+    if (!compose(cameraFrame, layout, paper)) return false;
 
     return cv::imwrite(outPath, paper,
                        {cv::IMWRITE_JPEG_QUALITY, 95});
 }
+
 bool ImageComposer::compose(const cv::Mat& cameraFrame,
                             const TemplateLayout& layout,
                             cv::Mat& outMat)
 {
-    QFile file(layout.paperPath);
-    if (!file.open(QIODevice::ReadOnly)) {
-        std::cout << "open failed: "
-                  << file.errorString().toLocal8Bit().data()   // 或 .toStdString()
-                  << std::endl;
-        return {};
+    /* 底图走模板缓存，版式仍以调用方传入的为准 */
+    auto assets = TemplateManager::acquire(QFileInfo(layout.paperPath).path());
+    if (!assets) return false;
+
+    outMat = assets->paper.clone();
+    blitPortrait(cameraFrame, layout.photoRect, outMat);
+    return true;
+}
+
+bool ImageComposer::compose(const cv::Mat& cameraFrame,
+                            const TemplateAssets& assets,
+                            cv::Mat& outMat)
+{
+    if (cameraFrame.empty() || assets.paper.empty()) return false;
+
+    outMat = assets.paper.clone();
+    blitPortrait(cameraFrame, assets.layout.photoRect, outMat);
+    return true;
+}
+
+bool ImageComposer::ensureBuffer(cv::Mat& buf, int rows, int cols, int type)
+{
+    if (buf.rows == rows && buf.cols == cols && buf.type() == type)
+        return false;
+
+    /* 先放掉旧引用，保证 create() 真正新分配，不会写进还被 QImage 引用的旧内存 */
+    buf.release();
+    buf.create(rows, cols, type);
+    ++allocations;
+    return true;
+}
+
+void ImageComposer::rewrapCanvas()
+{
+    /* QImage 持有一份 Mat 头的引用，画布换新后旧 QImage 仍然安全 */
+    cv::Mat* keepAlive = new cv::Mat(canvas);
+    liveQImage = QImage(keepAlive->data,
+                        keepAlive->cols,
+                        keepAlive->rows,
+                        static_cast<int>(keepAlive->step),
+                        QImage::Format_RGB888,
+                        [](void* info) { delete static_cast<cv::Mat*>(info); },
+                        keepAlive);
+}
+
+bool ImageComposer::composeLive(const cv::Mat& cameraFrame, const TemplateAssets& assets)
+{
+    if (cameraFrame.empty() || assets.paper.empty()) return false;
+
+    bool relayBackground = paperKey != assets.paper.data
+                           || paperModified != assets.paperModified;
+    if (ensureBuffer(canvas, assets.paper.rows, assets.paper.cols, CV_8UC3)) {
+        rewrapCanvas();
+        relayBackground = true;
+    }
+    if (relayBackground) {
+        /* 静态底图只在这里转色一次，之后人像区域以外的像素不再动 */
+        cv::cvtColor(assets.paper, canvas, cv::COLOR_BGR2RGB);
+        paperKey = assets.paper.data;
+        paperModified = assets.paperModified;
     }
-    if (!file.open(QIODevice::ReadOnly)) return {};
-    QByteArray ba = file.readAll();
-    std::vector<uchar> buf(ba.begin(), ba.end());
-    cv::Mat paper = cv::imdecode(buf, cv::IMREAD_COLOR);
-    if (paper.empty()) return false;
 
-    int w = cameraFrame.cols * 0.6;
-    int h = cameraFrame.rows * 0.7;
-    int x = (cameraFrame.cols - w) / 2;
-    int y = (cameraFrame.rows - h) / 4;
+    const QRect& photoRect = assets.layout.photoRect;
+    cv::Rect dst = cv::Rect(photoRect.x(), photoRect.y(),
+                            photoRect.width(), photoRect.height())
+                   & cv::Rect(0, 0, canvas.cols, canvas.rows);
+    if (dst.empty()) return false;
 
-    cv::Mat portrait = cameraFrame(cv::Rect(x, y, w, h)).clone();
-    cv::resize(portrait, portrait,
-               cv::Size(layout.photoRect.width(),
-                        layout.photoRect.height()));
+    /* 先在较小的裁剪区域上转色，再直接缩放进画布的人像区域 */
+    cv::Rect src = portraitRect(cameraFrame);
+    ensureBuffer(scratch, src.height, src.width, CV_8UC3);
+    cv::cvtColor(cameraFrame(src), scratch, cv::COLOR_BGR2RGB);
 
-    portrait.copyTo(
-        paper(cv::Rect(layout.photoRect.x(),
-                       layout.photoRect.y(),
-                       portrait.cols,
-                       portrait.rows)));
+    cv::Mat dstRoi = canvas(dst);
+    cv::resize(scratch, dstRoi, dstRoi.size());
+
+    lastDirty = relayBackground ? QRect(0, 0, canvas.cols, canvas.rows)
+                                : QRect(dst.x, dst.y, dst.width, dst.height);
+    ++frames;
+    return true;
+}
+
+bool ImageComposer::previewLive(const cv::Mat& cameraFrame)
+{
+    if (cameraFrame.empty()) return false;
+
+    paperKey = nullptr;                                   // 画布被整帧覆盖，下次合成需重铺底图
+    if (ensureBuffer(canvas, cameraFrame.rows, cameraFrame.cols, CV_8UC3))
+        rewrapCanvas();
+    cv::cvtColor(cameraFrame, canvas, cv::COLOR_BGR2RGB);
 
-    outMat = paper;          // 直接返回 mat
+    lastDirty = QRect(0, 0, canvas.cols, canvas.rows);
+    ++frames;
     return true;
 }
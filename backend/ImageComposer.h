@@ -1,4 +1,5 @@
 #pragma once
+#include <QImage>
 #include <opencv2/opencv.hpp>
 
 #include "TemplateManager.h"
@@ -12,4 +13,45 @@ public:
     static bool compose(const cv::Mat& cameraFrame,
                         const TemplateLayout& layout,
                         cv::Mat& outMat);
+
+    /* 使用缓存里已解码的底图，只做裁剪、缩放和贴图 */
+    static bool compose(const cv::Mat& cameraFrame,
+                        const TemplateAssets& assets,
+                        cv::Mat& outMat);
+
+    /* ---- 实时预览用的有状态合成 ----
+       画布和中间缓冲常驻在对象里，尺寸不变时每帧不做堆分配；
+       结果为 RGB888，liveImage() 直接包装画布内存，不拷贝。
+       增量模式：底图只在换模板/画布被占用时转色铺一次，之后每帧只重画人像区域 */
+    bool composeLive(const cv::Mat& cameraFrame, const TemplateAssets& assets);
+    bool previewLive(const cv::Mat& cameraFrame);     // 不套模板，只转色
+
+    QImage liveImage() const { return liveQImage; }
+    const cv::Mat& liveCanvas() const { return canvas; }
+
+    /* 上一次合成实际改动的区域（画布坐标）；整张重铺时为整个画布 */
+    QRect dirtyRect() const { return lastDirty; }
+
+    /* 稳态预览不分配的证据：预热之后 frameCount() 增长而 allocationCount() 不变 */
+    quint64 allocationCount() const { return allocations; }   // 常驻缓冲的(重新)分配次数
+    quint64 frameCount() const { return frames; }
+
+private:
+    static cv::Rect portraitRect(const cv::Mat& cameraFrame);
+    static void blitPortrait(const cv::Mat& cameraFrame,
+                             const QRect& photoRect,
+                             cv::Mat& paper);
+
+    bool ensureBuffer(cv::Mat& buf, int rows, int cols, int type);
+    void rewrapCanvas();
+
+    const uchar* paperKey = nullptr;      // 画布上当前铺着的底图；空表示需要重铺
+    QDateTime paperModified;
+    QRect lastDirty;
+    cv::Mat canvas;                       // 输出画布(RGB)
+    cv::Mat scratch;                      // 人像区域转色后的中间缓冲
+    QImage liveQImage;                    // 包装 canvas 的 QImage，画布重新分配时才重建
+
+    quint64 allocations = 0;
+    quint64 frames = 0;
 };
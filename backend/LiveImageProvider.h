@@ -1,6 +1,9 @@
 #pragma once
 #include <QQuickImageProvider>
 #include <QImage>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QPainter>
 
 class LiveImageProvider : public QQuickImageProvider {
 public:
@@ -10,17 +13,46 @@ public:
     /* 每次 QML 需要刷新时 Qt 会调用它 */
     QImage requestImage(const QString &/*id*/, QSize *size,
                         const QSize &requestedSize) override {
+        QMutexLocker locker(&m_mutex);
         if (m_img.isNull()) return QImage(1,1,QImage::Format_RGB888);
-        QImage img = m_img;
-        if (size) *size = img.size();
-        if (!requestedSize.isEmpty())
-            img = img.scaled(requestedSize, Qt::KeepAspectRatio);
-        return img;
+        if (size) *size = m_img.size();
+        if (requestedSize.isEmpty()) return m_img;
+
+        /* 预览尺寸的缓存图：尺寸没变时只重新缩放累计下来的脏区 */
+        QSize target = m_img.size().scaled(requestedSize, Qt::KeepAspectRatio);
+        if (m_scaled.size() != target || m_pendingDirty == m_img.rect()) {
+            m_scaled = m_img.scaled(target, Qt::IgnoreAspectRatio)
+                           .convertToFormat(QImage::Format_RGB32);   // 可直接用 QPainter 局部重画
+        } else if (!m_pendingDirty.isEmpty()) {
+            qreal sx = qreal(target.width()) / m_img.width();
+            qreal sy = qreal(target.height()) / m_img.height();
+            QRect dst = QRectF(m_pendingDirty.x() * sx, m_pendingDirty.y() * sy,
+                               m_pendingDirty.width() * sx, m_pendingDirty.height() * sy)
+                            .toAlignedRect() & m_scaled.rect();
+            QRectF src(dst.x() / sx, dst.y() / sy, dst.width() / sx, dst.height() / sy);
+
+            QPainter painter(&m_scaled);
+            painter.setCompositionMode(QPainter::CompositionMode_Source);
+            painter.drawImage(dst, m_img, src);
+        }
+        m_pendingDirty = QRect();
+        return m_scaled;
     }
 
-    /* 我们在 Backend 里每合成完一帧就调这个接口更新内存图 */
-    void updateImage(const QImage &newImg) { m_img = newImg; }
+    /* 我们在 Backend 里每合成完一帧就调这个接口更新内存图。
+       dirty 为本帧改动的区域，空表示整张都变了 */
+    void updateImage(const QImage &newImg, const QRect &dirty = QRect()) {
+        QMutexLocker locker(&m_mutex);
+        if (newImg.size() != m_img.size() || dirty.isEmpty())
+            m_pendingDirty = newImg.rect();
+        else
+            m_pendingDirty |= dirty;
+        m_img = newImg;
+    }
 
 private:
+    QMutex m_mutex;
     QImage m_img;
+    QImage m_scaled;          // 按 requestedSize 缩放后的缓存
+    QRect m_pendingDirty;     // 上次被取走之后累计的脏区（原图坐标）
 };
@@ -0,0 +1,135 @@
+#include "LiveVideoItem.h"
+#include <QOpenGLContext>
+#include <QOpenGLFunctions>
+#include <QSGSimpleTextureNode>
+#include <QSGTexture>
+
+/* 常驻 GL 纹理：尺寸不变时只用 glTexSubImage2D 覆盖脏区所在的行 */
+class LiveFrameTexture : public QSGTexture, protected QOpenGLFunctions
+{
+public:
+    ~LiveFrameTexture() override
+    {
+        if (m_id && QOpenGLContext::currentContext())
+            glDeleteTextures(1, &m_id);
+    }
+
+    int textureId() const override { return static_cast<int>(m_id); }
+    QSize textureSize() const override { return m_size; }
+    bool hasAlphaChannel() const override { return false; }
+    bool hasMipmaps() const override { return false; }
+
+    void bind() override
+    {
+        glBindTexture(GL_TEXTURE_2D, m_id);
+        updateBindOptions();
+    }
+
+    /* 必须在渲染线程、GL 上下文为当前时调用（即 updatePaintNode 里） */
+    void upload(const QImage &frame, const QRect &dirty)
+    {
+        if (!m_id) {
+            initializeOpenGLFunctions();
+            glGenTextures(1, &m_id);
+        }
+
+        QImage rgb = frame.format() == QImage::Format_RGB888
+                         ? frame
+                         : frame.convertToFormat(QImage::Format_RGB888);
+        glBindTexture(GL_TEXTURE_2D, m_id);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+        if (rgb.size() != m_size) {
+            m_size = rgb.size();
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, m_size.width(), m_size.height(),
+                         0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+            uploadRows(rgb, 0, m_size.height());
+        } else {
+            QRect rows = dirty & rgb.rect();
+            uploadRows(rgb, rows.top(), rows.bottom() + 1);
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    }
+
+private:
+    /* 传整行区间：GLES2 没有 GL_UNPACK_ROW_LENGTH，整行连续时一次传完 */
+    void uploadRows(const QImage &rgb, int top, int bottom)
+    {
+        if (bottom <= top) return;
+
+        const int width = rgb.width();
+        if (rgb.bytesPerLine() == width * 3) {
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, top, width, bottom - top,
+                            GL_RGB, GL_UNSIGNED_BYTE, rgb.constScanLine(top));
+        } else {
+            for (int y = top; y < bottom; ++y) {
+                glTexSubImage2D(GL_TEXTURE_2D, 0, 0, y, width, 1,
+                                GL_RGB, GL_UNSIGNED_BYTE, rgb.constScanLine(y));
+            }
+        }
+    }
+
+    GLuint m_id = 0;
+    QSize m_size;
+};
+
+LiveVideoItem::LiveVideoItem(QQuickItem *parent)
+    : QQuickItem(parent)
+{
+    setFlag(ItemHasContents, true);
+}
+
+void LiveVideoItem::setSource(QObject *source)
+{
+    if (m_source == source) return;
+
+    if (m_source)
+        disconnect(m_source, nullptr, this, nullptr);
+    m_source = source;
+    if (m_source) {
+        connect(m_source, SIGNAL(frameReady(QImage,QRect)),
+                this, SLOT(setFrame(QImage,QRect)));
+    }
+    emit sourceChanged();
+}
+
+void LiveVideoItem::setFrame(const QImage &frame, const QRect &dirty)
+{
+    if (frame.isNull()) return;
+
+    if (frame.size() != m_frame.size() || dirty.isEmpty())
+        m_pendingDirty = frame.rect();
+    else
+        m_pendingDirty |= dirty;
+    m_frame = frame;
+    update();
+}
+
+QSGNode *LiveVideoItem::updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *)
+{
+    auto *node = static_cast<QSGSimpleTextureNode *>(oldNode);
+    if (m_frame.isNull() || width() <= 0 || height() <= 0) {
+        delete node;
+        return nullptr;
+    }
+
+    if (!node) {
+        node = new QSGSimpleTextureNode;
+        node->setTexture(new LiveFrameTexture);
+        node->setOwnsTexture(true);
+        node->setFiltering(QSGTexture::Linear);
+    }
+
+    auto *texture = static_cast<LiveFrameTexture *>(node->texture());
+    if (!m_pendingDirty.isEmpty()) {
+        texture->upload(m_frame, m_pendingDirty);
+        m_pendingDirty = QRect();
+        node->markDirty(QSGNode::DirtyMaterial);
+    }
+
+    /* 等比居中显示，缩放交给 GPU 采样 */
+    QSizeF fitted = QSizeF(m_frame.size()).scaled(size(), Qt::KeepAspectRatio);
+    node->setRect(QRectF(QPointF((width() - fitted.width()) / 2,
+                                 (height() - fitted.height()) / 2), fitted));
+    return node;
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <QQuickItem>
+#include <QImage>
+#include <QPointer>
+#include <QRect>
+
+class LiveFrameTexture;
+
+/*
+ * 实时预览控件：后端每合成一帧就通过 setFrame() 推给它，
+ * 在渲染线程同步阶段把脏区直接 glTexSubImage2D 到常驻纹理里。
+ * 不经过 QQuickImageProvider，也就没有图片缓存反复失效、按 requestedSize 缩放和整张重传。
+ *
+ * QML: LiveVideoItem { source: backend }，source 需要有 frameReady(QImage,QRect) 信号。
+ */
+class LiveVideoItem : public QQuickItem
+{
+    Q_OBJECT
+    Q_PROPERTY(QObject *source READ source WRITE setSource NOTIFY sourceChanged)
+
+public:
+    explicit LiveVideoItem(QQuickItem *parent = nullptr);
+
+    QObject *source() const { return m_source; }
+    void setSource(QObject *source);
+
+public slots:
+    /* frame 可以直接包装后端的常驻画布（不拷贝）：
+       纹理上传发生在渲染线程同步阶段，那时 GUI 线程是阻塞的 */
+    void setFrame(const QImage &frame, const QRect &dirty);
+
+signals:
+    void sourceChanged();
+
+protected:
+    QSGNode *updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *data) override;
+
+private:
+    QPointer<QObject> m_source;
+    QImage m_frame;
+    QRect m_pendingDirty;        // 上次上传之后累计的脏区，空表示没有新内容
+};
@@ -0,0 +1,76 @@
+#include "SnapshotWriter.h"
+#include <QFileInfo>
+#include <QImageWriter>
+#include <QRunnable>
+#include <QSaveFile>
+
+class SnapshotTask : public QRunnable
+{
+public:
+    SnapshotTask(SnapshotWriter *writer, SnapshotJob &&job)
+        : writer(writer), job(std::move(job)) {}
+
+    void run() override
+    {
+        QSaveFile file(job.path);
+        if (!file.open(QIODevice::WriteOnly)) {
+            writer->finish(job.path, false, file.errorString());
+            return;
+        }
+
+        QImageWriter imageWriter(&file, job.format);
+        imageWriter.setQuality(job.quality);
+        if (!imageWriter.write(job.image)) {
+            file.cancelWriting();
+            writer->finish(job.path, false, imageWriter.errorString());
+            return;
+        }
+
+        /* commit() 才把临时文件改名成目标文件 */
+        if (!file.commit()) {
+            writer->finish(job.path, false, file.errorString());
+            return;
+        }
+
+        job.image = QImage();              // 尽早释放像素
+        writer->finish(job.path, true, QString());
+    }
+
+private:
+    SnapshotWriter *writer;
+    SnapshotJob job;
+};
+
+SnapshotWriter::SnapshotWriter(QObject *parent, int maxThreads)
+    : QObject(parent)
+{
+    pool.setMaxThreadCount(qMax(1, maxThreads));
+}
+
+SnapshotWriter::~SnapshotWriter()
+{
+    /* 等在途任务写完，保证它们发信号时对象还完整 */
+    pool.waitForDone();
+}
+
+void SnapshotWriter::enqueue(SnapshotJob &&job)
+{
+    if (job.image.isNull() || job.path.isEmpty()) {
+        emit saved(job.path, false, QStringLiteral("empty snapshot"));
+        return;
+    }
+    if (job.format.isEmpty()) {
+        /* 写的是 QSaveFile 设备，QImageWriter 猜不到后缀，这里先定下来 */
+        job.format = QFileInfo(job.path).suffix().toUpper().toLatin1();
+        if (job.format.isEmpty()) job.format = "JPG";
+    }
+
+    pending.fetch_add(1);
+    pool.start(new SnapshotTask(this, std::move(job)));
+}
+
+void SnapshotWriter::finish(const QString &path, bool ok, const QString &error)
+{
+    pending.fetch_sub(1);
+    emit saved(path, ok, error);
+}
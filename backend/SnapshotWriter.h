@@ -0,0 +1,53 @@
+#pragma once
+#include <QObject>
+#include <QImage>
+#include <QString>
+#include <QByteArray>
+#include <QThreadPool>
+#include <atomic>
+
+/* 一次落盘任务：只能移动，入队后图像归写盘线程所有。
+   image 必须自己持有像素（包装常驻画布的 QImage 要先 copy()） */
+struct SnapshotJob {
+    QImage image;
+    QString path;
+    QByteArray format;      // "JPG" / "PNG"，为空时按文件后缀
+    int quality = 95;
+
+    SnapshotJob() = default;
+    SnapshotJob(QImage img, QString filePath, QByteArray fmt = QByteArray(), int q = 95)
+        : image(std::move(img)), path(std::move(filePath)), format(std::move(fmt)), quality(q) {}
+
+    SnapshotJob(SnapshotJob &&) = default;
+    SnapshotJob &operator=(SnapshotJob &&) = default;
+    SnapshotJob(const SnapshotJob &) = delete;
+    SnapshotJob &operator=(const SnapshotJob &) = delete;
+};
+
+/*
+ * 后台写盘队列：编码(JPEG/PNG)在独立线程池里做，
+ * 先写临时文件再改名（QSaveFile），写到一半断电也不会留下半张图。
+ * 完成后发 saved()，接收者在 GUI 线程时自动走排队连接。
+ */
+class SnapshotWriter : public QObject
+{
+    Q_OBJECT
+public:
+    explicit SnapshotWriter(QObject *parent = nullptr, int maxThreads = 2);
+    ~SnapshotWriter() override;
+
+    void enqueue(SnapshotJob &&job);
+
+    int pendingCount() const { return pending.load(); }
+    void waitForDone() { pool.waitForDone(); }
+
+signals:
+    void saved(const QString &path, bool ok, const QString &error);
+
+private:
+    friend class SnapshotTask;
+    void finish(const QString &path, bool ok, const QString &error);
+
+    QThreadPool pool;
+    std::atomic<int> pending{0};
+};
@@ -1,7 +1,18 @@
 #include "TemplateManager.h"
 #include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
 #include <QJsonDocument>
 #include <QJsonObject>
+#include <opencv2/imgcodecs.hpp>
+#include <cstdio>
+
+namespace {
+QMutex g_cacheMutex;
+QHash<QString, std::shared_ptr<const TemplateAssets>> g_cache;
+}
 
 TemplateLayout TemplateManager::load(const QString& dir) {
     TemplateLayout layout;
@@ -21,3 +32,62 @@ TemplateLayout TemplateManager::load(const QString& dir) {
         );
     return layout;
 }
+
+std::shared_ptr<const TemplateAssets> TemplateManager::decode(const QString& dir) {
+    auto assets = std::make_shared<TemplateAssets>();
+    assets->dir = dir;
+    assets->layout = load(dir);
+    assets->layoutModified = QFileInfo(dir + "/layout.json").lastModified();
+    assets->paperModified = QFileInfo(assets->layout.paperPath).lastModified();
+
+    /* 资源文件(qrc)只能经 QFile 读，直接在读到的字节上解码，不再拷贝一份 vector */
+    QFile file(assets->layout.paperPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        fprintf(stderr, "[TemplateManager] open failed: %s\n",
+                file.errorString().toLocal8Bit().constData());
+        return nullptr;
+    }
+    QByteArray ba = file.readAll();
+    cv::Mat raw(1, ba.size(), CV_8UC1, ba.data());
+    assets->paper = cv::imdecode(raw, cv::IMREAD_COLOR);
+    if (assets->paper.empty()) return nullptr;
+
+    return assets;
+}
+
+std::shared_ptr<const TemplateAssets> TemplateManager::acquire(const QString& dir) {
+    const QDateTime layoutModified = QFileInfo(dir + "/layout.json").lastModified();
+    const QDateTime paperModified = QFileInfo(dir + "/paper.jpg").lastModified();
+
+    {
+        QMutexLocker locker(&g_cacheMutex);
+        auto it = g_cache.constFind(dir);
+        if (it != g_cache.constEnd()
+            && (*it)->layoutModified == layoutModified
+            && (*it)->paperModified == paperModified) {
+            return *it;
+        }
+    }
+
+    /* 解码放在锁外，避免大图解码期间卡住其他使用者 */
+    auto assets = decode(dir);
+    if (!assets) return nullptr;
+
+    QMutexLocker locker(&g_cacheMutex);
+    g_cache.insert(dir, assets);
+    return assets;
+}
+
+bool TemplateManager::preload(const QString& dir) {
+    return acquire(dir) != nullptr;
+}
+
+void TemplateManager::evict(const QString& dir) {
+    QMutexLocker locker(&g_cacheMutex);
+    g_cache.remove(dir);
+}
+
+void TemplateManager::clearCache() {
+    QMutexLocker locker(&g_cacheMutex);
+    g_cache.clear();
+}
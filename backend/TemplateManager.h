@@ -1,14 +1,36 @@
 #pragma once
 #include <QString>
 #include <QRect>
+#include <QDateTime>
+#include <memory>
+#include <opencv2/core.hpp>
 
 struct TemplateLayout {
     QString paperPath;
     QRect photoRect;
 };
 
+/* 预解码好的模板资源：版式 + 已解码的底图(BGR)，以及解码时对应的文件修改时间 */
+struct TemplateAssets {
+    QString dir;
+    TemplateLayout layout;
+    cv::Mat paper;
+    QDateTime layoutModified;
+    QDateTime paperModified;
+};
+
 class TemplateManager {
 public:
     static TemplateLayout load(const QString& dir);
-};
 
+    /* 带缓存的加载：按模板目录 + 文件修改时间命中，
+       文件被替换后下一次 acquire() 会重新解析/解码。失败返回 nullptr */
+    static std::shared_ptr<const TemplateAssets> acquire(const QString& dir);
+
+    static bool preload(const QString& dir);
+    static void evict(const QString& dir);
+    static void clearCache();
+
+private:
+    static std::shared_ptr<const TemplateAssets> decode(const QString& dir);
+};
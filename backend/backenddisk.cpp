@@ -2,25 +2,51 @@
 #include "ImageComposer.h"
 #include "TemplateManager.h"
 #include "backenddisk.h"
-#include <QFile>
 
 BackendDisk::BackendDisk(QObject *parent) : QObject(parent)
 {
+    cam.setFrameMode(CameraManager::RawMjpeg);          // 预览缩小解码，拍照再全分辨率解码
     cam.start();
+    templateAssets = TemplateManager::acquire(":/assets/templates/paper_01");   // 启动时解码一次底图
+    connect(&writer, &SnapshotWriter::saved, this,
+            [this](const QString &path, bool ok, const QString &) { emit captureSaved(path, ok); });
+    connect(&cam, &CameraManager::stillCaptured, this, &BackendDisk::saveStill);
     connect(&timer, &QTimer::timeout, this, &BackendDisk::composeOneFrame);
-    timer.start(30);                     // 30 ms 约 33 FPS
+    timer.start(qMax(10, qRound(1000.0 / cam.previewFps())));   // 跟协商出的预览帧率走
 }
 
 void BackendDisk::composeOneFrame()
 {
-    auto frame  = cam.capture();
-    auto layout = TemplateManager::load("qrc:/assets/templates/paper_01");
-    ImageComposer::compose(frame, layout, "live.jpg");   // 写盘
+    if (!cam.grabPreview(previewFrame)) return;          // 没有新帧就不重复合成
+    const cv::Mat &frame = previewFrame;
+    if (!templateAssets)
+        templateAssets = TemplateManager::acquire(":/assets/templates/paper_01");
+    if (!templateAssets) return;
+
+    /* 增量合成：底图只铺一次，每帧只重画人像区域。
+       最新一帧只留在内存画布里，不再每帧写 live.jpg */
+    if (!composer.composeLive(frame, *templateAssets)) return;
+    emit frameReady(composer.liveImage(), composer.dirtyRect());
     emit liveChanged();
 }
 
 void BackendDisk::capture()
 {
-    QFile::remove("final.jpg");
-    QFile::copy("live.jpg", "final.jpg");                // 拍照
+    /* 全分辨率帧在采集线程里取，到了走 saveStill() */
+    cam.requestStill();
+}
+
+void BackendDisk::saveStill(const cv::Mat &full)
+{
+    /* 拍照：全分辨率帧重新合成，失败时退回预览画布 */
+    QImage shot;
+    cv::Mat bgr;
+    if (!full.empty() && templateAssets && ImageComposer::compose(full, *templateAssets, bgr)) {
+        cv::cvtColor(bgr, bgr, cv::COLOR_BGR2RGB);
+        shot = QImage(bgr.data, bgr.cols, bgr.rows, static_cast<int>(bgr.step),
+                      QImage::Format_RGB888).copy();
+    }
+    if (shot.isNull()) shot = composer.liveImage().copy();
+    if (shot.isNull()) return;
+    writer.enqueue(SnapshotJob(std::move(shot), "final.jpg", "JPG", 95));
 }
@@ -3,6 +3,8 @@
 #include <QObject>
 #include <QTimer>
 #include "CameraManager.h"
+#include "ImageComposer.h"
+#include "SnapshotWriter.h"
 
 
 class BackendDisk : public QObject
@@ -15,11 +17,18 @@ public:
 
 signals:
     void liveChanged();                  // 通知 QML 刷新
+    void frameReady(const QImage &frame, const QRect &dirty);
+    void captureSaved(const QString &path, bool ok);
 
 private slots:
     void composeOneFrame();              // 定时合成
+    void saveStill(const cv::Mat &full); // 全分辨率帧到了：重新合成后交给写盘线程
 
 private:
     CameraManager cam;
     QTimer timer;
+    ImageComposer composer;
+    std::shared_ptr<const TemplateAssets> templateAssets;
+    SnapshotWriter writer;
+    cv::Mat previewFrame;                // 预览解码缓冲，尺寸不变时复用
 };
@@ -1,69 +1,97 @@
 #include "backendmem.h"
+#include "LiveVideoItem.h"
+#include <QQmlEngine>
 #include <opencv2/opencv.hpp>
 
 BackendMem::BackendMem(QQmlApplicationEngine *engine, QObject *parent)
     : QObject(parent)
 {
+    /* 传 MJPG 压缩帧，预览按协商出的比例缩小解码，拍照时再全分辨率解码 */
+    cam.setFrameMode(CameraManager::RawMjpeg);
     cam.start();
+    templateAssets = TemplateManager::acquire(":/assets/templates/paper_01");   // 启动时解码一次底图
     provider = new LiveImageProvider;
-    engine->addImageProvider("live", provider);          // 注册 provider
+    engine->addImageProvider("live", provider);          // 注册 provider（拍照取图用）
+    qmlRegisterType<LiveVideoItem>("CustomPicture.Live", 1, 0, "LiveVideoItem");
 
+    connect(&writer, &SnapshotWriter::saved, this,
+            [this](const QString &path, bool ok, const QString &error) {
+                if (!ok)
+                    fprintf(stderr, "[capture] save %s failed: %s\n",
+                            path.toLocal8Bit().constData(), error.toLocal8Bit().constData());
+                emit captureSaved(path, ok);
+            });
+
+    connect(&cam, &CameraManager::stillCaptured, this, &BackendMem::saveStill);
     connect(&timer, &QTimer::timeout, this, &BackendMem::showCam);
-    timer.start(30);
+    timer.start(qMax(10, qRound(1000.0 / cam.previewFps())));   // 跟协商出的预览帧率走
 }
 
 void BackendMem::composeOneFrame()
 {
-    cv::Mat frame = cam.capture();
+    cv::Mat &frame = previewFrame;               // 常驻缓冲，解码尺寸不变时复用
+    if (!cam.grabPreview(frame)) return;         // 采集线程还没送来新帧
     if (frame.empty()) {
         fprintf(stderr, "[composeOneFrame] camera frame empty!\n");
         return;
     }
-    fprintf(stderr, "[composeOneFrame] camera ok  %dx%d  channels=%d\n",
-            frame.cols, frame.rows, frame.channels());
 
-    auto layout = TemplateManager::load(":/assets/templates/paper_01");
+    /* 模板在构造时已取好，每帧不再查缓存（查缓存要拼路径、stat 文件） */
+    if (!templateAssets)
+        templateAssets = TemplateManager::acquire(":/assets/templates/paper_01");
+    if (!templateAssets) return;
 
-    cv::Mat composed;
-    bool ok = ImageComposer::compose(frame, layout, composed);
-    fprintf(stderr, "[composeOneFrame] ImageComposer::compose ret=%d  composed empty=%d\n",
-            ok, composed.empty());
-    if (composed.empty()) return;
+    if (!composer.composeLive(frame, *templateAssets)) {
+        fprintf(stderr, "[composeOneFrame] ImageComposer::composeLive failed\n");
+        return;
+    }
 
-    cv::cvtColor(composed, composed, cv::COLOR_BGR2RGB);
-    QImage qimg(composed.data,
-                composed.cols,
-                composed.rows,
-                static_cast<int>(composed.step),
-                QImage::Format_RGB888);
-    provider->updateImage(qimg.copy());
+    provider->updateImage(composer.liveImage(), composer.dirtyRect());   // 共享画布内存，不拷贝
+    emit frameReady(composer.liveImage(), composer.dirtyRect());
     emit liveChanged();
-    fprintf(stderr, "[composeOneFrame] live image updated\n");
 }
 
 void BackendMem::showCam()
 {
-    cv::Mat frame = cam.capture();
+    cv::Mat &frame = previewFrame;               // 常驻缓冲，解码尺寸不变时复用
+    if (!cam.grabPreview(frame)) return;         // 采集线程还没送来新帧
     if (frame.empty()) {
-        fprintf(stderr, "[composeOneFrame] camera frame empty!\n");
+        fprintf(stderr, "[showCam] camera frame empty!\n");
         return;
     }
-    fprintf(stderr, "[composeOneFrame] camera ok  %dx%d  channels=%d\n",
-            frame.cols, frame.rows, frame.channels());
 
     /* ---- 纯预览：直接原图 ---- */
-    cv::cvtColor(frame, frame, cv::COLOR_BGR2RGB);
-    QImage qimg = QImage(frame.data, frame.cols, frame.rows,
-                  static_cast<int>(frame.step),
-                  QImage::Format_RGB888).copy();
+    /* 槽位归采集线程循环使用，不能原地转换；转到合成器的常驻画布里 */
+    if (!composer.previewLive(frame)) return;
 
-    provider->updateImage(qimg.copy());
+    provider->updateImage(composer.liveImage(), composer.dirtyRect());
+    emit frameReady(composer.liveImage(), composer.dirtyRect());
     emit liveChanged();
-    fprintf(stderr, "[composeOneFrame] live image updated\n");
 }
 
 void BackendMem::capture()
 {
-    QImage img = provider->requestImage("0", nullptr, QSize());
-    img.save("final.jpg", nullptr, 95);                  // 一次性写盘
+    /* 切模式、取帧都在采集线程里做，帧到了走 saveStill()，GUI 线程不等 */
+    cam.requestStill();
+}
+
+void BackendMem::saveStill(const cv::Mat &full)
+{
+    /* 预览是缩小解码的，成片用全分辨率帧重新合成；
+       编码和 IO 交给写盘线程 */
+    QImage shot = composeFullResolution(full);
+    if (shot.isNull()) shot = composer.liveImage().copy();
+    if (shot.isNull()) return;
+    writer.enqueue(SnapshotJob(std::move(shot), "final.jpg", "JPG", 95));
+}
+
+QImage BackendMem::composeFullResolution(const cv::Mat &full)
+{
+    if (full.empty() || !templateAssets) return QImage();
+
+    cv::Mat bgr;
+    if (!ImageComposer::compose(full, *templateAssets, bgr)) return QImage();
+    cv::cvtColor(bgr, bgr, cv::COLOR_BGR2RGB);
+    return QImage(bgr.data, bgr.cols, bgr.rows, static_cast<int>(bgr.step),
+                  QImage::Format_RGB888).copy();
 }
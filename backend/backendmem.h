@@ -8,6 +8,7 @@
 #include "TemplateManager.h"
 #include "LiveImageProvider.h"
 #include "ImageComposer.h"
+#include "SnapshotWriter.h"
 
 class BackendMem : public QObject
 {
@@ -19,14 +20,22 @@ public:
 
 signals:
     void liveChanged();
+    void frameReady(const QImage &frame, const QRect &dirty);   // 推给 LiveVideoItem
+    void captureSaved(const QString &path, bool ok);             // 后台写盘完成
 
 private slots:
     void composeOneFrame();
     void showCam();
+    void saveStill(const cv::Mat &full);   // 全分辨率帧到了：重新合成后交给写盘线程
 
 private:
+    QImage composeFullResolution(const cv::Mat &full);   // 拍照：全分辨率帧重新合成
+
     CameraManager cam;
     QTimer timer;
     LiveImageProvider *provider = nullptr;
-
+    ImageComposer composer;              // 常驻画布，预览稳态不分配
+    std::shared_ptr<const TemplateAssets> templateAssets;
+    SnapshotWriter writer;
+    cv::Mat previewFrame;                // 预览解码缓冲
 };
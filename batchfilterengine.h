@@ -0,0 +1,89 @@
+#ifndef BATCHFILTERENGINE_H
+#define BATCHFILTERENGINE_H
+
+#include "imageeditor.h"
+#include <QObject>
+#include <QImage>
+#include <QVector>
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QThreadPool>
+#include <atomic>
+
+class FilterGraph;
+
+// 批量滤镜引擎
+// 对一批图片（内存中的 QImage 或文件路径）依次应用同一条滤镜链，多张图同时处理。
+// 同时在处理的图片数不超过 maxInFlight，结果处理完一张就通过信号送出一张，
+// 引擎本身不攒结果，几百张的活动相册也只占几张图的内存。
+// 信号从工作线程发出，跨线程连接时自动排队到接收者线程。
+class BatchFilterEngine : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit BatchFilterEngine(QObject *parent = nullptr);
+    ~BatchFilterEngine();
+
+    // 滤镜链：按顺序对每张图调用 ImageEditor::applyFilterWithParams
+    void setFilterChain(const QVector<FilterParams> &chain);
+    QVector<FilterParams> getFilterChain() const { return m_chain; }
+
+    // 同时处理的图片数，<= 0 为 TileScheduler::maxThreads()
+    void setMaxInFlight(int count);
+    int getMaxInFlight() const;
+
+    // 设置后文件路径输入的结果直接写到该目录（同名，按 format 换扩展名），
+    // 发 fileWritten 而不发 resultReady；为空则不写文件
+    void setOutputDirectory(const QString &dir, const QByteArray &format = "jpg", int quality = 92);
+
+    // 开始处理；正在处理时调用返回 false
+    bool start(const QVector<QImage> &images);
+    bool start(const QStringList &paths);
+
+    void cancel();                       // 正在处理的图片做完即停，不再取新的
+    bool isRunning() const { return m_activeWorkers.load() > 0; }
+    bool isCanceled() const { return m_canceled.load(); }
+    void waitForFinished();
+
+    // 同步处理，结果与输入一一对应
+    static QVector<QImage> run(const QVector<QImage> &images, const QVector<FilterParams> &chain);
+
+signals:
+    void progress(int done, int total);
+    void resultReady(int index, const QImage &image);
+    void fileWritten(int index, const QString &path);
+    void failed(int index, const QString &message);
+    void finished(bool canceled);
+
+private:
+    friend class BatchFilterWorker;
+
+    bool startWorkers(int total);
+    void processNext(QImage &scratch, FilterGraph &graph);   // 工作线程循环：取下一张、处理、送出
+    void workerFinished();
+    QString outputPath(const QString &source) const;
+
+    static QImage applyChain(const QImage &image, const QVector<FilterParams> &chain);
+    static QImage applyChain(const QImage &image, const QVector<FilterParams> &chain, FilterGraph &graph);
+
+    QThreadPool m_pool;
+    QVector<FilterParams> m_chain;
+    int m_maxInFlight;
+
+    QVector<QImage> m_images;
+    QStringList m_paths;
+    int m_total;
+
+    QString m_outputDir;
+    QByteArray m_outputFormat;
+    int m_outputQuality;
+
+    std::atomic<int> m_next;
+    std::atomic<int> m_done;
+    std::atomic<int> m_activeWorkers;
+    std::atomic<bool> m_canceled;
+};
+
+#endif // BATCHFILTERENGINE_H
@@ -4,7 +4,6 @@
 #include <QMessageBox>
 #include <QStandardPaths>
 #include <QCameraInfo>
-#include <QCameraViewfinder>
 #include <QCameraImageCapture>
 #include <QDateTime>
 #include <QPainter>
@@ -13,12 +12,14 @@
 #include <QResizeEvent>
 #include <QElapsedTimer>
 #include <QThread>
+#include "backend/CameraProfile.h"
+#include "avatarpreview.h"
 
 BigHeadPictureWindow::BigHeadPictureWindow(QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::BigHeadPictureWindow)
     , camera(nullptr)
-    , viewfinder(nullptr)
+    , preview(nullptr)
     , imageCapture(nullptr)
     , cameraActive(false)
     , currentBgIndex(0)
@@ -51,20 +52,12 @@ void BigHeadPictureWindow::initUI()
     ui->btnPrevBg->setEnabled(false);
     ui->btnNextBg->setEnabled(true);
 
-    // 创建相机视图容器
-    viewfinder = new QCameraViewfinder(this);
-    viewfinder->setMinimumSize(180, 180);
-    viewfinder->setMaximumSize(180, 180);
-
-    // 设置圆形遮罩
-    viewfinder->setStyleSheet(
-        "border-radius: 90px; "
-        "background-color: transparent;"
-        );
-
-    // 添加到相机容器
-    ui->cameraContainerLayout->addWidget(viewfinder);
-    viewfinder->setVisible(false);
+    // 实时预览：取景帧在后台线程合成背景和圆形头像后显示在背景标签里。
+    // 标签的尺寸由布局决定，不随画面大小变化，否则每帧按标签尺寸合成会把窗口越撑越大
+    ui->labelBackground->setSizePolicy(QSizePolicy::Ignored, QSizePolicy::Ignored);
+    preview = new AvatarPreview(this);
+    connect(preview, &AvatarPreview::frameReady,
+            this, &BigHeadPictureWindow::onPreviewFrame);
 }
 
 void BigHeadPictureWindow::initCamera()
@@ -88,20 +81,56 @@ void BigHeadPictureWindow::initCamera()
     camera = new QCamera(selectedCamera, this);
     imageCapture = new QCameraImageCapture(camera, this);
 
-    // 设置相机参数（降低分辨率减少内存）
+    // 设置相机参数：预览只需合成显示尺寸里的小头像，要低分辨率；拍照要能裁出清晰的头像。
+    // 具体格式/分辨率/帧率由 CameraProfile 按设备能力协商，结果有存档
+    CameraTargets targets;
+    targets.previewWidth = 320;
+    targets.previewHeight = 240;
+    targets.previewFps = 15.0;
+    targets.stillWidth = 640;
+    targets.stillHeight = 480;
+    const CameraProfile profile = CameraProfile::resolve(targets, selectedCamera.deviceName());
+
     QCameraViewfinderSettings settings;
-    settings.setResolution(320, 240);  // 低分辨率
-    settings.setPixelFormat(QVideoFrame::Format_YUYV);
-    settings.setMinimumFrameRate(10.0);
-    settings.setMaximumFrameRate(20.0);
+    if (profile.isValid() && profile.device == selectedCamera.deviceName()) {
+        settings.setResolution(profile.preview.width, profile.preview.height);
+        // 预览表面不支持的格式（NV12）交给后端转换
+        const QVideoFrame::PixelFormat format = pixelFormatFor(profile.preview);
+        if (preview->supportedPixelFormats().contains(format)) {
+            settings.setPixelFormat(format);
+        }
+        if (profile.preview.fps > 0.0) {
+            settings.setMinimumFrameRate(qMin(10.0, profile.preview.fps));
+            settings.setMaximumFrameRate(qMin(30.0, profile.preview.fps));
+        }
+
+        QImageEncoderSettings still;
+        still.setResolution(profile.still.width, profile.still.height);
+        imageCapture->setEncodingSettings(still);
+    } else {
+        // 协商不出来（非 V4L2 设备）时用原来的低分辨率设置
+        settings.setResolution(320, 240);
+        settings.setPixelFormat(QVideoFrame::Format_YUYV);
+        settings.setMinimumFrameRate(10.0);
+        settings.setMaximumFrameRate(30.0);
+    }
 
     camera->setViewfinderSettings(settings);
-    camera->setViewfinder(viewfinder);
+    camera->setViewfinder(preview);
 
     // 连接信号
     connect(imageCapture, &QCameraImageCapture::imageCaptured,
             this, &BigHeadPictureWindow::onImageCaptured);
 }
+QVideoFrame::PixelFormat BigHeadPictureWindow::pixelFormatFor(const CameraMode &mode)
+{
+    const QString fourcc = mode.fourccString();
+    if (fourcc == "MJPG") return QVideoFrame::Format_Jpeg;
+    if (fourcc == "UYVY") return QVideoFrame::Format_UYVY;
+    if (fourcc == "NV12") return QVideoFrame::Format_NV12;
+    return QVideoFrame::Format_YUYV;
+}
+
 QCameraInfo BigHeadPictureWindow::chooseCamera(){
     const auto all = QCameraInfo::availableCameras();
 
@@ -166,8 +195,12 @@ void BigHeadPictureWindow::initBackgrounds()
     backgrounds.append(gradientBg);
     bgNames.append("渐变背景");
 
+    // 合成输出与背景同尺寸，头像居中、直径为一半
+    compositor.setOutputSize(backgrounds.first().size());
+    compositor.setRing(Qt::white, 3);
+
     // 更新背景显示
-    // updateBackgroundDisplay();
+    updateBackgroundDisplay();
 }
 
 void BigHeadPictureWindow::initConnections()
@@ -187,6 +220,13 @@ void BigHeadPictureWindow::initConnections()
 
 void BigHeadPictureWindow::updateUI()
 {
+    // 同步合成器背景（设置时就缩放好，拍照和预览时不再处理）
+    if (currentBgIndex >= 0 && currentBgIndex < backgrounds.size()) {
+        compositor.setBackground(backgrounds[currentBgIndex].toImage());
+    } else {
+        compositor.setBackground(QColor(Qt::white));
+    }
+
     // 更新背景名称标签
     if (currentBgIndex >= 0 && currentBgIndex < bgNames.size()) {
         ui->labelBgName->setText(bgNames[currentBgIndex]);
@@ -204,14 +244,31 @@ void BigHeadPictureWindow::updateUI()
 
 void BigHeadPictureWindow::updateBackgroundDisplay()
 {
-    if (currentBgIndex >= 0 && currentBgIndex < backgrounds.size()) {
-        QPixmap bg = backgrounds[currentBgIndex];
+    if (currentBgIndex < 0 || currentBgIndex >= backgrounds.size()) {
+        return;
+    }
 
-        // 缩放背景以适应显示区域
-        QSize labelSize = ui->labelBackground->size();
-        QPixmap scaledBg = bg.scaled(labelSize, Qt::KeepAspectRatioByExpanding, Qt::SmoothTransformation);
+    // 预览合成器按显示区域尺寸设置，背景在这里就缩放好，逐帧合成时不再处理
+    QSize labelSize = ui->labelBackground->size();
+    if (labelSize.isEmpty()) {
+        return;
+    }
+    AvatarCompositor display;
+    display.setOutputSize(labelSize);
+    display.setBackground(backgrounds[currentBgIndex].toImage());
+    display.setRing(Qt::white, 3);
+    preview->setCompositor(display);
+
+    // 相机没开时只显示背景，开着时等下一帧
+    if (!cameraActive) {
+        ui->labelBackground->setPixmap(QPixmap::fromImage(display.compose(QImage())));
+    }
+}
 
-        ui->labelBackground->setPixmap(scaledBg);
+void BigHeadPictureWindow::onPreviewFrame(const QImage &image)
+{
+    if (cameraActive) {
+        ui->labelBackground->setPixmap(QPixmap::fromImage(image));
     }
 }
 
@@ -242,7 +299,6 @@ void BigHeadPictureWindow::onBtnToggleCameraClicked()
             }
 
             if (camera->state() == QCamera::ActiveState) {
-                viewfinder->setVisible(true);
                 ui->btnToggleCamera->setText("📷 关闭相机");
                 ui->btnCapture->setEnabled(true);
                 cameraActive = true;
@@ -257,11 +313,11 @@ void BigHeadPictureWindow::onBtnToggleCameraClicked()
     } else {
         // 关闭相机
         camera->stop();
-        viewfinder->setVisible(false);
         ui->btnToggleCamera->setText("📷 开启相机");
         ui->btnCapture->setEnabled(false);
         cameraActive = false;
         ui->labelStatus->setText("相机已停止 - " + bgNames[currentBgIndex]);
+        updateBackgroundDisplay();
     }
 }
 
@@ -279,12 +335,12 @@ void BigHeadPictureWindow::onBtnCaptureClicked()
     imageCapture->capture();
 }
 
-void BigHeadPictureWindow::onImageCaptured(int id, const QImage &preview)
+void BigHeadPictureWindow::onImageCaptured(int id, const QImage &captured)
 {
     Q_UNUSED(id);
 
     // 合成大头照
-    QPixmap result = combineHeadPicture(preview);
+    QPixmap result = combineHeadPicture(captured);
 
     // 保存到文件
     saveHeadPicture(result);
@@ -295,67 +351,8 @@ void BigHeadPictureWindow::onImageCaptured(int id, const QImage &preview)
 
 QPixmap BigHeadPictureWindow::combineHeadPicture(const QImage &cameraImage)
 {
-    // 创建结果图像（与背景相同大小）
-    QPixmap result(400, 400);
-
-    // 第一步：绘制背景
-    QPainter painter(&result);
-    painter.setRenderHint(QPainter::Antialiasing);
-
-    if (currentBgIndex >= 0 && currentBgIndex < backgrounds.size()) {
-        painter.drawPixmap(0, 0, backgrounds[currentBgIndex]);
-    } else {
-        painter.fillRect(result.rect(), Qt::white);
-    }
-
-    // 第二步：绘制相机图像（圆形头像）
-    if (!cameraImage.isNull()) {
-        // 缩放相机图像以适应圆形区域
-        QImage scaledCamera = cameraImage.scaled(200, 200, Qt::KeepAspectRatioByExpanding, Qt::SmoothTransformation);
-
-        // 创建圆形蒙版
-        QPixmap mask(200, 200);
-        mask.fill(Qt::transparent);
-
-        QPainter maskPainter(&mask);
-        maskPainter.setRenderHint(QPainter::Antialiasing);
-        maskPainter.setBrush(Qt::black);
-        maskPainter.setPen(Qt::NoPen);
-        maskPainter.drawEllipse(0, 0, 200, 200);
-        maskPainter.end();
-
-        // 应用圆形蒙版
-        QImage circularImage(200, 200, QImage::Format_ARGB32);
-        circularImage.fill(Qt::transparent);
-
-        for (int y = 0; y < 200; ++y) {
-            for (int x = 0; x < 200; ++x) {
-                QRgb maskPixel = mask.toImage().pixel(x, y);
-                if (qAlpha(maskPixel) > 0) {
-                    int srcX = (x * scaledCamera.width()) / 200;
-                    int srcY = (y * scaledCamera.height()) / 200;
-
-                    if (srcX < scaledCamera.width() && srcY < scaledCamera.height()) {
-                        circularImage.setPixel(x, y, scaledCamera.pixel(srcX, srcY));
-                    }
-                }
-            }
-        }
-
-        // 在中心位置绘制圆形头像
-        int xPos = (400 - 200) / 2;
-        int yPos = (400 - 200) / 2;
-        painter.drawImage(xPos, yPos, circularImage);
-
-        // 添加白色边框
-        painter.setPen(QPen(Qt::white, 3));
-        painter.setBrush(Qt::NoBrush);
-        painter.drawEllipse(xPos, yPos, 200, 200);
-    }
-
-    painter.end();
-
-    return result;
+    // 背景、圆形头像和白色边框由合成器一遍画完（尺寸取自背景）
+    return QPixmap::fromImage(compositor.compose(cameraImage));
 }
 
 void BigHeadPictureWindow::saveHeadPicture(const QPixmap &picture)
@@ -384,7 +381,7 @@ void BigHeadPictureWindow::onBtnPrevBgClicked()
 {
     if (currentBgIndex > 0) {
         currentBgIndex--;
-        //updateBackgroundDisplay();
+        updateBackgroundDisplay();
         updateUI();
     }
 }
@@ -393,7 +390,7 @@ void BigHeadPictureWindow::onBtnNextBgClicked()
 {
     if (currentBgIndex < backgrounds.size() - 1) {
         currentBgIndex++;
-        //updateBackgroundDisplay();
+        updateBackgroundDisplay();
         updateUI();
     }
 }
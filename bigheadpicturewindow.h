@@ -4,9 +4,12 @@
 #include "qcamerainfo.h"
 #include <QMainWindow>
 #include <QObject>
+#include <QVideoFrame>
+#include "avatarcompositor.h"
 // 前置声明
+struct CameraMode;
 class QCamera;
-class QCameraViewfinder;
+class AvatarPreview;
 class QCameraImageCapture;
 class QPixmap;
 class QPushButton;
@@ -34,7 +37,8 @@ private slots:
     void onBtnPrevBgClicked();
     void onBtnNextBgClicked();
 
-    void onImageCaptured(int id, const QImage &preview);
+    void onImageCaptured(int id, const QImage &captured);
+    void onPreviewFrame(const QImage &image);
 
 private:
     void initUI();
@@ -43,6 +47,7 @@ private:
     void initConnections();
     void updateUI();
     void updateBackgroundDisplay();
+    static QVideoFrame::PixelFormat pixelFormatFor(const CameraMode &mode);
 
     QPixmap combineHeadPicture(const QImage &cameraImage);
     void saveHeadPicture(const QPixmap &picture);
@@ -52,7 +57,7 @@ private:
 
     // 相机相关
     QCamera *camera;
-    QCameraViewfinder *viewfinder;
+    AvatarPreview *preview;
     QCameraImageCapture *imageCapture;
     bool cameraActive;
 
@@ -60,6 +65,9 @@ private:
     QList<QPixmap> backgrounds;
     QStringList bgNames;
     int currentBgIndex;
+
+    // 大头照合成
+    AvatarCompositor compositor;
 };
 
 #endif // BIGHEADPICTUREWINDOW_H
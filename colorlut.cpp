@@ -0,0 +1,217 @@
+#include "colorlut.h"
+#include "tilescheduler.h"
+#include <QtGlobal>
+
+namespace {
+
+const int kLast = ColorLut::Size - 1;
+
+// 8 位取值 -> 格点下标和 Q8 小数部分；255 落在最后一个格子的右端（小数 256）
+struct LatticeIndex {
+    quint8 index[256];
+    quint16 frac[256];
+
+    LatticeIndex()
+    {
+        for (int v = 0; v < 256; ++v) {
+            int f = (v * kLast * 256 + 127) / 255;
+            int i = qMin(f >> 8, kLast - 1);
+            index[v] = quint8(i);
+            frac[v] = quint16(f - i * 256);
+        }
+    }
+};
+
+const LatticeIndex &latticeIndex()
+{
+    static const LatticeIndex table;
+    return table;
+}
+
+inline int latticeValue(int i)
+{
+    return (i * 255 + kLast / 2) / kLast;
+}
+
+} // namespace
+
+ColorLut::ColorLut()
+{
+    for (int c = 0; c < 3; ++c) {
+        for (int v = 0; v < 256; ++v) {
+            curve[c][v] = quint8(v);
+        }
+    }
+}
+
+ColorLut ColorLut::bake(const std::function<QRgb(QRgb)> &fn)
+{
+    ColorLut lut;
+    lut.cube.resize(Size * Size * Size);
+    int n = 0;
+    for (int r = 0; r < Size; ++r) {
+        for (int g = 0; g < Size; ++g) {
+            for (int b = 0; b < Size; ++b) {
+                lut.cube[n++] = fn(qRgb(latticeValue(r), latticeValue(g), latticeValue(b)));
+            }
+        }
+    }
+    lut.hasCube = true;
+    return lut;
+}
+
+ColorLut ColorLut::fromCurve(const QVector<int> &curve)
+{
+    return fromCurves(curve, curve, curve);
+}
+
+ColorLut ColorLut::fromCurves(const QVector<int> &red, const QVector<int> &green,
+                              const QVector<int> &blue)
+{
+    ColorLut lut;
+    const QVector<int> *curves[3] = { &red, &green, &blue };
+    for (int c = 0; c < 3; ++c) {
+        for (int v = 0; v < 256; ++v) {
+            lut.curve[c][v] = quint8(qBound(0, v < curves[c]->size() ? curves[c]->at(v) : v, 255));
+        }
+    }
+    lut.hasCurves = true;
+    return lut;
+}
+
+// 四面体插值：按三个小数部分的大小关系选出包含该点的四面体，
+// 只取 4 个格点（三线性要 8 个），权重和为 256
+QRgb ColorLut::lookup(int r, int g, int b) const
+{
+    const LatticeIndex &li = latticeIndex();
+    const int fr = li.frac[r], fg = li.frac[g], fb = li.frac[b];
+    const QRgb *c000 = cube.constData() + (li.index[r] * Size + li.index[g]) * Size + li.index[b];
+
+    const int dr = Size * Size, dg = Size, db = 1;
+    QRgb c1, c2;
+    int w0, w1, w2, w3;
+    if (fr >= fg) {
+        if (fg >= fb) {            // r >= g >= b
+            c1 = c000[dr]; c2 = c000[dr + dg];
+            w0 = 256 - fr; w1 = fr - fg; w2 = fg - fb; w3 = fb;
+        } else if (fr >= fb) {     // r >= b > g
+            c1 = c000[dr]; c2 = c000[dr + db];
+            w0 = 256 - fr; w1 = fr - fb; w2 = fb - fg; w3 = fg;
+        } else {                   // b > r >= g
+            c1 = c000[db]; c2 = c000[dr + db];
+            w0 = 256 - fb; w1 = fb - fr; w2 = fr - fg; w3 = fg;
+        }
+    } else {
+        if (fr >= fb) {            // g > r >= b
+            c1 = c000[dg]; c2 = c000[dr + dg];
+            w0 = 256 - fg; w1 = fg - fr; w2 = fr - fb; w3 = fb;
+        } else if (fg >= fb) {     // g >= b > r
+            c1 = c000[dg]; c2 = c000[dg + db];
+            w0 = 256 - fg; w1 = fg - fb; w2 = fb - fr; w3 = fr;
+        } else {                   // b > g > r
+            c1 = c000[db]; c2 = c000[dg + db];
+            w0 = 256 - fb; w1 = fb - fg; w2 = fg - fr; w3 = fr;
+        }
+    }
+    const QRgb c0 = c000[0];
+    const QRgb c3 = c000[dr + dg + db];
+
+    const int outR = (qRed(c0) * w0 + qRed(c1) * w1 + qRed(c2) * w2 + qRed(c3) * w3 + 128) >> 8;
+    const int outG = (qGreen(c0) * w0 + qGreen(c1) * w1 + qGreen(c2) * w2 + qGreen(c3) * w3 + 128) >> 8;
+    const int outB = (qBlue(c0) * w0 + qBlue(c1) * w1 + qBlue(c2) * w2 + qBlue(c3) * w3 + 128) >> 8;
+    return qRgb(outR, outG, outB);
+}
+
+QRgb ColorLut::map(QRgb pixel) const
+{
+    int r = curve[0][qRed(pixel)];
+    int g = curve[1][qGreen(pixel)];
+    int b = curve[2][qBlue(pixel)];
+    if (hasCube) {
+        QRgb c = lookup(r, g, b);
+        return (pixel & 0xff000000u) | (c & 0x00ffffffu);
+    }
+    return qRgba(r, g, b, qAlpha(pixel));
+}
+
+void ColorLut::apply(QImage &image) const
+{
+    if (image.isNull() || isIdentity()) {
+        return;
+    }
+    if (image.format() != QImage::Format_RGB32 && image.format() != QImage::Format_ARGB32 &&
+        image.format() != QImage::Format_ARGB32_Premultiplied) {
+        image = image.convertToFormat(QImage::Format_ARGB32);
+    }
+
+    uchar *bits = image.bits();
+    const int bytesPerLine = image.bytesPerLine();
+    const int width = image.width();
+    const bool premultiplied = image.format() == QImage::Format_ARGB32_Premultiplied;
+    TileScheduler::forEachStrip(image, 0, [&](int firstRow, int lastRow) {
+        applyRows(bits, bytesPerLine, width, firstRow, lastRow, premultiplied);
+    });
+}
+
+void ColorLut::applyRows(uchar *bits, int bytesPerLine, int width, int firstRow, int lastRow,
+                         bool premultiplied) const
+{
+    if (isIdentity()) {
+        return;
+    }
+    for (int y = firstRow; y < lastRow; ++y) {
+        applyLine(reinterpret_cast<QRgb *>(bits + y * bytesPerLine), width, premultiplied);
+    }
+}
+
+void ColorLut::applyLine(QRgb *line, int count, bool premultiplied) const
+{
+    if (premultiplied) {
+        // 照片绝大多数像素不透明，走和非预乘一样的路径；全透明的保持不动
+        for (int x = 0; x < count; ++x) {
+            const QRgb p = line[x];
+            const uint alpha = qAlpha(p);
+            if (alpha == 255) {
+                line[x] = map(p);
+            } else if (alpha != 0) {
+                line[x] = qPremultiply(map(qUnpremultiply(p)));
+            }
+        }
+        return;
+    }
+    if (!hasCube) {
+        for (int x = 0; x < count; ++x) {
+            const QRgb p = line[x];
+            line[x] = qRgba(curve[0][qRed(p)], curve[1][qGreen(p)], curve[2][qBlue(p)], qAlpha(p));
+        }
+        return;
+    }
+    for (int x = 0; x < count; ++x) {
+        line[x] = map(line[x]);
+    }
+}
+
+// 两张纯曲线表直接复合曲线（精确）；否则在格点上复合后重新烘焙
+ColorLut ColorLut::then(const ColorLut &next) const
+{
+    if (next.isIdentity()) {
+        return *this;
+    }
+    if (isIdentity()) {
+        return next;
+    }
+    if (!hasCube && !next.hasCube) {
+        ColorLut lut;
+        for (int c = 0; c < 3; ++c) {
+            for (int v = 0; v < 256; ++v) {
+                lut.curve[c][v] = next.curve[c][curve[c][v]];
+            }
+        }
+        lut.hasCurves = true;
+        return lut;
+    }
+    const ColorLut first = *this;
+    return bake([first, next](QRgb pixel) {
+        return next.map(first.map(pixel));
+    });
+}
@@ -0,0 +1,53 @@
+#ifndef COLORLUT_H
+#define COLORLUT_H
+
+#include <QImage>
+#include <QRgb>
+#include <QVector>
+#include <functional>
+
+// 三维颜色查找表（33x33x33，四面体插值）
+// 任意逐像素的颜色变换都可以烘焙成一张表，应用时每像素一次查表，
+// 开销与变换里有多少步无关。另带每通道 256 项的一维曲线（先于三维表应用），
+// 纯按通道的变换（Gamma 等）放在曲线里是精确的，不受格点插值影响。
+class ColorLut
+{
+public:
+    static const int Size = 33;
+
+    ColorLut();     // 恒等
+
+    // 在每个格点上调用 fn 得到输出颜色（fn 收到的 alpha 为 255，输出的 alpha 忽略）
+    static ColorLut bake(const std::function<QRgb(QRgb)> &fn);
+
+    // 只含一维曲线的表（三维部分为恒等）
+    static ColorLut fromCurve(const QVector<int> &curve);
+    static ColorLut fromCurves(const QVector<int> &red, const QVector<int> &green,
+                               const QVector<int> &blue);
+
+    bool isIdentity() const { return !hasCube && !hasCurves; }
+
+    // 原地应用，alpha 保持不变。RGB32 / ARGB32 / ARGB32_Premultiplied 直接处理
+    // （预乘格式下半透明像素先还原再映射），其余格式先转成 ARGB32。按行条带并行
+    void apply(QImage &image) const;
+
+    // 只处理 [firstRow, lastRow) 行；bits 为 32 位像素数据（多线程下不要用 scanLine() 取）
+    void applyRows(uchar *bits, int bytesPerLine, int width, int firstRow, int lastRow,
+                   bool premultiplied = false) const;
+    void applyLine(QRgb *line, int count, bool premultiplied = false) const;
+
+    // 先应用本表再应用 next 的复合表，连续的逐像素调色合成一次查表
+    ColorLut then(const ColorLut &next) const;
+
+    QRgb map(QRgb pixel) const;
+
+private:
+    QRgb lookup(int r, int g, int b) const;
+
+    QVector<QRgb> cube;                 // Size^3 个格点，下标 (r * Size + g) * Size + b
+    quint8 curve[3][256];               // r, g, b 曲线
+    bool hasCube = false;
+    bool hasCurves = false;
+};
+
+#endif // COLORLUT_H
@@ -0,0 +1,266 @@
+#include "convolutionengine.h"
+#include "simdsupport.h"
+#include "tilescheduler.h"
+#include <QtGlobal>
+#include <cstring>
+
+namespace {
+
+const quint32 kAlphaMask = 0xff000000u;
+
+inline int clampByte(int v)
+{
+    return v < 0 ? 0 : (v > 255 ? 255 : v);
+}
+
+// 标量路径：其它路径的参照，也用来处理每行末尾凑不满一组的像素
+template <int N>
+void convolveScalar(const quint32 *const *rows, const qint16 *w, int x0, int x1, quint32 *dst)
+{
+    for (int x = x0; x < x1; ++x) {
+        int acc0 = 0, acc1 = 0, acc2 = 0;
+        for (int ky = 0; ky < N; ++ky) {
+            const uchar *p = reinterpret_cast<const uchar *>(rows[ky] + x);
+            const qint16 *wr = w + ky * N;
+            for (int kx = 0; kx < N; ++kx, p += 4) {
+                acc0 += wr[kx] * p[0];
+                acc1 += wr[kx] * p[1];
+                acc2 += wr[kx] * p[2];
+            }
+        }
+        const quint32 c0 = quint32(clampByte(acc0 >> ConvolutionEngine::FractionBits));
+        const quint32 c1 = quint32(clampByte(acc1 >> ConvolutionEngine::FractionBits));
+        const quint32 c2 = quint32(clampByte(acc2 >> ConvolutionEngine::FractionBits));
+        dst[x] = kAlphaMask | (c2 << 16) | (c1 << 8) | c0;
+    }
+}
+
+#if defined(SIMD_USE_AVX2)
+// 一次 8 个像素。两个抽头交错成 int16 对，用 madd 一次乘加两个抽头；
+// unpack/pack 都在 128 位半边内进行，进出顺序互逆，像素顺序不变
+template <int N>
+int convolveAvx2(const quint32 *const *rows, const qint16 *w, int width, quint32 *dst)
+{
+    const int taps = N * N;
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i alpha = _mm256_set1_epi32(int(kAlphaMask));
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m256i acc0 = zero, acc1 = zero, acc2 = zero, acc3 = zero;
+        for (int t = 0; t < taps; t += 2) {
+            const int t1 = t + 1 < taps ? t + 1 : t;
+            const qint16 w0 = w[t];
+            const qint16 w1 = t + 1 < taps ? w[t + 1] : qint16(0);
+            const __m256i a = _mm256_loadu_si256(
+                reinterpret_cast<const __m256i *>(rows[t / N] + x + t % N));
+            const __m256i b = _mm256_loadu_si256(
+                reinterpret_cast<const __m256i *>(rows[t1 / N] + x + t1 % N));
+            const __m256i wp = _mm256_set1_epi32(int((quint32(quint16(w1)) << 16) | quint16(w0)));
+            const __m256i alo = _mm256_unpacklo_epi8(a, zero), ahi = _mm256_unpackhi_epi8(a, zero);
+            const __m256i blo = _mm256_unpacklo_epi8(b, zero), bhi = _mm256_unpackhi_epi8(b, zero);
+            acc0 = _mm256_add_epi32(acc0, _mm256_madd_epi16(_mm256_unpacklo_epi16(alo, blo), wp));
+            acc1 = _mm256_add_epi32(acc1, _mm256_madd_epi16(_mm256_unpackhi_epi16(alo, blo), wp));
+            acc2 = _mm256_add_epi32(acc2, _mm256_madd_epi16(_mm256_unpacklo_epi16(ahi, bhi), wp));
+            acc3 = _mm256_add_epi32(acc3, _mm256_madd_epi16(_mm256_unpackhi_epi16(ahi, bhi), wp));
+        }
+        acc0 = _mm256_srai_epi32(acc0, ConvolutionEngine::FractionBits);
+        acc1 = _mm256_srai_epi32(acc1, ConvolutionEngine::FractionBits);
+        acc2 = _mm256_srai_epi32(acc2, ConvolutionEngine::FractionBits);
+        acc3 = _mm256_srai_epi32(acc3, ConvolutionEngine::FractionBits);
+        const __m256i lo = _mm256_packs_epi32(acc0, acc1);
+        const __m256i hi = _mm256_packs_epi32(acc2, acc3);
+        const __m256i out = _mm256_or_si256(_mm256_packus_epi16(lo, hi), alpha);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + x), out);
+    }
+    return x;
+}
+#endif
+
+#if defined(SIMD_USE_SSE2)
+// 一次 4 个像素，做法同 AVX2
+template <int N>
+int convolveSse2(const quint32 *const *rows, const qint16 *w, int x0, int width, quint32 *dst)
+{
+    const int taps = N * N;
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i alpha = _mm_set1_epi32(int(kAlphaMask));
+    int x = x0;
+    for (; x + 4 <= width; x += 4) {
+        __m128i acc0 = zero, acc1 = zero, acc2 = zero, acc3 = zero;
+        for (int t = 0; t < taps; t += 2) {
+            const int t1 = t + 1 < taps ? t + 1 : t;
+            const qint16 w0 = w[t];
+            const qint16 w1 = t + 1 < taps ? w[t + 1] : qint16(0);
+            const __m128i a = _mm_loadu_si128(
+                reinterpret_cast<const __m128i *>(rows[t / N] + x + t % N));
+            const __m128i b = _mm_loadu_si128(
+                reinterpret_cast<const __m128i *>(rows[t1 / N] + x + t1 % N));
+            const __m128i wp = _mm_set1_epi32(int((quint32(quint16(w1)) << 16) | quint16(w0)));
+            const __m128i alo = _mm_unpacklo_epi8(a, zero), ahi = _mm_unpackhi_epi8(a, zero);
+            const __m128i blo = _mm_unpacklo_epi8(b, zero), bhi = _mm_unpackhi_epi8(b, zero);
+            acc0 = _mm_add_epi32(acc0, _mm_madd_epi16(_mm_unpacklo_epi16(alo, blo), wp));
+            acc1 = _mm_add_epi32(acc1, _mm_madd_epi16(_mm_unpackhi_epi16(alo, blo), wp));
+            acc2 = _mm_add_epi32(acc2, _mm_madd_epi16(_mm_unpacklo_epi16(ahi, bhi), wp));
+            acc3 = _mm_add_epi32(acc3, _mm_madd_epi16(_mm_unpackhi_epi16(ahi, bhi), wp));
+        }
+        acc0 = _mm_srai_epi32(acc0, ConvolutionEngine::FractionBits);
+        acc1 = _mm_srai_epi32(acc1, ConvolutionEngine::FractionBits);
+        acc2 = _mm_srai_epi32(acc2, ConvolutionEngine::FractionBits);
+        acc3 = _mm_srai_epi32(acc3, ConvolutionEngine::FractionBits);
+        const __m128i lo = _mm_packs_epi32(acc0, acc1);
+        const __m128i hi = _mm_packs_epi32(acc2, acc3);
+        const __m128i out = _mm_or_si128(_mm_packus_epi16(lo, hi), alpha);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x), out);
+    }
+    return x;
+}
+#endif
+
+#if defined(SIMD_USE_NEON)
+// 一次 4 个像素：字节扩成 int16，vmlal 按抽头乘加到 int32
+template <int N>
+int convolveNeon(const quint32 *const *rows, const qint16 *w, int width, quint32 *dst)
+{
+    const uint8x16_t alpha = vreinterpretq_u8_u32(vdupq_n_u32(kAlphaMask));
+    int x = 0;
+    for (; x + 4 <= width; x += 4) {
+        int32x4_t acc0 = vdupq_n_s32(0), acc1 = acc0, acc2 = acc0, acc3 = acc0;
+        for (int ky = 0; ky < N; ++ky) {
+            const qint16 *wr = w + ky * N;
+            for (int kx = 0; kx < N; ++kx) {
+                const uint8x16_t p = vld1q_u8(reinterpret_cast<const uint8_t *>(rows[ky] + x + kx));
+                const int16x8_t lo = vreinterpretq_s16_u16(vmovl_u8(vget_low_u8(p)));
+                const int16x8_t hi = vreinterpretq_s16_u16(vmovl_u8(vget_high_u8(p)));
+                acc0 = vmlal_n_s16(acc0, vget_low_s16(lo), wr[kx]);
+                acc1 = vmlal_n_s16(acc1, vget_high_s16(lo), wr[kx]);
+                acc2 = vmlal_n_s16(acc2, vget_low_s16(hi), wr[kx]);
+                acc3 = vmlal_n_s16(acc3, vget_high_s16(hi), wr[kx]);
+            }
+        }
+        const int16x8_t lo = vcombine_s16(vqmovn_s32(vshrq_n_s32(acc0, ConvolutionEngine::FractionBits)),
+                                          vqmovn_s32(vshrq_n_s32(acc1, ConvolutionEngine::FractionBits)));
+        const int16x8_t hi = vcombine_s16(vqmovn_s32(vshrq_n_s32(acc2, ConvolutionEngine::FractionBits)),
+                                          vqmovn_s32(vshrq_n_s32(acc3, ConvolutionEngine::FractionBits)));
+        const uint8x16_t out = vorrq_u8(vcombine_u8(vqmovun_s16(lo), vqmovun_s16(hi)), alpha);
+        vst1q_u8(reinterpret_cast<uint8_t *>(dst + x), out);
+    }
+    return x;
+}
+#endif
+
+template <int N>
+void convolveRow(const quint32 *const *rows, const qint16 *w, int width, quint32 *dst)
+{
+    int x = 0;
+#if defined(SIMD_USE_AVX2)
+    x = convolveAvx2<N>(rows, w, width, dst);
+#endif
+#if defined(SIMD_USE_SSE2)
+    x = convolveSse2<N>(rows, w, x, width, dst);
+#elif defined(SIMD_USE_NEON)
+    x = convolveNeon<N>(rows, w, width, dst);
+#endif
+    convolveScalar<N>(rows, w, x, width, dst);
+}
+
+// 左右按夹取各补 radius 个像素
+void padRow(const quint32 *src, int width, int radius, quint32 *dst)
+{
+    for (int i = 0; i < radius; ++i) {
+        dst[i] = src[0];
+        dst[radius + width + i] = src[width - 1];
+    }
+    std::memcpy(dst + radius, src, size_t(width) * 4);
+}
+
+bool isRgb32Family(QImage::Format format)
+{
+    return format == QImage::Format_RGB32 || format == QImage::Format_ARGB32 ||
+           format == QImage::Format_ARGB32_Premultiplied;
+}
+
+} // namespace
+
+template <int N>
+ConvolutionKernel<N> ConvolutionKernel<N>::fromMatrix(const QVector<QVector<qreal>> &matrix)
+{
+    ConvolutionKernel<N> kernel;
+    for (int y = 0; y < N; ++y) {
+        for (int x = 0; x < N; ++x) {
+            qreal w = (y < matrix.size() && x < matrix[y].size()) ? matrix[y][x] : 0.0;
+            qreal fixed = qBound(-32768.0, w * (1 << ConvolutionEngine::FractionBits), 32767.0);
+            kernel.weights[y * N + x] = qint16(qRound(fixed));
+        }
+    }
+    return kernel;
+}
+
+template <int N>
+void ConvolutionEngine::convolveRows(const QImage &src, uchar *dst, int dstBytesPerLine,
+                                     const ConvolutionKernel<N> &kernel, int firstRow, int lastRow)
+{
+    const int R = N / 2;
+    const int width = src.width();
+    const int height = src.height();
+    const int stride = width + 2 * R + 8;      // 尾部留余量，SIMD 读越界也落在缓冲内
+
+    // N 行补过边的环形缓冲：第 i 行放在 i mod N，下移一行只补一行新的
+    QVector<quint32> ring(stride * N);
+    auto slotOf = [](int i) { return ((i % N) + N) % N; };
+    auto fill = [&](int i) {
+        const int sy = qBound(0, i, height - 1);
+        padRow(reinterpret_cast<const quint32 *>(src.constScanLine(sy)), width, R,
+               ring.data() + slotOf(i) * stride);
+    };
+
+    for (int i = firstRow - R; i < firstRow + R; ++i) {
+        fill(i);
+    }
+
+    const quint32 *rows[N];
+    for (int y = firstRow; y < lastRow; ++y) {
+        fill(y + R);
+        for (int k = 0; k < N; ++k) {
+            rows[k] = ring.constData() + slotOf(y + k - R) * stride;
+        }
+        convolveRow<N>(rows, kernel.weights, width,
+                       reinterpret_cast<quint32 *>(dst + y * dstBytesPerLine));
+    }
+}
+
+template <int N>
+QImage ConvolutionEngine::convolve(const QImage &image, const ConvolutionKernel<N> &kernel)
+{
+    if (image.isNull()) {
+        return image;
+    }
+
+    QImage src = isRgb32Family(image.format()) ? image : image.convertToFormat(QImage::Format_RGB32);
+    QImage result(src.size(), src.format());
+    uchar *dst = result.bits();
+    const int dstBytesPerLine = result.bytesPerLine();
+    TileScheduler::forEachStrip(src, N / 2, [&](int firstRow, int lastRow) {
+        convolveRows<N>(src, dst, dstBytesPerLine, kernel, firstRow, lastRow);
+    });
+    return result;
+}
+
+const char *ConvolutionEngine::backendName()
+{
+#if defined(SIMD_USE_AVX2)
+    return "avx2";
+#elif defined(SIMD_USE_SSE2)
+    return "sse2";
+#elif defined(SIMD_USE_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+
+template struct ConvolutionKernel<3>;
+template struct ConvolutionKernel<5>;
+template QImage ConvolutionEngine::convolve<3>(const QImage &, const ConvolutionKernel<3> &);
+template QImage ConvolutionEngine::convolve<5>(const QImage &, const ConvolutionKernel<5> &);
+template void ConvolutionEngine::convolveRows<3>(const QImage &, uchar *, int, const ConvolutionKernel<3> &, int, int);
+template void ConvolutionEngine::convolveRows<5>(const QImage &, uchar *, int, const ConvolutionKernel<5> &, int, int);
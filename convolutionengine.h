@@ -0,0 +1,39 @@
+#ifndef CONVOLUTIONENGINE_H
+#define CONVOLUTIONENGINE_H
+
+#include <QImage>
+#include <QVector>
+
+// 定点卷积核：权重为 Q8（实际权重 × 256）的 int16
+template <int N>
+struct ConvolutionKernel {
+    static_assert(N % 2 == 1, "kernel size must be odd");
+    enum { Size = N, Radius = N / 2, Taps = N * N };
+
+    qint16 weights[N * N];
+
+    static ConvolutionKernel fromMatrix(const QVector<QVector<qreal>> &matrix);
+};
+
+// 固定尺寸卷积引擎
+// 整行处理 ARGB32：x86 上用 SSE2/AVX2，aarch64 上用 NEON，其余走标量；
+// 所有路径结果逐位一致：acc = Σ w·p（int32），out = clamp(acc >> 8, 0, 255)，alpha 置 255。
+// 边缘像素按夹取延伸，不再留黑边。按行条带并行（TileScheduler）。
+class ConvolutionEngine
+{
+public:
+    static const int FractionBits = 8;
+
+    template <int N>
+    static QImage convolve(const QImage &image, const ConvolutionKernel<N> &kernel);
+
+    // 只处理 [firstRow, lastRow) 行，给分块并行用；dst 为与 src 同尺寸的 32 位像素数据
+    template <int N>
+    static void convolveRows(const QImage &src, uchar *dst, int dstBytesPerLine,
+                             const ConvolutionKernel<N> &kernel, int firstRow, int lastRow);
+
+    // 当前编译启用的指令集，调试输出用
+    static const char *backendName();
+};
+
+#endif // CONVOLUTIONENGINE_H
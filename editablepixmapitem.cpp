@@ -4,6 +4,8 @@
 #include <QPainter>
 #include <QApplication>
 #include <QDebug>
+#include <QStyleOptionGraphicsItem>
+#include <QtMath>
 #include <cmath>
 
 EditablePixmapItem::EditablePixmapItem(const QPixmap &pixmap, QGraphicsItem *parent)
@@ -18,6 +20,16 @@ EditablePixmapItem::EditablePixmapItem(const QPixmap &pixmap, QGraphicsItem *par
     setFlag(QGraphicsItem::ItemIsMovable, true);
     setFlag(QGraphicsItem::ItemSendsGeometryChanges, true);
     setAcceptHoverEvents(true);
+
+    if (!pixmap.isNull()) {
+        mipLevels.setImage(pixmap.toImage());
+    }
+}
+
+EditablePixmapItem::EditablePixmapItem(const QImage &source, qreal displayScale, QGraphicsItem *parent)
+    : EditablePixmapItem(QPixmap(), parent)
+{
+    setSourceImage(source, displayScale);
 }
 
 void EditablePixmapItem::setSelected(bool selected)
@@ -47,9 +59,127 @@ void EditablePixmapItem::scale(qreal factor)
 
 void EditablePixmapItem::crop(const QRect &rect)
 {
-    QPixmap original = pixmap();
-    QPixmap cropped = original.copy(rect);
-    setPixmap(cropped);
+    if (mipLevels.isEmpty()) {
+        setPixmap(pixmap().copy(rect));
+        return;
+    }
+
+    // rect 为代理图坐标，换算到原图上裁剪
+    const qreal scale = sourceScale();
+    const QImage source = sourceImage();
+    const QRect sourceRect = QRectF(rect.x() / scale, rect.y() / scale,
+                                    rect.width() / scale, rect.height() / scale)
+                                 .toAlignedRect().intersected(source.rect());
+    setSourceImage(source.copy(sourceRect), scale);
+}
+
+void EditablePixmapItem::setSourceImage(const QImage &image, qreal displayScale)
+{
+    mipLevels.setImage(image);
+    mipPixmaps.clear();
+    setDisplayScale(displayScale);
+}
+
+// 从金字塔里宽度最接近的一级缩放出代理图，不从已经缩小的代理再缩
+void EditablePixmapItem::setDisplayScale(qreal displayScale)
+{
+    if (mipLevels.isEmpty()) {
+        return;
+    }
+    const QSize target = (QSizeF(mipLevels.source().size()) * displayScale).toSize().expandedTo(QSize(1, 1));
+    const QImage &level = mipLevels.level(mipLevels.levelForWidth(target.width()));
+    if (level.size() == target) {
+        setPixmap(QPixmap::fromImage(level));
+    } else {
+        setPixmap(QPixmap::fromImage(level.scaled(target, Qt::IgnoreAspectRatio, Qt::SmoothTransformation)));
+    }
+}
+
+qreal EditablePixmapItem::sourceScale() const
+{
+    if (mipLevels.isEmpty() || mipLevels.source().width() == 0) {
+        return 1.0;
+    }
+    return qreal(pixmap().width()) / mipLevels.source().width();
+}
+
+void EditablePixmapItem::fitToSize(const QSizeF &size)
+{
+    if (mipLevels.isEmpty()) {
+        setPixmap(pixmap().scaled(size.toSize(), Qt::KeepAspectRatio, Qt::SmoothTransformation));
+        return;
+    }
+    const QSize source = mipLevels.source().size();
+    setDisplayScale(qMin(size.width() / source.width(), size.height() / source.height()));
+}
+
+// 按绘制比例 lod（设备像素 / 图元单位）需要的金字塔级别；代理图本身就够用时返回 -1
+int EditablePixmapItem::sourceLevelFor(qreal lod) const
+{
+    if (mipLevels.isEmpty() || pixmap().isNull()) {
+        return -1;
+    }
+    const int needed = qCeil(pixmap().width() * lod);
+    if (needed <= pixmap().width()) {
+        return -1;
+    }
+    const int level = mipLevels.levelForWidth(needed);
+    return mipLevels.level(level).width() > pixmap().width() ? level : -1;
+}
+
+// 导出用：按 lod 取图像，*imageToItem 为图像像素到图元坐标的变换
+QImage EditablePixmapItem::imageForScale(qreal lod, QTransform *imageToItem) const
+{
+    const int level = sourceLevelFor(lod);
+    const QImage image = level >= 0 ? mipLevels.level(level) : pixmap().toImage();
+    if (imageToItem && !image.isNull()) {
+        *imageToItem = QTransform::fromScale(qreal(pixmap().width()) / image.width(),
+                                             qreal(pixmap().height()) / image.height()) *
+                       QTransform::fromTranslate(offset().x(), offset().y());
+    }
+    return image;
+}
+
+// 绘制比例超过代理图的分辨率时（放大查看、高清导出），改用金字塔里够大的一级画到同样的位置。
+// 离屏绘制（widget 为空，如 scene->render 导出）直接画 QImage，不为一次性的导出转换 QPixmap
+bool EditablePixmapItem::paintSourceLevel(QPainter *painter, QWidget *widget)
+{
+    const qreal lod = QStyleOptionGraphicsItem::levelOfDetailFromTransform(painter->worldTransform());
+    const int level = sourceLevelFor(lod);
+    if (level < 0) {
+        return false;
+    }
+
+    const QRectF target(offset(), QSizeF(pixmap().size()));
+    painter->save();
+    painter->setRenderHint(QPainter::SmoothPixmapTransform, true);
+    if (!widget) {
+        painter->drawImage(target, mipLevels.level(level));
+    } else {
+        if (mipPixmaps.size() < mipLevels.levelCount()) {
+            mipPixmaps.resize(mipLevels.levelCount());
+        }
+        if (mipPixmaps.at(level).isNull()) {
+            mipPixmaps[level] = QPixmap::fromImage(mipLevels.level(level));
+        }
+        painter->drawPixmap(target, mipPixmaps.at(level), QRectF(mipPixmaps.at(level).rect()));
+    }
+    painter->restore();
+    return true;
+}
+
+void EditablePixmapItem::setPreview(const QPixmap &preview)
+{
+    previewPixmap = preview;
+    update();
+}
+
+void EditablePixmapItem::clearPreview()
+{
+    if (!previewPixmap.isNull()) {
+        previewPixmap = QPixmap();
+        update();
+    }
 }
 
 QRectF EditablePixmapItem::boundingRect() const
@@ -65,7 +195,17 @@ QRectF EditablePixmapItem::boundingRect() const
 
 void EditablePixmapItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
 {
-    QGraphicsPixmapItem::paint(painter, option, widget);
+    if (previewPixmap.isNull()) {
+        if (!paintSourceLevel(painter, widget)) {
+            QGraphicsPixmapItem::paint(painter, option, widget);
+        }
+    } else {
+        painter->save();
+        painter->setRenderHint(QPainter::SmoothPixmapTransform, true);
+        painter->drawPixmap(QRectF(offset(), QSizeF(pixmap().size())), previewPixmap,
+                            QRectF(previewPixmap.rect()));
+        painter->restore();
+    }
 
     if (selected && editable) {
         // 绘制选择边框
@@ -6,6 +6,7 @@
 #include <QGraphicsPixmapItem>
 #include <QGraphicsSceneMouseEvent>
 #include <QPainter>
+#include "mippyramid.h"
 
 class EditablePixmapItem : public QObject, public QGraphicsPixmapItem
 {
@@ -13,6 +14,8 @@ class EditablePixmapItem : public QObject, public QGraphicsPixmapItem
 
 public:
     explicit EditablePixmapItem(const QPixmap &pixmap, QGraphicsItem *parent = nullptr);
+    // 保存原图，场景里只放按 displayScale 缩小的代理
+    EditablePixmapItem(const QImage &source, qreal displayScale, QGraphicsItem *parent = nullptr);
 
     enum { Type = UserType + 1 };
     int type() const override { return Type; }
@@ -28,6 +31,19 @@ public:
     void scale(qreal factor);
     void crop(const QRect &rect);
 
+    // 原图与显示代理：pixmap() 是布局用的代理图，放大查看或导出时按绘制比例从原图金字塔取合适的一级
+    void setSourceImage(const QImage &image, qreal displayScale = 1.0);
+    QImage sourceImage() const { return mipLevels.isEmpty() ? QImage() : mipLevels.source(); }
+    void setDisplayScale(qreal displayScale);
+    qreal sourceScale() const;      // pixmap() 相对原图的比例
+    void fitToSize(const QSizeF &size);
+    QImage imageForScale(qreal lod, QTransform *imageToItem) const;
+
+    // 交互预览：用缩小的代理图临时代替显示（按 pixmap() 的尺寸拉伸绘制），不改动 pixmap()
+    void setPreview(const QPixmap &preview);
+    void clearPreview();
+    bool hasPreview() const { return !previewPixmap.isNull(); }
+
     QRectF boundingRect() const override;
     void paint(QPainter *painter, const QStyleOptionGraphicsItem *option,
                QWidget *widget = nullptr) override;
@@ -53,6 +69,9 @@ private:
     QPointF itemStartPos;
     qreal itemStartRotation;
     QRectF selectionRect;
+    QPixmap previewPixmap;
+    MipPyramid mipLevels;
+    QVector<QPixmap> mipPixmaps;    // 屏幕绘制用到过的级别
 
     // 控制点
     enum ControlPoint { None, TopLeft, TopRight, BottomLeft, BottomRight, Rotate };
@@ -61,6 +80,8 @@ private:
     QRectF getControlPointRect(ControlPoint point) const;
     ControlPoint getControlPointAt(const QPointF &pos) const;
     void updateCursor(const QPointF &pos);
+    int sourceLevelFor(qreal lod) const;
+    bool paintSourceLevel(QPainter *painter, QWidget *widget);
     //atan2(qreal, qreal);
 };
 
@@ -0,0 +1,271 @@
+#include "edithistory.h"
+#include "tilescheduler.h"
+#include <QtMath>
+#include <climits>
+#include <cmath>
+#include <cstring>
+
+EditOperation EditOperation::crop(const QRectF &normalizedRect)
+{
+    EditOperation op;
+    op.type = Crop;
+    op.rect = normalizedRect;
+    return op;
+}
+
+EditOperation EditOperation::rotate(qreal degrees)
+{
+    EditOperation op;
+    op.type = Rotate;
+    op.angle = degrees;
+    return op;
+}
+
+EditOperation EditOperation::filter(const QVector<FilterParams> &chain)
+{
+    EditOperation op;
+    op.type = Filter;
+    op.chain = chain;
+    return op;
+}
+
+TiledSnapshot::TiledSnapshot(const QImage &image, const TiledSnapshot *base)
+    : m_size(image.size())
+    , m_format(image.format())
+    , m_columns((image.width() + TileSize - 1) / TileSize)
+    , m_bytes(0)
+{
+    const int rows = (image.height() + TileSize - 1) / TileSize;
+    m_tiles.resize(m_columns * rows);
+    if (m_tiles.isEmpty()) {
+        return;
+    }
+
+    const bool canShare = base && base->m_size == m_size && base->m_format == m_format;
+    const int bytesPerPixel = image.depth() / 8;
+    QImage *tiles = m_tiles.data();
+
+    TileScheduler::parallelFor(m_tiles.size(), [&](int i) {
+        const QRect rect = QRect((i % m_columns) * TileSize, (i / m_columns) * TileSize,
+                                 TileSize, TileSize).intersected(image.rect());
+        if (canShare) {
+            const QImage &old = base->m_tiles.at(i);
+            bool same = true;
+            for (int y = 0; y < rect.height() && same; ++y) {
+                same = std::memcmp(image.constScanLine(rect.y() + y) + rect.x() * bytesPerPixel,
+                                   old.constScanLine(y), size_t(rect.width()) * bytesPerPixel) == 0;
+            }
+            if (same) {
+                tiles[i] = old;
+                return;
+            }
+        }
+        tiles[i] = image.copy(rect);
+    });
+
+    for (const QImage &tile : m_tiles) {
+        m_bytes += qint64(tile.bytesPerLine()) * tile.height();
+    }
+}
+
+QImage TiledSnapshot::toImage() const
+{
+    QImage image(m_size, m_format);
+    if (image.isNull()) {
+        return image;
+    }
+
+    const int bytesPerPixel = image.depth() / 8;
+    uchar *bits = image.bits();
+    const int bytesPerLine = image.bytesPerLine();
+    TileScheduler::parallelFor(m_tiles.size(), [&](int i) {
+        const QImage &tile = m_tiles.at(i);
+        const int x = (i % m_columns) * TileSize;
+        const int y = (i / m_columns) * TileSize;
+        for (int row = 0; row < tile.height(); ++row) {
+            std::memcpy(bits + (y + row) * bytesPerLine + x * bytesPerPixel,
+                        tile.constScanLine(row), size_t(tile.width()) * bytesPerPixel);
+        }
+    });
+    return image;
+}
+
+CheckpointStore::CheckpointStore(qint64 bytes)
+{
+    setBudget(bytes);
+}
+
+void CheckpointStore::setBudget(qint64 bytes)
+{
+    m_checkpoints.setMaxCost(int(qBound<qint64>(0, bytes / 1024, INT_MAX)));
+}
+
+EditHistory::EditHistory(const QImage &source, CheckpointStore *store)
+    : m_source(ImageEditor::toWorkingFormat(source))
+    , m_position(0)
+    , m_ownStore(store ? nullptr : new CheckpointStore)
+    , m_store(store ? store : m_ownStore.data())
+    , m_current(m_source)
+    , m_currentPosition(0)
+{
+}
+
+// 共用的存储里不能留下以本对象地址为键的检查点
+EditHistory::~EditHistory()
+{
+    for (int position = 1; position <= m_operations.size(); ++position) {
+        removeCheckpoint(position);
+    }
+}
+
+void EditHistory::push(const EditOperation &op, const QImage &result)
+{
+    discardRedo();
+
+    // 紧接着上一次旋转的旋转不在当前图像上再转，由 render() 从这一串旋转之前的图像一次转到累计角度
+    if (op.type == EditOperation::Rotate && result.isNull() && m_position > 0 &&
+        m_operations.last().type == EditOperation::Rotate) {
+        m_operations.append(op);
+        ++m_position;
+        m_current = render(m_position);
+        m_currentPosition = m_position;
+        return;
+    }
+
+    const QImage before = result.isNull() ? current() : QImage();
+    m_operations.append(op);
+    ++m_position;
+    m_current = result.isNull() ? apply(before, op) : ImageEditor::toWorkingFormat(result);
+    m_currentPosition = m_position;
+    storeCheckpoint(m_position, m_current);
+}
+
+bool EditHistory::undo()
+{
+    if (!canUndo()) {
+        return false;
+    }
+    --m_position;
+    return true;
+}
+
+bool EditHistory::redo()
+{
+    if (!canRedo()) {
+        return false;
+    }
+    ++m_position;
+    return true;
+}
+
+void EditHistory::discardRedo()
+{
+    while (m_operations.size() > m_position) {
+        removeCheckpoint(m_operations.size());
+        m_operations.removeLast();
+    }
+    if (m_currentPosition > m_position) {
+        m_current = QImage();
+        m_currentPosition = -1;
+    }
+}
+
+QImage EditHistory::current()
+{
+    if (m_currentPosition != m_position) {
+        m_current = render(m_position);
+        m_currentPosition = m_position;
+    }
+    return m_current;
+}
+
+// position 处于一串连续旋转的中间（前后两步都是旋转）
+bool EditHistory::insideRotationRun(int position) const
+{
+    return position > 0 && position < m_operations.size() &&
+           m_operations.at(position - 1).type == EditOperation::Rotate &&
+           m_operations.at(position).type == EditOperation::Rotate;
+}
+
+// 从最近的检查点（最差是原图）开始重放，途中的每一步都存成检查点。
+// 连续的旋转从这一串之前的图像按累计角度只转一次，所以不能从一串旋转中间的检查点接着转
+QImage EditHistory::render(int position)
+{
+    if (position == m_currentPosition) {
+        return m_current;
+    }
+
+    int start = position;
+    QImage image;
+    while (start > 0) {
+        const TiledSnapshot *snapshot = nullptr;
+        if (start == position || !insideRotationRun(start)) {
+            snapshot = checkpoint(start);
+        }
+        if (snapshot) {
+            image = snapshot->toImage();
+            break;
+        }
+        --start;
+    }
+    if (start == 0) {
+        image = m_source;
+    }
+
+    for (int i = start; i < position; ++i) {
+        if (m_operations.at(i).type != EditOperation::Rotate) {
+            image = apply(image, m_operations.at(i));
+        } else {
+            qreal angle = 0.0;
+            for (; i < position && m_operations.at(i).type == EditOperation::Rotate; ++i) {
+                angle += m_operations.at(i).angle;
+            }
+            --i;
+            angle = std::fmod(angle, 360.0);
+            if (!qFuzzyIsNull(angle)) {
+                image = apply(image, EditOperation::rotate(angle));
+            }
+        }
+        storeCheckpoint(i + 1, image);
+    }
+    return image;
+}
+
+const TiledSnapshot *EditHistory::checkpoint(int position) const
+{
+    return m_store->m_checkpoints.object(CheckpointStore::Key(this, position));
+}
+
+void EditHistory::storeCheckpoint(int position, const QImage &image)
+{
+    TiledSnapshot *snapshot = new TiledSnapshot(image, checkpoint(position - 1));
+    m_store->m_checkpoints.insert(CheckpointStore::Key(this, position), snapshot,
+                                  int(qMax<qint64>(1, snapshot->bytes() / 1024)));
+}
+
+void EditHistory::removeCheckpoint(int position)
+{
+    m_store->m_checkpoints.remove(CheckpointStore::Key(this, position));
+}
+
+QImage EditHistory::apply(const QImage &image, const EditOperation &op)
+{
+    switch (op.type) {
+    case EditOperation::Crop: {
+        const QRect rect = QRectF(op.rect.x() * image.width(), op.rect.y() * image.height(),
+                                  op.rect.width() * image.width(),
+                                  op.rect.height() * image.height()).toAlignedRect();
+        return ImageEditor::cropImage(image, rect);
+    }
+    case EditOperation::Rotate:
+        return ImageEditor::rotateImage(image, op.angle);
+    case EditOperation::Filter: {
+        QImage result = image;
+        for (const FilterParams &params : op.chain) {
+            result = ImageEditor::applyFilterWithParams(result, params);
+        }
+        return result;
+    }
+    }
+    return image;
+}
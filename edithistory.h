@@ -0,0 +1,116 @@
+#ifndef EDITHISTORY_H
+#define EDITHISTORY_H
+
+#include "imageeditor.h"
+#include <QImage>
+#include <QVector>
+#include <QCache>
+#include <QRectF>
+#include <QPair>
+#include <QScopedPointer>
+
+// 一步编辑操作，只记参数，图像由原图重放得到
+struct EditOperation {
+    enum Type { Crop, Rotate, Filter };
+
+    Type type;
+    QRectF rect;                    // 裁剪区域，相对操作前图像的比例坐标 (0-1)
+    qreal angle;                    // 旋转角度（度）
+    QVector<FilterParams> chain;    // 滤镜链
+
+    EditOperation() : type(Filter), angle(0.0) {}
+
+    static EditOperation crop(const QRectF &normalizedRect);
+    static EditOperation rotate(qreal degrees);
+    static EditOperation filter(const QVector<FilterParams> &chain);
+};
+
+// 按 256x256 瓦片保存的图像快照。
+// 与前一个快照尺寸相同时，内容没变的瓦片直接共享前一个快照的（QImage 隐式共享，写时复制），
+// 只改了局部的编辑只多占改动部分的内存。
+// 计费按全部瓦片算：共享的瓦片在前一个快照被淘汰后仍靠引用计数活着，只算自己那部分会漏账
+class TiledSnapshot
+{
+public:
+    enum { TileSize = 256 };
+
+    TiledSnapshot(const QImage &image, const TiledSnapshot *base = nullptr);
+
+    QImage toImage() const;
+    QSize size() const { return m_size; }
+    qint64 bytes() const { return m_bytes; }         // 全部瓦片所占字节，含和 base 共享的
+
+private:
+    QSize m_size;
+    QImage::Format m_format;
+    int m_columns;
+    QVector<QImage> m_tiles;
+    qint64 m_bytes;
+};
+
+class EditHistory;
+
+// 检查点存储：多张图片的编辑历史共用一个按字节计费的 QCache，
+// 总预算由持有者（MainWindow）设定，超出时跨图片淘汰最久未用的检查点
+class CheckpointStore
+{
+public:
+    explicit CheckpointStore(qint64 bytes = 256LL * 1024 * 1024);
+
+    void setBudget(qint64 bytes);
+
+private:
+    friend class EditHistory;
+    typedef QPair<const EditHistory *, int> Key;     // 所属历史、操作位置
+
+    QCache<Key, TiledSnapshot> m_checkpoints;       // cost 为 KB
+};
+
+// 单张图片的编辑历史
+// 操作按参数记录在原图之上，撤销/重做只移动位置；需要图像时从不超过当前位置的最近检查点开始重放。
+// 检查点是瓦片快照，放在共用的 CheckpointStore 里，超出预算时淘汰最久未用的（原图始终保留）。
+// 每次旋转各算一步（撤销一次退一次旋转），重放时连续的旋转按累计角度只转一次，
+// 转回原角度的直接抵消，多次旋转不会反复插值变糊、变大
+class EditHistory
+{
+public:
+    // store 为空时使用自己的默认预算存储
+    explicit EditHistory(const QImage &source, CheckpointStore *store = nullptr);
+    ~EditHistory();
+
+    // 记录一步操作；result 为调用方已经算好的结果（如预览的全分辨率渲染），为空则现算
+    void push(const EditOperation &op, const QImage &result = QImage());
+
+    bool canUndo() const { return m_position > 0; }
+    bool canRedo() const { return m_position < m_operations.size(); }
+    bool undo();
+    bool redo();
+    void discardRedo();
+
+    QImage current();
+    const QImage &source() const { return m_source; }
+    int position() const { return m_position; }
+    const QVector<EditOperation> &operations() const { return m_operations; }
+
+    static QImage apply(const QImage &image, const EditOperation &op);
+
+private:
+    QImage render(int position);
+    bool insideRotationRun(int position) const;
+    const TiledSnapshot *checkpoint(int position) const;
+    void storeCheckpoint(int position, const QImage &image);
+    void removeCheckpoint(int position);
+
+    QImage m_source;
+    QVector<EditOperation> m_operations;
+    int m_position;
+
+    QScopedPointer<CheckpointStore> m_ownStore;
+    CheckpointStore *m_store;                    // 键为 (this, 操作位置)，位置即执行完前 n 步
+    QImage m_current;                           // 最近一次渲染的结果
+    int m_currentPosition;
+
+    Q_DISABLE_COPY(EditHistory)
+};
+
+#endif // EDITHISTORY_H
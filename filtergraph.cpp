@@ -0,0 +1,599 @@
+#include "filtergraph.h"
+#include "convolutionengine.h"
+#include "maskcache.h"
+#include "tilescheduler.h"
+#include <QtMath>
+#include <QDebug>
+#include <cstring>
+
+namespace {
+
+const qint64 kDefaultPoolLimit = 128LL * 1024 * 1024;
+
+inline qint64 imageBytes(const QImage &image)
+{
+    return qint64(image.bytesPerLine()) * image.height();
+}
+
+// 叠加图、遮罩与当前结果尺寸不同时，按 blendImages 的方式铺满后裁到同样大小
+QImage fitTo(const QImage &image, const QSize &size, Qt::AspectRatioMode mode)
+{
+    if (image.size() == size) {
+        return image;
+    }
+    return image.scaled(size, mode, Qt::SmoothTransformation).copy(QRect(QPoint(0, 0), size));
+}
+
+} // namespace
+
+FilterGraph::FilterGraph()
+    : m_poolLimit(kDefaultPoolLimit)
+{
+    clear();
+}
+
+FilterGraph::Node FilterGraph::apply(Node in, const FilterParams &params)
+{
+    Node node = in;
+
+    // 首先应用调整
+    if (params.adjust.brightness != 0.0 || params.adjust.contrast != 0.0 ||
+        params.adjust.saturation != 0.0 || params.adjust.temperature != 0.0) {
+        node = adjust(node, params.adjust);
+    }
+
+    // 然后应用滤镜
+    if (params.type != FILTER_NONE) {
+        node = filter(node, params.type, params.intensity);
+    }
+    return node;
+}
+
+void FilterGraph::clear()
+{
+    m_nodes.clear();
+    m_nodes.append(NodeData());     // 0 号节点为输入
+}
+
+FilterGraph::Node FilterGraph::addNode(const NodeData &data)
+{
+    if (data.in < 0 || data.in >= m_nodes.size() ||
+        data.other >= m_nodes.size()) {
+        qWarning() << "FilterGraph: 无效的输入节点" << data.in << data.other;
+        return input();
+    }
+    m_nodes.append(data);
+    return m_nodes.size() - 1;
+}
+
+FilterGraph::Node FilterGraph::adjust(Node in, const AdjustParams &params)
+{
+    NodeData d;
+    d.kind = AdjustNode;
+    d.in = in;
+    d.adjust = params;
+    return addNode(d);
+}
+
+FilterGraph::Node FilterGraph::lut(Node in, const ColorLut &table)
+{
+    NodeData d;
+    d.kind = LutNode;
+    d.in = in;
+    d.table = table;
+    return addNode(d);
+}
+
+FilterGraph::Node FilterGraph::vignette(Node in, qreal intensity, const QColor &color)
+{
+    NodeData d;
+    d.kind = VignetteNode;
+    d.in = in;
+    d.amount = intensity;
+    d.color = color;
+    return addNode(d);
+}
+
+FilterGraph::Node FilterGraph::mask(Node in, const QImage &coverage)
+{
+    NodeData d;
+    d.kind = MaskNode;
+    d.in = in;
+    d.image = coverage;
+    return addNode(d);
+}
+
+FilterGraph::Node FilterGraph::blend(Node base, Node overlay, qreal opacity, BlendMode mode)
+{
+    NodeData d;
+    d.kind = BlendNode;
+    d.in = base;
+    d.other = overlay;
+    d.amount = opacity;
+    d.mode = mode;
+    return addNode(d);
+}
+
+FilterGraph::Node FilterGraph::mix(Node base, Node other, const MixFunction &fn)
+{
+    NodeData d;
+    d.kind = MixNode;
+    d.in = base;
+    d.other = other;
+    d.mixFn = fn;
+    return addNode(d);
+}
+
+FilterGraph::Node FilterGraph::convolve(Node in, const QVector<QVector<qreal>> &kernel)
+{
+    NodeData d;
+    d.kind = ConvolveNode;
+    d.in = in;
+    d.kernel = kernel;
+    return addNode(d);
+}
+
+FilterGraph::Node FilterGraph::blur(Node in, int radius)
+{
+    NodeData d;
+    d.kind = BlurNode;
+    d.in = in;
+    d.radius = radius;
+    return addNode(d);
+}
+
+FilterGraph::Node FilterGraph::filter(Node in, FilterType type, qreal intensity)
+{
+    NodeData d;
+    d.kind = FilterNode;
+    d.in = in;
+    d.filter = type;
+    d.amount = intensity;
+    return addNode(d);
+}
+
+void FilterGraph::setPoolLimit(qint64 bytes)
+{
+    m_poolLimit = bytes;
+    qint64 total = 0;
+    for (int i = 0; i < m_pool.size(); ++i) {
+        total += imageBytes(m_pool.at(i));
+        if (total > m_poolLimit) {
+            m_pool.resize(i);
+            break;
+        }
+    }
+}
+
+void FilterGraph::releasePool()
+{
+    m_pool.clear();
+}
+
+QImage FilterGraph::evaluate(const QImage &source, Node output)
+{
+    if (source.isNull() || output < 0 || output >= m_nodes.size()) {
+        return source;
+    }
+
+    m_source = ImageEditor::toWorkingFormat(source);
+
+    // 只统计从 output 可达的节点被引用的次数；output 本身多算一次（调用者持有）
+    m_consumers.fill(0, m_nodes.size());
+    QVector<bool> visited(m_nodes.size(), false);
+    QVector<Node> pending;
+    pending.append(output);
+    while (!pending.isEmpty()) {
+        const Node n = pending.takeLast();
+        if (visited.at(n)) {
+            continue;
+        }
+        visited[n] = true;
+        const NodeData &d = m_nodes.at(n);
+        if (d.in >= 0) {
+            ++m_consumers[d.in];
+            pending.append(d.in);
+        }
+        if (d.other >= 0) {
+            ++m_consumers[d.other];
+            pending.append(d.other);
+        }
+    }
+    ++m_consumers[output];
+
+    QImage result = materialize(output);
+
+    m_cache.clear();
+    m_consumers.clear();
+    m_source = QImage();
+    return result;
+}
+
+bool FilterGraph::isPointNode(Node n) const
+{
+    const NodeData &d = m_nodes.at(n);
+    switch (d.kind) {
+    case AdjustNode:
+    case LutNode:
+    case VignetteNode:
+    case MaskNode:
+    case BlendNode:
+    case MixNode:
+        return true;
+    case FilterNode: {
+        ColorLut table;
+        return d.filter == FILTER_NONE || ImageEditor::pointFilterLut(d.filter, d.amount, &table);
+    }
+    default:
+        return false;
+    }
+}
+
+QImage FilterGraph::materialize(Node n)
+{
+    if (m_cache.contains(n)) {
+        return m_cache.value(n);
+    }
+
+    QImage image;
+    if (isPointNode(n)) {
+        Stage stage = build(n);
+        image = run(stage);
+    } else {
+        image = compute(n);
+    }
+
+    if (m_consumers.at(n) > 1) {
+        m_cache.insert(n, image);
+    }
+    return image;
+}
+
+void FilterGraph::release(Node n)
+{
+    if (--m_consumers[n] == 0) {
+        QImage image = m_cache.take(n);
+        recycle(image);
+    }
+}
+
+// 单一使用者的输入直接接进当前阶段继续融合；被多处引用的先物化（只算一次）
+FilterGraph::Stage FilterGraph::stageFor(Node in)
+{
+    if (m_consumers.at(in) > 1) {
+        Stage stage;
+        stage.buffer = materialize(in);
+        stage.uses.append(in);
+        return stage;
+    }
+    return build(in);
+}
+
+FilterGraph::Stage FilterGraph::build(Node n)
+{
+    const NodeData &d = m_nodes.at(n);
+
+    if (!isPointNode(n)) {
+        Stage stage;
+        stage.buffer = compute(n);
+        stage.owned = n != input();
+        return stage;
+    }
+
+    Stage stage = stageFor(d.in);
+    Op op;
+    switch (d.kind) {
+    case AdjustNode:
+        if (!ImageEditor::hasAdjustments(d.adjust)) {
+            return stage;
+        }
+        op.type = Op::AdjustOp;
+        op.adjust = d.adjust;
+        break;
+    case LutNode:
+        if (d.table.isIdentity()) {
+            return stage;
+        }
+        op.type = Op::LutOp;
+        op.table = d.table;
+        break;
+    case FilterNode:
+        if (!ImageEditor::pointFilterLut(d.filter, d.amount, &op.table)) {
+            return stage;       // FILTER_NONE
+        }
+        op.type = Op::LutOp;
+        break;
+    case VignetteNode:
+        op.type = Op::VignetteOp;
+        op.amount = d.amount;
+        op.color = d.color;
+        break;
+    case MaskNode:
+        op.type = Op::MaskOp;
+        op.other = d.image;
+        break;
+    case BlendNode:
+    case MixNode: {
+        op.type = d.kind == BlendNode ? Op::BlendOp : Op::MixOp;
+        op.amount = d.amount;
+        op.mode = d.mode;
+        op.mixFn = d.mixFn;
+        bool shared = false;
+        op.other = inputImage(d.other, &shared);
+        op.otherOwned = !shared && d.other != input();
+        if (shared) {
+            stage.uses.append(d.other);
+        }
+        break;
+    }
+    default:
+        break;
+    }
+    stage.ops.append(op);
+    return stage;
+}
+
+// 物化一个输入；*shared 为 true 时结果在缓存里，用完要 release
+QImage FilterGraph::inputImage(Node in, bool *shared)
+{
+    *shared = m_consumers.at(in) > 1;
+    if (*shared) {
+        return materialize(in);
+    }
+    Stage stage = build(in);
+    return run(stage);
+}
+
+// 邻域节点：读入整张输入，输出新的整张图
+QImage FilterGraph::compute(Node n)
+{
+    const NodeData &d = m_nodes.at(n);
+    if (d.kind == InputNode) {
+        return m_source;
+    }
+
+    bool shared = false;
+    QImage src = inputImage(d.in, &shared);
+    const bool owned = !shared && d.in != input();
+    QImage result;
+
+    switch (d.kind) {
+    case ConvolveNode: {
+        const int size = d.kernel.size();
+        if (size == 3 || size == 5) {
+            result = acquire(src.size());
+            uchar *bits = result.bits();
+            const int bytesPerLine = result.bytesPerLine();
+            if (size == 3) {
+                const ConvolutionKernel<3> kernel = ConvolutionKernel<3>::fromMatrix(d.kernel);
+                TileScheduler::forEachStrip(result, 1, [&](int firstRow, int lastRow) {
+                    ConvolutionEngine::convolveRows(src, bits, bytesPerLine, kernel, firstRow, lastRow);
+                });
+            } else {
+                const ConvolutionKernel<5> kernel = ConvolutionKernel<5>::fromMatrix(d.kernel);
+                TileScheduler::forEachStrip(result, 2, [&](int firstRow, int lastRow) {
+                    ConvolutionEngine::convolveRows(src, bits, bytesPerLine, kernel, firstRow, lastRow);
+                });
+            }
+        } else {
+            result = ImageEditor::applyConvolution(src, d.kernel);
+        }
+        break;
+    }
+    case BlurNode:
+        result = ImageEditor::applyBlurFilter(src, d.radius);
+        break;
+    case FilterNode:
+        // 独占的输入直接原地处理
+        result = src;
+        src = QImage();
+        ImageEditor::applyFilterInPlace(result, d.filter, d.amount);
+        break;
+    default:
+        result = src;
+        break;
+    }
+
+    if (shared) {
+        release(d.in);
+    } else if (owned) {
+        recycle(src);
+    }
+    return result;
+}
+
+void FilterGraph::prepare(Stage &stage, const QSize &size)
+{
+    const QImage &src = stage.buffer;
+    QVector<Op> prepared;
+
+    for (Op op : stage.ops) {
+        switch (op.type) {
+        case Op::AdjustOp: {
+            // 对比度需要本步输入的平均亮度：抽样，并让样本先经过本阶段前面的各步
+            qreal averageLuminance = 0;
+            if (qAbs(op.adjust.contrast) > 0.01) {
+                const int step = qMax(1, qRound(qSqrt(qreal(size.width()) * size.height() / 65536.0)));
+                qreal sum = 0;
+                int count = 0;
+                for (int y = 0; y < size.height(); y += step) {
+                    const QRgb *line = reinterpret_cast<const QRgb *>(src.constScanLine(y));
+                    for (int x = 0; x < size.width(); x += step) {
+                        QRgb pixel = line[x];
+                        for (const Op &before : prepared) {
+                            applyOp(before, &pixel, x, 1, y, size);
+                        }
+                        sum += ImageEditor::calculateLuminance(qUnpremultiply(pixel));
+                        ++count;
+                    }
+                }
+                averageLuminance = count > 0 ? sum / count : 0;
+            }
+            op.type = Op::LutOp;
+            op.table = ImageEditor::adjustmentLut(op.adjust, averageLuminance);
+        }
+            // fall through
+        case Op::LutOp:
+            if (!prepared.isEmpty() && prepared.last().type == Op::LutOp) {
+                prepared.last().table = prepared.last().table.then(op.table);
+                continue;
+            }
+            break;
+        case Op::MaskOp:
+            op.other = fitTo(op.other, size, Qt::IgnoreAspectRatio).convertToFormat(QImage::Format_Alpha8);
+            break;
+        case Op::BlendOp:
+            op.other = ImageEditor::toWorkingFormat(fitTo(op.other, size, Qt::KeepAspectRatioByExpanding));
+            if (op.mode != Normal) {
+                op.blendTable.resize(256 * 256);
+                uchar *table = op.blendTable.data();
+                for (int b = 0; b < 256; ++b) {
+                    for (int o = 0; o < 256; ++o) {
+                        table[b * 256 + o] = uchar(ImageEditor::blendChannel(b, o, op.mode));
+                    }
+                }
+            }
+            break;
+        case Op::MixOp:
+            op.other = ImageEditor::toWorkingFormat(fitTo(op.other, size, Qt::IgnoreAspectRatio));
+            break;
+        default:
+            break;
+        }
+        prepared.append(op);
+    }
+
+    stage.ops = prepared;
+}
+
+QImage FilterGraph::run(Stage &stage)
+{
+    if (stage.ops.isEmpty()) {
+        for (Node n : stage.uses) {
+            release(n);
+        }
+        return stage.buffer;
+    }
+
+    const QSize size = stage.buffer.size();
+    prepare(stage, size);
+
+    // 独占的中间结果原地改写；否则边拷贝边处理，写到池里的缓冲
+    QImage src = stage.buffer;
+    stage.buffer = QImage();
+    QImage dst;
+    const bool inPlace = stage.owned && src.isDetached();
+    if (inPlace) {
+        dst = src;
+        src = QImage();
+    } else {
+        dst = acquire(size);
+    }
+
+    const uchar *srcBits = inPlace ? nullptr : src.constBits();
+    const int srcBytesPerLine = inPlace ? 0 : src.bytesPerLine();
+    uchar *dstBits = dst.bits();
+    const int dstBytesPerLine = dst.bytesPerLine();
+    const int width = size.width();
+    const QVector<Op> &ops = stage.ops;
+
+    TileScheduler::forEachStrip(dst, 0, [&](int firstRow, int lastRow) {
+        for (int y = firstRow; y < lastRow; ++y) {
+            QRgb *line = reinterpret_cast<QRgb *>(dstBits + y * dstBytesPerLine);
+            if (srcBits) {
+                std::memcpy(line, srcBits + y * srcBytesPerLine, size_t(width) * 4);
+            }
+            for (const Op &op : ops) {
+                applyOp(op, line, 0, width, y, size);
+            }
+        }
+    });
+
+    for (Op &op : stage.ops) {
+        if (op.otherOwned) {
+            recycle(op.other);
+        }
+    }
+    stage.ops.clear();
+    for (Node n : stage.uses) {
+        release(n);
+    }
+    if (stage.owned) {
+        recycle(src);
+    }
+    return dst;
+}
+
+void FilterGraph::applyOp(const Op &op, QRgb *line, int x0, int count, int y, const QSize &size)
+{
+    switch (op.type) {
+    case Op::LutOp:
+        op.table.applyLine(line, count, true);
+        break;
+    case Op::VignetteOp:
+        ImageEditor::vignetteLine(line, x0, count, y, size, op.amount, op.color, true);
+        break;
+    case Op::MaskOp:
+        MaskCache::applyLine(line, op.other.constScanLine(y) + x0, count);
+        break;
+    case Op::BlendOp: {
+        const QRgb *overlay = reinterpret_cast<const QRgb *>(op.other.constScanLine(y)) + x0;
+        // Qt5 里空 QVector 的 constData() 不是空指针（指向共享的空数据），Normal 模式必须显式判空
+        const uchar *table = op.blendTable.isEmpty() ? nullptr : op.blendTable.constData();
+        const int opacity = qRound(op.amount * 256);
+        for (int i = 0; i < count; ++i) {
+            const uint overlayAlpha = qAlpha(overlay[i]);
+            if (overlayAlpha == 0) {
+                continue;
+            }
+            const QRgb raw = line[i];
+            const QRgb base = qAlpha(raw) == 255 ? raw : qUnpremultiply(raw);
+            const QRgb over = overlayAlpha == 255 ? overlay[i] : qUnpremultiply(overlay[i]);
+            const int w = int(overlayAlpha * opacity + 127) / 255;
+
+            const int br = qRed(base), bg = qGreen(base), bb = qBlue(base);
+            const int orr = table ? table[br * 256 + qRed(over)] : qRed(over);
+            const int og = table ? table[bg * 256 + qGreen(over)] : qGreen(over);
+            const int ob = table ? table[bb * 256 + qBlue(over)] : qBlue(over);
+
+            const QRgb mixed = qRgba((br * (256 - w) + orr * w + 128) >> 8,
+                                     (bg * (256 - w) + og * w + 128) >> 8,
+                                     (bb * (256 - w) + ob * w + 128) >> 8,
+                                     qAlpha(raw));
+            line[i] = qAlpha(raw) == 255 ? mixed : qPremultiply(mixed);
+        }
+        break;
+    }
+    case Op::MixOp:
+        op.mixFn(line, reinterpret_cast<const QRgb *>(op.other.constScanLine(y)) + x0, x0, count, y);
+        break;
+    default:
+        break;
+    }
+}
+
+QImage FilterGraph::acquire(const QSize &size)
+{
+    for (int i = 0; i < m_pool.size(); ++i) {
+        if (m_pool.at(i).size() == size) {
+            return m_pool.takeAt(i);
+        }
+    }
+    return QImage(size, QImage::Format_ARGB32_Premultiplied);
+}
+
+// 只回收没有其他引用的缓冲；池满时直接丢弃
+void FilterGraph::recycle(QImage &image)
+{
+    if (!image.isNull() && image.isDetached() &&
+        image.format() == QImage::Format_ARGB32_Premultiplied) {
+        qint64 total = imageBytes(image);
+        for (const QImage &pooled : m_pool) {
+            total += imageBytes(pooled);
+        }
+        if (total <= m_poolLimit) {
+            m_pool.append(image);
+        }
+    }
+    image = QImage();
+}
@@ -0,0 +1,129 @@
+#ifndef FILTERGRAPH_H
+#define FILTERGRAPH_H
+
+#include "imageeditor.h"
+#include "colorlut.h"
+#include <QImage>
+#include <QVector>
+#include <QHash>
+#include <QColor>
+#include <functional>
+
+// 惰性滤镜图
+// 先用 adjust()/lut()/vignette()/... 搭出节点（只记录参数，不计算），evaluate() 时才执行：
+//  - 相邻的逐像素节点（调整、查找表、暗角、遮罩、混合、合并）融合成一遍，按行条带处理，
+//    中间结果只在一行的范围内停留，不落成整张图；连续的查找表预先复合成一张
+//  - 被多个节点引用的中间结果只算一次，最后一个使用者用完就归还缓冲池
+//  - 邻域节点（卷积、模糊、其他滤镜）各自物化成整张图
+// 所有节点都在 ARGB32_Premultiplied 上处理。同一个 FilterGraph 不能在多个线程里同时 evaluate
+class FilterGraph
+{
+public:
+    typedef int Node;
+
+    // 合并函数：line 为当前结果（可改写），other 为另一个输入的同一段像素，x0/y 为这段像素在图中的位置。
+    // 会在多个线程里按行同时调用
+    typedef std::function<void(QRgb *line, const QRgb *other, int x0, int count, int y)> MixFunction;
+
+    FilterGraph();
+
+    Node input() const { return 0; }
+
+    // 逐像素节点
+    Node adjust(Node in, const AdjustParams &params);
+    Node lut(Node in, const ColorLut &table);
+    Node vignette(Node in, qreal intensity = 0.7, const QColor &color = Qt::black);
+    Node mask(Node in, const QImage &coverage);     // 按 coverage 的 alpha 缩放像素（含 alpha），尺寸不同时先拉伸
+    Node blend(Node base, Node overlay, qreal opacity = 1.0, BlendMode mode = Normal);
+    Node mix(Node base, Node other, const MixFunction &fn);
+
+    // 邻域节点
+    Node convolve(Node in, const QVector<QVector<qreal>> &kernel);
+    Node blur(Node in, int radius);
+    Node filter(Node in, FilterType type, qreal intensity = 1.0);   // 纯调色滤镜按查找表融合，其余物化
+
+    // 同 ImageEditor::applyFilterWithParams：先调整再滤镜，参数为 0 的步骤不建节点
+    Node apply(Node in, const FilterParams &params);
+
+    void clear();                   // 只保留输入节点
+    int nodeCount() const { return m_nodes.size(); }
+
+    QImage evaluate(const QImage &source, Node output);
+
+    // evaluate 之间缓冲池里保留的空闲缓冲上限（字节）
+    void setPoolLimit(qint64 bytes);
+    void releasePool();
+
+    // 把 evaluate() 返回、调用方已经用完的结果交还缓冲池，下一次 evaluate 直接复用
+    void recycle(QImage &image);
+
+private:
+    enum Kind { InputNode, AdjustNode, LutNode, VignetteNode, MaskNode, BlendNode, MixNode,
+                ConvolveNode, BlurNode, FilterNode };
+
+    struct NodeData {
+        Kind kind = InputNode;
+        Node in = -1;
+        Node other = -1;
+        AdjustParams adjust;
+        ColorLut table;
+        qreal amount = 0;
+        QColor color;
+        QImage image;
+        BlendMode mode = Normal;
+        MixFunction mixFn;
+        QVector<QVector<qreal>> kernel;
+        int radius = 0;
+        FilterType filter = FILTER_NONE;
+    };
+
+    // 融合阶段里的一步，按行执行
+    struct Op {
+        enum Type { LutOp, AdjustOp, VignetteOp, MaskOp, BlendOp, MixOp } type = LutOp;
+        ColorLut table;
+        AdjustParams adjust;
+        qreal amount = 0;
+        QColor color;
+        BlendMode mode = Normal;
+        QVector<uchar> blendTable;      // 256x256，[base * 256 + overlay]
+        MixFunction mixFn;
+        QImage other;                   // 遮罩 / 叠加图 / 合并的另一输入
+        bool otherOwned = false;
+    };
+
+    // 一个待执行的融合阶段：在 buffer 上依次执行 ops
+    struct Stage {
+        QImage buffer;
+        bool owned = false;             // buffer 是本次计算的中间结果（可原地改写、用完可回收）
+        QVector<Op> ops;
+        QVector<Node> uses;             // 用到的共享节点，执行完释放一次引用
+    };
+
+    Node addNode(const NodeData &data);
+    bool isPointNode(Node n) const;
+
+    Stage build(Node n);
+    Stage stageFor(Node in);
+    QImage inputImage(Node in, bool *owned);
+    QImage materialize(Node n);
+    QImage compute(Node n);
+    QImage run(Stage &stage);
+    void prepare(Stage &stage, const QSize &size);
+    void release(Node n);
+
+    static void applyOp(const Op &op, QRgb *line, int x0, int count, int y, const QSize &size);
+
+    QImage acquire(const QSize &size);
+
+    QVector<NodeData> m_nodes;
+
+    // 单次 evaluate 的状态
+    QImage m_source;
+    QVector<int> m_consumers;
+    QHash<Node, QImage> m_cache;
+
+    QVector<QImage> m_pool;
+    qint64 m_poolLimit;
+};
+
+#endif // FILTERGRAPH_H
@@ -1,4 +1,10 @@
 #include "imageeditor.h"
+#include "batchfilterengine.h"
+#include "colorlut.h"
+#include "convolutionengine.h"
+#include "filtergraph.h"
+#include "maskcache.h"
+#include "tilescheduler.h"
 #include <QPainter>
 #include <QPainterPath>
 #include <QBrush>
@@ -6,9 +12,206 @@
 #include <QDebug>
 #include <QtMath>
 #include <QVector>
+#include <QVarLengthArray>
 #include <algorithm>
+#include <cstring>
 #include <random>
 
+namespace {
+
+// 模糊用的定点位数：高斯权重 Q16，盒式模糊的 1/窗口宽 用 Q23
+const int kWeightBits = 16;
+const int kBoxBits = 23;
+
+// 半径不超过它时用精确的可分离高斯，更大时三次盒式模糊，开销与半径无关
+const int kExactGaussianRadius = 8;
+
+// 一行像素左右各按夹取补 pad 个像素，后面的循环就不用判断边界
+void padRow(const quint32 *src, int width, int pad, quint32 *dst)
+{
+    for (int i = 0; i < pad; ++i) {
+        dst[i] = src[0];
+        dst[pad + width + i] = src[width - 1];
+    }
+    std::memcpy(dst + pad, src, size_t(width) * 4);
+}
+
+// 水平一维卷积，四个字节通道一起算
+void convolveRow(const quint32 *padded, int width, const int *weights, int taps, quint32 *dst)
+{
+    for (int x = 0; x < width; ++x) {
+        const uchar *p = reinterpret_cast<const uchar *>(padded + x);
+        quint32 s0 = 1u << (kWeightBits - 1), s1 = s0, s2 = s0, s3 = s0;
+        for (int k = 0; k < taps; ++k, p += 4) {
+            const quint32 w = quint32(weights[k]);
+            s0 += p[0] * w;
+            s1 += p[1] * w;
+            s2 += p[2] * w;
+            s3 += p[3] * w;
+        }
+        uchar *d = reinterpret_cast<uchar *>(dst + x);
+        d[0] = uchar(s0 >> kWeightBits);
+        d[1] = uchar(s1 >> kWeightBits);
+        d[2] = uchar(s2 >> kWeightBits);
+        d[3] = uchar(s3 >> kWeightBits);
+    }
+}
+
+// 水平滑动窗口求和：每个像素只加一个、减一个
+void boxRow(const quint32 *padded, int width, int radius, quint32 mul, quint32 *dst)
+{
+    const uchar *p = reinterpret_cast<const uchar *>(padded);
+    const int span = 2 * radius + 1;
+    const quint32 half = 1u << (kBoxBits - 1);
+    quint32 s[4] = {0, 0, 0, 0};
+    for (int k = 0; k < span; ++k)
+        for (int c = 0; c < 4; ++c) s[c] += p[k * 4 + c];
+
+    for (int x = 0; x < width; ++x) {
+        uchar *d = reinterpret_cast<uchar *>(dst + x);
+        for (int c = 0; c < 4; ++c) d[c] = uchar((s[c] * mul + half) >> kBoxBits);
+        if (x + 1 < width) {
+            for (int c = 0; c < 4; ++c)
+                s[c] += quint32(p[(x + span) * 4 + c]) - p[x * 4 + c];
+        }
+    }
+}
+
+// 油画效果的滑动直方图：256 个亮度档，每档计数和 RGBA 累加和。
+// 众数惰性维护：加像素时顺手更新，只有众数那一档被减时才重新扫描；
+// 出现次数相同时取亮度低的一档
+struct OilHistogram {
+    int count[256];
+    quint32 sum[256][4];
+    int maxBin;
+    int maxCount;
+    bool dirty;
+
+    void reset()
+    {
+        std::memset(count, 0, sizeof(count));
+        std::memset(sum, 0, sizeof(sum));
+        maxBin = 0;
+        maxCount = 0;
+        dirty = false;
+    }
+
+    void add(int bin, QRgb p)
+    {
+        const int c = ++count[bin];
+        sum[bin][0] += qRed(p);
+        sum[bin][1] += qGreen(p);
+        sum[bin][2] += qBlue(p);
+        sum[bin][3] += qAlpha(p);
+        if (!dirty && (c > maxCount || (c == maxCount && bin < maxBin))) {
+            maxCount = c;
+            maxBin = bin;
+        }
+    }
+
+    void remove(int bin, QRgb p)
+    {
+        --count[bin];
+        sum[bin][0] -= qRed(p);
+        sum[bin][1] -= qGreen(p);
+        sum[bin][2] -= qBlue(p);
+        sum[bin][3] -= qAlpha(p);
+        if (bin == maxBin) {
+            dirty = true;
+        }
+    }
+
+    int mode()
+    {
+        if (dirty) {
+            maxCount = 0;
+            for (int b = 0; b < 256; ++b) {
+                if (count[b] > maxCount) {
+                    maxCount = count[b];
+                    maxBin = b;
+                }
+            }
+            dirty = false;
+        }
+        return maxBin;
+    }
+};
+
+// 处理 [firstRow, lastRow) 行。窗口在图像边缘处收缩，不留未处理的边
+void oilPaintRows(const QImage &image, const uchar *gray, int radius,
+                  uchar *dstBits, int dstBytesPerLine, int firstRow, int lastRow)
+{
+    const int width = image.width();
+    const int height = image.height();
+    OilHistogram hist;
+    QVarLengthArray<const QRgb *, 64> rows;
+    QVarLengthArray<const uchar *, 64> grayRows;
+
+    for (int y = firstRow; y < lastRow; ++y) {
+        const int top = qMax(0, y - radius);
+        const int bottom = qMin(height - 1, y + radius);
+        rows.clear();
+        grayRows.clear();
+        for (int yy = top; yy <= bottom; ++yy) {
+            rows.append(reinterpret_cast<const QRgb *>(image.constScanLine(yy)));
+            grayRows.append(gray + yy * width);
+        }
+        const int n = rows.size();
+
+        hist.reset();
+        for (int x = 0; x <= qMin(width - 1, radius); ++x) {
+            for (int i = 0; i < n; ++i) {
+                hist.add(grayRows[i][x], rows[i][x]);
+            }
+        }
+
+        QRgb *dst = reinterpret_cast<QRgb *>(dstBits + y * dstBytesPerLine);
+        for (int x = 0; x < width; ++x) {
+            const int bin = hist.mode();
+            const quint32 c = quint32(hist.count[bin]);
+            const quint32 half = c / 2;
+            dst[x] = qRgba(int((hist.sum[bin][0] + half) / c), int((hist.sum[bin][1] + half) / c),
+                           int((hist.sum[bin][2] + half) / c), int((hist.sum[bin][3] + half) / c));
+
+            // 窗口右移：加入右边新列，移出左边旧列
+            const int addX = x + radius + 1;
+            const int removeX = x - radius;
+            if (addX < width) {
+                for (int i = 0; i < n; ++i) {
+                    hist.add(grayRows[i][addX], rows[i][addX]);
+                }
+            }
+            if (removeX >= 0) {
+                for (int i = 0; i < n; ++i) {
+                    hist.remove(grayRows[i][removeX], rows[i][removeX]);
+                }
+            }
+        }
+    }
+}
+
+// 32 位像素格式可以直接按 QRgb 读写，原地处理时不必转换
+bool isPixel32(const QImage &image)
+{
+    return image.format() == QImage::Format_RGB32 || image.format() == QImage::Format_ARGB32 ||
+           image.format() == QImage::Format_ARGB32_Premultiplied;
+}
+
+// 统一成预乘 ARGB32 处理，透明边缘模糊后不会发黑
+QImage toBlurFormat(const QImage &image)
+{
+    return image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+}
+
+QImage fromBlurFormat(const QImage &result, QImage::Format original)
+{
+    if (original == QImage::Format_RGB32 || original == QImage::Format_ARGB32)
+        return result.convertToFormat(original);
+    return result;
+}
+
+} // namespace
+
 ImageEditor::ImageEditor(QObject *parent)
     : QObject(parent)
 {
@@ -30,6 +233,20 @@ QPixmap ImageEditor::cropImage(const QPixmap &original, const QRect &rect)
     return original.copy(validRect);
 }
 
+QImage ImageEditor::cropImage(const QImage &image, const QRect &rect)
+{
+    if (image.isNull() || !rect.isValid()) {
+        return image;
+    }
+
+    QRect validRect = rect.intersected(image.rect());
+    if (validRect.isEmpty()) {
+        return image;
+    }
+
+    return image.copy(validRect);
+}
+
 QPixmap ImageEditor::resizeImage(const QPixmap &original, const QSize &size, bool keepAspectRatio)
 {
     if (original.isNull() || size.isEmpty()) {
@@ -45,6 +262,16 @@ QPixmap ImageEditor::resizeImage(const QPixmap &original, const QSize &size, boo
     }
 }
 
+QImage ImageEditor::resizeImage(const QImage &image, const QSize &size, bool keepAspectRatio)
+{
+    if (image.isNull() || size.isEmpty()) {
+        return image;
+    }
+
+    return toWorkingFormat(image).scaled(size, keepAspectRatio ? Qt::KeepAspectRatio : Qt::IgnoreAspectRatio,
+                                         Qt::SmoothTransformation);
+}
+
 QPixmap ImageEditor::rotateImage(const QPixmap &original, qreal degrees)
 {
     if (original.isNull()) {
@@ -56,6 +283,17 @@ QPixmap ImageEditor::rotateImage(const QPixmap &original, qreal degrees)
     return original.transformed(transform, Qt::SmoothTransformation);
 }
 
+QImage ImageEditor::rotateImage(const QImage &image, qreal degrees)
+{
+    if (image.isNull()) {
+        return image;
+    }
+
+    QTransform transform;
+    transform.rotate(degrees);
+    return toWorkingFormat(image).transformed(transform, Qt::SmoothTransformation);
+}
+
 QPixmap ImageEditor::flipHorizontal(const QPixmap &original)
 {
     if (original.isNull()) {
@@ -65,6 +303,11 @@ QPixmap ImageEditor::flipHorizontal(const QPixmap &original)
     return original.transformed(QTransform().scale(-1, 1));
 }
 
+QImage ImageEditor::flipHorizontal(const QImage &image)
+{
+    return image.mirrored(true, false);
+}
+
 QPixmap ImageEditor::flipVertical(const QPixmap &original)
 {
     if (original.isNull()) {
@@ -74,6 +317,11 @@ QPixmap ImageEditor::flipVertical(const QPixmap &original)
     return original.transformed(QTransform().scale(1, -1));
 }
 
+QImage ImageEditor::flipVertical(const QImage &image)
+{
+    return image.mirrored(false, true);
+}
+
 // 滤镜应用
 QPixmap ImageEditor::applyFilter(const QPixmap &original, FilterType filter, qreal intensity)
 {
@@ -81,49 +329,70 @@ QPixmap ImageEditor::applyFilter(const QPixmap &original, FilterType filter, qre
         return original;
     }
 
-    QImage image = original.toImage();
-    QImage result;
+    return QPixmap::fromImage(applyFilter(original.toImage(), filter, intensity));
+}
+
+// QImage 版本不经过 QPixmap，可以在工作线程里调用
+QImage ImageEditor::applyFilter(const QImage &image, FilterType filter, qreal intensity)
+{
+    QImage result = image;
+    applyFilterInPlace(result, filter, intensity);
+    return result;
+}
+
+// 逐像素的滤镜直接改写 image，邻域滤镜把新结果赋回 image
+void ImageEditor::applyFilterInPlace(QImage &image, FilterType filter, qreal intensity)
+{
+    if (image.isNull()) {
+        return;
+    }
+
+    if (!isPixel32(image)) {
+        image = toWorkingFormat(image);
+    }
 
     switch (filter) {
     case FILTER_GRAYSCALE:
-        result = applyGrayscaleFilter(image);
+        applyGrayscaleFilter(image);
         break;
     case FILTER_SEPIA:
-        result = applySepiaFilter(image, intensity);
+        applySepiaFilter(image, intensity);
         break;
     case FILTER_VINTAGE:
-        result = applyVintageFilter(image);
+        applyVintageFilter(image);
         break;
     case FILTER_BLUR:
-        result = applyBlurFilter(image, static_cast<int>(intensity * 10));
+        image = applyBlurFilter(image, static_cast<int>(intensity * 10));
         break;
     case FILTER_SHARPEN:
-        result = applySharpenFilter(image, intensity);
+        image = applySharpenFilter(image, intensity);
         break;
     case FILTER_EMBOSS:
-        result = applyEmbossFilter(image);
+        image = applyEmbossFilter(image);
         break;
     case FILTER_EDGE_DETECT:
-        result = applyEdgeDetectFilter(image);
+        image = applyEdgeDetectFilter(image);
         break;
     case FILTER_INVERT:
-        result = applyInvertFilter(image);
+        image = applyInvertFilter(image);
         break;
     case FILTER_LOMO:
-        result = applyLomoFilter(image, intensity);
+        applyLomoFilter(image, intensity);
         break;
     case FILTER_CINEMATIC:
-        result = applyCinematicFilter(image);
+        image = applyCinematicFilter(image);
         break;
     case FILTER_CROSS_PROCESS:
-        result = applyCrossProcessFilter(image);
+        applyCrossProcessFilter(image);
         break;
     default:
-        result = image;
         break;
     }
+}
 
-    return QPixmap::fromImage(result);
+QImage ImageEditor::toWorkingFormat(const QImage &image)
+{
+    return image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
 }
 
 QPixmap ImageEditor::applyAdjustments(const QPixmap &original, const AdjustParams &params)
@@ -133,193 +402,184 @@ QPixmap ImageEditor::applyAdjustments(const QPixmap &original, const AdjustParam
     }
 
     QImage image = original.toImage();
-    QImage result = image.copy();
+    applyAdjustmentsInPlace(image, params);
+    return QPixmap::fromImage(image);
+}
 
-    // 计算平均亮度用于对比度调整
-    qreal averageLuminance = 0;
-    int pixelCount = image.width() * image.height();
+QImage ImageEditor::applyAdjustments(const QImage &image, const AdjustParams &params)
+{
+    QImage result = toWorkingFormat(image);
+    applyAdjustmentsInPlace(result, params);
+    return result;
+}
+
+// 所有调整烘焙成一张三维查找表，整图只走一遍
+void ImageEditor::applyAdjustmentsInPlace(QImage &image, const AdjustParams &params)
+{
+    if (image.isNull() || !hasAdjustments(params)) {
+        return;
+    }
 
+    // 计算平均亮度用于对比度调整（隔行隔列抽样，约 6.4 万个点足够稳定）
+    qreal averageLuminance = 0;
     if (qAbs(params.contrast) > 0.01) {
-        for (int y = 0; y < image.height(); ++y) {
-            const QRgb *line = reinterpret_cast<const QRgb*>(image.scanLine(y));
-            for (int x = 0; x < image.width(); ++x) {
-                averageLuminance += calculateLuminance(line[x]);
-            }
-        }
-        averageLuminance /= pixelCount;
+        averageLuminance = estimateAverageLuminance(image);
     }
 
-    // 应用调整
-    for (int y = 0; y < result.height(); ++y) {
-        QRgb *line = reinterpret_cast<QRgb*>(result.scanLine(y));
-        for (int x = 0; x < result.width(); ++x) {
-            QRgb pixel = line[x];
+    adjustmentLut(params, averageLuminance).apply(image);
+}
 
-            // 亮度调整
-            if (qAbs(params.brightness) > 0.01) {
-                pixel = adjustPixelBrightness(pixel, params.brightness);
-            }
+ColorLut ImageEditor::adjustmentLut(const AdjustParams &params, qreal averageLuminance)
+{
+    return ColorLut::bake([&params, averageLuminance](QRgb pixel) {
+        return adjustPixel(pixel, params, averageLuminance);
+    });
+}
 
-            // 对比度调整
-            if (qAbs(params.contrast) > 0.01) {
-                pixel = adjustPixelContrast(pixel, params.contrast, averageLuminance);
-            }
+bool ImageEditor::hasAdjustments(const AdjustParams &params)
+{
+    return qAbs(params.brightness) > 0.01 || qAbs(params.contrast) > 0.01 ||
+           qAbs(params.saturation) > 0.01 || qAbs(params.temperature) > 0.01 ||
+           qAbs(params.exposure) > 0.01;
+}
 
-            // 饱和度调整
-            if (qAbs(params.saturation) > 0.01) {
-                pixel = adjustPixelSaturation(pixel, params.saturation);
-            }
+qreal ImageEditor::estimateAverageLuminance(const QImage &image)
+{
+    const int step = qMax(1, qRound(qSqrt(qreal(image.width()) * image.height() / 65536.0)));
+    const QImage src = (image.format() == QImage::Format_RGB32 || image.format() == QImage::Format_ARGB32 ||
+                        image.format() == QImage::Format_ARGB32_Premultiplied)
+                       ? image : image.convertToFormat(QImage::Format_RGB32);
+    qreal sum = 0;
+    int count = 0;
+    for (int y = 0; y < src.height(); y += step) {
+        const QRgb *line = reinterpret_cast<const QRgb*>(src.constScanLine(y));
+        for (int x = 0; x < src.width(); x += step) {
+            sum += calculateLuminance(line[x]);
+            ++count;
+        }
+    }
+    return count > 0 ? sum / count : 0;
+}
 
-            // 色温调整
-            if (qAbs(params.temperature) > 0.01) {
-                pixel = adjustPixelTemperature(pixel, params.temperature);
-            }
+// 单个像素依次经过各项调整（烘焙查找表时在格点上调用）
+QRgb ImageEditor::adjustPixel(QRgb pixel, const AdjustParams &params, qreal averageLuminance)
+{
+    // 亮度调整
+    if (qAbs(params.brightness) > 0.01) {
+        pixel = adjustPixelBrightness(pixel, params.brightness);
+    }
 
-            // 曝光调整（简化版）
-            if (qAbs(params.exposure) > 0.01) {
-                qreal exposure = 1.0 + params.exposure * 2.0;
-                int r = clamp(qRed(pixel) * exposure);
-                int g = clamp(qGreen(pixel) * exposure);
-                int b = clamp(qBlue(pixel) * exposure);
-                pixel = qRgb(r, g, b);
-            }
+    // 对比度调整
+    if (qAbs(params.contrast) > 0.01) {
+        pixel = adjustPixelContrast(pixel, params.contrast, averageLuminance);
+    }
 
-            line[x] = pixel;
-        }
+    // 饱和度调整
+    if (qAbs(params.saturation) > 0.01) {
+        pixel = adjustPixelSaturation(pixel, params.saturation);
     }
 
-    return QPixmap::fromImage(result);
+    // 色温调整
+    if (qAbs(params.temperature) > 0.01) {
+        pixel = adjustPixelTemperature(pixel, params.temperature);
+    }
+
+    // 曝光调整（简化版）
+    if (qAbs(params.exposure) > 0.01) {
+        qreal exposure = 1.0 + params.exposure * 2.0;
+        int r = clamp(qRed(pixel) * exposure);
+        int g = clamp(qGreen(pixel) * exposure);
+        int b = clamp(qBlue(pixel) * exposure);
+        pixel = qRgb(r, g, b);
+    }
+
+    return pixel;
 }
 
 QPixmap ImageEditor::applyFilterWithParams(const QPixmap &original, const FilterParams &params)
 {
-    QPixmap result = original;
-
-    // 首先应用调整
-    if (params.adjust.brightness != 0.0 || params.adjust.contrast != 0.0 ||
-        params.adjust.saturation != 0.0 || params.adjust.temperature != 0.0) {
-        result = applyAdjustments(result, params.adjust);
+    if (original.isNull()) {
+        return original;
     }
 
-    // 然后应用滤镜
-    if (params.type != FILTER_NONE) {
-        result = applyFilter(result, params.type, params.intensity);
-    }
+    return QPixmap::fromImage(applyFilterWithParams(original.toImage(), params));
+}
 
-    return result;
+QImage ImageEditor::applyFilterWithParams(const QImage &image, const FilterParams &params)
+{
+    // 调整和纯调色滤镜在滤镜图里合成一次查表
+    FilterGraph graph;
+    return graph.evaluate(image, graph.apply(graph.input(), params));
 }
 
 // 灰度滤镜
-QImage ImageEditor::applyGrayscaleFilter(const QImage &image)
+void ImageEditor::applyGrayscaleFilter(QImage &image)
 {
-    QImage result = image;
-
-    for (int y = 0; y < result.height(); ++y) {
-        QRgb *line = reinterpret_cast<QRgb*>(result.scanLine(y));
-        for (int x = 0; x < result.width(); ++x) {
-            QRgb pixel = line[x];
-            int gray = qGray(pixel);
-            line[x] = qRgb(gray, gray, gray);
-        }
-    }
+    grayscaleLut().apply(image);
+}
 
-    return result;
+ColorLut ImageEditor::grayscaleLut()
+{
+    return ColorLut::bake([](QRgb pixel) {
+        int gray = qGray(pixel);
+        return qRgb(gray, gray, gray);
+    });
 }
 
 // 怀旧滤镜
-QImage ImageEditor::applySepiaFilter(const QImage &image, qreal intensity)
+void ImageEditor::applySepiaFilter(QImage &image, qreal intensity)
 {
-    QImage result = image;
+    sepiaLut(intensity).apply(image);
+}
 
-    for (int y = 0; y < result.height(); ++y) {
-        QRgb *line = reinterpret_cast<QRgb*>(result.scanLine(y));
-        for (int x = 0; x < result.width(); ++x) {
-            QRgb pixel = line[x];
-            int gray = qGray(pixel);
+ColorLut ImageEditor::sepiaLut(qreal intensity)
+{
+    return ColorLut::bake([intensity](QRgb pixel) {
+        int gray = qGray(pixel);
 
-            // 怀旧色公式
-            int r = clamp(gray * 1.2 * intensity + gray * (1 - intensity));
-            int g = clamp(gray * 0.9 * intensity + gray * (1 - intensity));
-            int b = clamp(gray * 0.7 * intensity + gray * (1 - intensity));
+        // 怀旧色公式
+        int r = clamp(gray * 1.2 * intensity + gray * (1 - intensity));
+        int g = clamp(gray * 0.9 * intensity + gray * (1 - intensity));
+        int b = clamp(gray * 0.7 * intensity + gray * (1 - intensity));
 
-            line[x] = qRgb(r, g, b);
-        }
-    }
-
-    return result;
+        return qRgb(r, g, b);
+    });
 }
 
 // 复古滤镜
-QImage ImageEditor::applyVintageFilter(const QImage &image)
+void ImageEditor::applyVintageFilter(QImage &image)
 {
-    QImage result = image;
-
     // 添加褐色调
-    for (int y = 0; y < result.height(); ++y) {
-        QRgb *line = reinterpret_cast<QRgb*>(result.scanLine(y));
-        for (int x = 0; x < result.width(); ++x) {
-            QRgb pixel = line[x];
+    ColorLut::bake([](QRgb pixel) {
+        int r = qRed(pixel);
+        int g = qGreen(pixel);
+        int b = qBlue(pixel);
 
-            int r = qRed(pixel);
-            int g = qGreen(pixel);
-            int b = qBlue(pixel);
+        // 复古色调调整
+        r = clamp(r * 1.08);
+        g = clamp(g * 0.95);
+        b = clamp(b * 0.82);
 
-            // 复古色调调整
-            r = clamp(r * 1.08);
-            g = clamp(g * 0.95);
-            b = clamp(b * 0.82);
-
-            // 添加轻微褪色效果
-            r = clamp(r + 20);
-            g = clamp(g + 15);
-            b = clamp(b + 10);
-
-            line[x] = qRgb(r, g, b);
-        }
-    }
+        // 添加轻微褪色效果
+        r = clamp(r + 20);
+        g = clamp(g + 15);
+        b = clamp(b + 10);
 
-    QPixmap px = QPixmap::fromImage(result);   // 1. 先拿到 QPixmap
-    px = addVignette(px, 0.6, QColor(60,40,20)); // 2. 加暗角
-    result = px.toImage();                  // 3. 需要 QImage 再转回来
+        return qRgb(r, g, b);
+    }).apply(image);
 
-    return result;
+    // 加暗角
+    addVignetteInPlace(image, 0.6, QColor(60, 40, 20));
 }
 
 // LOMO滤镜
-QImage ImageEditor::applyLomoFilter(const QImage &image, qreal intensity)
+void ImageEditor::applyLomoFilter(QImage &image, qreal intensity)
 {
-    QImage result = image;
-
     // 增加饱和度
-    result = applyAdjustments(QPixmap::fromImage(result),
-                              AdjustParams{0.0, 0.1, 0.3, 0.0, 0.0, 0.0, 0.0, 0.0}).toImage();
+    applyAdjustmentsInPlace(image, AdjustParams{0.0, 0.1, 0.3, 0.0, 0.0, 0.0, 0.0, 0.0});
 
     // 添加暗角
-    QPixmap pixmap = QPixmap::fromImage(result);
-    pixmap = addVignette(pixmap, 0.8 * intensity, QColor(0, 0, 0));
-
-    // 添加轻微晕影
-    for (int y = 0; y < pixmap.height(); ++y) {
-        QRgb *line = reinterpret_cast<QRgb*>(pixmap.toImage().scanLine(y));
-        for (int x = 0; x < pixmap.width(); ++x) {
-            QRgb pixel = line[x];
-
-            // 计算到中心的距离
-            qreal dx = (x - pixmap.width() / 2.0) / (pixmap.width() / 2.0);
-            qreal dy = (y - pixmap.height() / 2.0) / (pixmap.height() / 2.0);
-            qreal distance = qSqrt(dx * dx + dy * dy);
-
-            // 边缘变暗
-            qreal darken = 1.0 - distance * 0.3 * intensity;
-            int r = clamp(qRed(pixel) * darken);
-            int g = clamp(qGreen(pixel) * darken);
-            int b = clamp(qBlue(pixel) * darken);
-
-            line[x] = qRgb(r, g, b);
-        }
-    }
-
-    return pixmap.toImage();
+    addVignetteInPlace(image, 0.8 * intensity, QColor(0, 0, 0));
 }
 
 // 电影感滤镜
@@ -328,82 +588,248 @@ QImage ImageEditor::applyCinematicFilter(const QImage &image)
     QImage result = image;
 
     // 降低饱和度，增加对比度
-    result = applyAdjustments(QPixmap::fromImage(result),
-                              AdjustParams{0.0, 0.2, -0.2, 0.0, 0.1, 0.0, 0.0, 0.0}).toImage();
-
-    // 添加电影调色（蓝绿色调）
-    for (int y = 0; y < result.height(); ++y) {
-        QRgb *line = reinterpret_cast<QRgb*>(result.scanLine(y));
-        for (int x = 0; x < result.width(); ++x) {
-            QRgb pixel = line[x];
-
-            int r = qRed(pixel);
-            int g = qGreen(pixel);
-            int b = qBlue(pixel);
-
-            // 电影感色调（偏蓝青）
-            r = clamp(r * 0.95);
-            g = clamp(g * 1.05);
-            b = clamp(b * 1.1);
+    applyAdjustmentsInPlace(result, AdjustParams{0.0, 0.2, -0.2, 0.0, 0.1, 0.0, 0.0, 0.0});
 
-            line[x] = qRgb(r, g, b);
-        }
+    // 添加电影调色（蓝绿色调），各通道独立，用一维曲线
+    QVector<int> red(256), green(256), blue(256);
+    for (int v = 0; v < 256; ++v) {
+        // 电影感色调（偏蓝青）
+        red[v] = clamp(v * 0.95);
+        green[v] = clamp(v * 1.05);
+        blue[v] = clamp(v * 1.1);
     }
+    ColorLut::fromCurves(red, green, blue).apply(result);
 
     // 添加上下黑边（电影宽银幕效果）
-    QPixmap pixmap = QPixmap::fromImage(result);
-    QPixmap cinematic(pixmap.width(), pixmap.height() * 1.2);
+    QImage cinematic(result.width(), int(result.height() * 1.2), QImage::Format_ARGB32_Premultiplied);
     cinematic.fill(Qt::black);
 
     QPainter painter(&cinematic);
-    painter.drawPixmap(0, pixmap.height() * 0.1, pixmap);
+    painter.drawImage(0, int(result.height() * 0.1), result);
     painter.end();
 
-    return cinematic.toImage();
+    return cinematic;
 }
 
 // 交叉冲印滤镜
-QImage ImageEditor::applyCrossProcessFilter(const QImage &image)
+void ImageEditor::applyCrossProcessFilter(QImage &image)
 {
-    QImage result = image;
+    crossProcessLut().apply(image);
+}
 
-    for (int y = 0; y < result.height(); ++y) {
-        QRgb *line = reinterpret_cast<QRgb*>(result.scanLine(y));
-        for (int x = 0; x < result.width(); ++x) {
-            QRgb pixel = line[x];
+ColorLut ImageEditor::crossProcessLut()
+{
+    return ColorLut::bake([](QRgb pixel) {
+        int r = qRed(pixel);
+        int g = qGreen(pixel);
+        int b = qBlue(pixel);
 
-            int r = qRed(pixel);
-            int g = qGreen(pixel);
-            int b = qBlue(pixel);
+        // 交叉冲印典型效果：高对比度，偏青色
+        r = clamp(r * 1.1);
+        g = clamp(g * 1.2);
+        b = clamp(b * 0.9);
 
-            // 交叉冲印典型效果：高对比度，偏青色
-            r = clamp(r * 1.1);
-            g = clamp(g * 1.2);
-            b = clamp(b * 0.9);
+        // 提高对比度
+        int avg = (r + g + b) / 3;
+        r = clamp(r + (r - avg) * 0.3);
+        g = clamp(g + (g - avg) * 0.3);
+        b = clamp(b + (b - avg) * 0.3);
 
-            // 提高对比度
-            int avg = (r + g + b) / 3;
-            r = clamp(r + (r - avg) * 0.3);
-            g = clamp(g + (g - avg) * 0.3);
-            b = clamp(b + (b - avg) * 0.3);
+        return qRgb(r, g, b);
+    });
+}
 
-            line[x] = qRgb(r, g, b);
-        }
+// 纯逐像素调色的滤镜对应的查找表，供滤镜图把它们和相邻的调色合并成一遍
+bool ImageEditor::pointFilterLut(FilterType filter, qreal intensity, ColorLut *lut)
+{
+    switch (filter) {
+    case FILTER_GRAYSCALE:
+        *lut = grayscaleLut();
+        return true;
+    case FILTER_SEPIA:
+        *lut = sepiaLut(intensity);
+        return true;
+    case FILTER_CROSS_PROCESS:
+        *lut = crossProcessLut();
+        return true;
+    default:
+        return false;
     }
-
-    return result;
 }
 
 // 模糊滤镜
 QImage ImageEditor::applyBlurFilter(const QImage &image, int radius)
 {
-    if (radius <= 0) {
+    if (radius <= 0 || image.isNull()) {
         return image;
     }
 
-    int kernelSize = radius * 2 + 1;
-    auto kernel = getGaussianKernel(kernelSize, radius / 2.0);
-    return applyConvolution(image, kernel);
+    // sigma 与原来 (2r+1) 的二维核一致；小半径精确高斯，大半径盒式逼近
+    qreal sigma = radius / 2.0;
+    if (radius <= kExactGaussianRadius) {
+        return gaussianBlur(image, radius, sigma);
+    }
+    return approximateGaussianBlur(image, sigma);
+}
+
+// 可分离高斯：先水平后垂直两次一维卷积，每像素 O(r)；两次都按行条带并行
+QImage ImageEditor::gaussianBlur(const QImage &image, int radius, qreal sigma)
+{
+    if (radius <= 0 || image.isNull()) {
+        return image;
+    }
+
+    QImage src = toBlurFormat(image);
+    const int width = src.width();
+    const int height = src.height();
+    const int taps = radius * 2 + 1;
+    const QVector<int> weights = getGaussianWeights(radius, sigma);
+
+    // 水平
+    QImage temp(src.size(), src.format());
+    uchar *tempBits = temp.bits();
+    const int tempBpl = temp.bytesPerLine();
+    TileScheduler::forEachStrip(src, 0, [&](int firstRow, int lastRow) {
+        QVector<quint32> padded(width + 2 * radius);
+        for (int y = firstRow; y < lastRow; ++y) {
+            padRow(reinterpret_cast<const quint32 *>(src.constScanLine(y)), width, radius, padded.data());
+            convolveRow(padded.constData(), width, weights.constData(), taps,
+                        reinterpret_cast<quint32 *>(tempBits + y * tempBpl));
+        }
+    });
+
+    // 垂直：整行累加，内层循环连续访问内存
+    QImage result(src.size(), src.format());
+    uchar *resultBits = result.bits();
+    const int resultBpl = result.bytesPerLine();
+    const int bytes = width * 4;
+    TileScheduler::forEachStrip(temp, radius, [&](int firstRow, int lastRow) {
+        QVector<quint32> acc(bytes);
+        for (int y = firstRow; y < lastRow; ++y) {
+            std::fill(acc.begin(), acc.end(), 1u << (kWeightBits - 1));
+            quint32 *a = acc.data();
+            for (int k = 0; k < taps; ++k) {
+                const uchar *row = temp.constScanLine(qBound(0, y + k - radius, height - 1));
+                const quint32 w = quint32(weights[k]);
+                for (int i = 0; i < bytes; ++i) {
+                    a[i] += row[i] * w;
+                }
+            }
+            uchar *dst = resultBits + y * resultBpl;
+            for (int i = 0; i < bytes; ++i) {
+                dst[i] = uchar(a[i] >> kWeightBits);
+            }
+        }
+    });
+
+    return fromBlurFormat(result, image.format());
+}
+
+// 盒式模糊：滑动窗口求和，每像素 O(1)，与半径无关；水平、垂直都按行条带并行
+QImage ImageEditor::boxBlur(const QImage &image, int radius, int passes)
+{
+    if (radius <= 0 || passes <= 0 || image.isNull()) {
+        return image;
+    }
+
+    QImage result = toBlurFormat(image);
+    const int width = result.width();
+    const int height = result.height();
+    const int bytes = width * 4;
+    const quint32 span = quint32(2 * radius + 1);
+    const quint32 mul = ((1u << kBoxBits) + span / 2) / span;
+    const quint32 half = 1u << (kBoxBits - 1);
+
+    QImage temp(result.size(), result.format());
+    uchar *resultBits = result.bits();
+    uchar *tempBits = temp.bits();
+    const int bpl = result.bytesPerLine();
+
+    for (int pass = 0; pass < passes; ++pass) {
+        // 水平：result -> temp
+        TileScheduler::forEachStrip(result, 0, [&](int firstRow, int lastRow) {
+            QVector<quint32> padded(width + 2 * radius);
+            for (int y = firstRow; y < lastRow; ++y) {
+                padRow(reinterpret_cast<const quint32 *>(resultBits + y * bpl), width, radius, padded.data());
+                boxRow(padded.constData(), width, radius, mul,
+                       reinterpret_cast<quint32 *>(tempBits + y * bpl));
+            }
+        });
+
+        // 垂直：按列维护窗口和，temp -> result。每个条带先按自己的首行初始化窗口
+        TileScheduler::forEachStrip(temp, radius, [&](int firstRow, int lastRow) {
+            QVector<quint32> colSum(bytes, 0u);
+            for (int k = firstRow - radius; k <= firstRow + radius; ++k) {
+                const uchar *row = tempBits + qBound(0, k, height - 1) * bpl;
+                for (int i = 0; i < bytes; ++i) {
+                    colSum[i] += row[i];
+                }
+            }
+            for (int y = firstRow; y < lastRow; ++y) {
+                uchar *dst = resultBits + y * bpl;
+                for (int i = 0; i < bytes; ++i) {
+                    dst[i] = uchar((colSum[i] * mul + half) >> kBoxBits);
+                }
+                if (y + 1 < lastRow) {
+                    const uchar *add = tempBits + qMin(y + radius + 1, height - 1) * bpl;
+                    const uchar *sub = tempBits + qMax(y - radius, 0) * bpl;
+                    for (int i = 0; i < bytes; ++i) {
+                        colSum[i] += quint32(add[i]) - sub[i];
+                    }
+                }
+            }
+        });
+    }
+
+    return fromBlurFormat(result, image.format());
+}
+
+// 三次盒式模糊逼近高斯：按 sigma 选三个窗口宽度，使总方差等于 sigma²
+QImage ImageEditor::approximateGaussianBlur(const QImage &image, qreal sigma)
+{
+    if (sigma <= 0 || image.isNull()) {
+        return image;
+    }
+
+    const int n = 3;
+    qreal ideal = qSqrt(12.0 * sigma * sigma / n + 1.0);
+    int lower = static_cast<int>(ideal);
+    if (lower % 2 == 0) {
+        --lower;
+    }
+    lower = qMax(lower, 1);
+    const int upper = lower + 2;
+    const int m = qRound((12.0 * sigma * sigma - n * lower * lower - 4.0 * n * lower - 3.0 * n)
+                         / (-4.0 * lower - 4.0));
+
+    QImage result = toBlurFormat(image);
+    for (int i = 0; i < n; ++i) {
+        int size = i < m ? lower : upper;
+        result = boxBlur(result, (size - 1) / 2, 1);
+    }
+    return fromBlurFormat(result, image.format());
+}
+
+// 一维高斯权重（定点），误差补到中心，保证和正好是 1.0
+QVector<int> ImageEditor::getGaussianWeights(int radius, qreal sigma)
+{
+    const int taps = radius * 2 + 1;
+    QVector<qreal> values(taps);
+    qreal sum = 0.0;
+    for (int i = 0; i < taps; ++i) {
+        qreal d = i - radius;
+        values[i] = qExp(-(d * d) / (2 * sigma * sigma));
+        sum += values[i];
+    }
+
+    QVector<int> weights(taps);
+    int total = 0;
+    for (int i = 0; i < taps; ++i) {
+        weights[i] = qRound(values[i] / sum * (1 << kWeightBits));
+        total += weights[i];
+    }
+    weights[radius] += (1 << kWeightBits) - total;
+    return weights;
 }
 
 // 锐化滤镜
@@ -420,16 +846,21 @@ QImage ImageEditor::applyEmbossFilter(const QImage &image)
     QImage result = applyConvolution(image, kernel);
 
     // 将结果偏移到可见范围
-    for (int y = 0; y < result.height(); ++y) {
-        QRgb *line = reinterpret_cast<QRgb*>(result.scanLine(y));
-        for (int x = 0; x < result.width(); ++x) {
-            QRgb pixel = line[x];
-            int gray = qGray(pixel);
-            // 偏移并限制范围
-            gray = clamp(gray + 128);
-            line[x] = qRgb(gray, gray, gray);
+    uchar *bits = result.bits();
+    const int bytesPerLine = result.bytesPerLine();
+    const int width = result.width();
+    TileScheduler::forEachStrip(result, 0, [&](int firstRow, int lastRow) {
+        for (int y = firstRow; y < lastRow; ++y) {
+            QRgb *line = reinterpret_cast<QRgb*>(bits + y * bytesPerLine);
+            for (int x = 0; x < width; ++x) {
+                QRgb pixel = line[x];
+                int gray = qGray(pixel);
+                // 偏移并限制范围
+                gray = clamp(gray + 128);
+                line[x] = qRgb(gray, gray, gray);
+            }
         }
-    }
+    });
 
     return result;
 }
@@ -441,14 +872,19 @@ QImage ImageEditor::applyEdgeDetectFilter(const QImage &image)
     QImage result = applyConvolution(image, kernel);
 
     // 取绝对值并反转
-    for (int y = 0; y < result.height(); ++y) {
-        QRgb *line = reinterpret_cast<QRgb*>(result.scanLine(y));
-        for (int x = 0; x < result.width(); ++x) {
-            QRgb pixel = line[x];
-            int gray = 255 - qAbs(qGray(pixel) - 128);
-            line[x] = qRgb(gray, gray, gray);
+    uchar *bits = result.bits();
+    const int bytesPerLine = result.bytesPerLine();
+    const int width = result.width();
+    TileScheduler::forEachStrip(result, 0, [&](int firstRow, int lastRow) {
+        for (int y = firstRow; y < lastRow; ++y) {
+            QRgb *line = reinterpret_cast<QRgb*>(bits + y * bytesPerLine);
+            for (int x = 0; x < width; ++x) {
+                QRgb pixel = line[x];
+                int gray = 255 - qAbs(qGray(pixel) - 128);
+                line[x] = qRgb(gray, gray, gray);
+            }
         }
-    }
+    });
 
     return result;
 }
@@ -458,15 +894,12 @@ QImage ImageEditor::applyInvertFilter(const QImage &image)
 {
     QImage result = image;
 
-    for (int y = 0; y < result.height(); ++y) {
-        QRgb *line = reinterpret_cast<QRgb*>(result.scanLine(y));
-        for (int x = 0; x < result.width(); ++x) {
-            QRgb pixel = line[x];
-            line[x] = qRgb(255 - qRed(pixel),
-                           255 - qGreen(pixel),
-                           255 - qBlue(pixel));
-        }
+    // 按通道独立，用一维曲线（精确，不经过格点插值）
+    QVector<int> invert(256);
+    for (int i = 0; i < 256; ++i) {
+        invert[i] = 255 - i;
     }
+    ColorLut::fromCurve(invert).apply(result);
 
     return result;
 }
@@ -477,6 +910,14 @@ QImage ImageEditor::applyConvolution(const QImage &image, const QVector<QVector<
     int kernelSize = kernel.size();
     int radius = kernelSize / 2;
 
+    // 3x3 / 5x5 走定点 SIMD 引擎（锐化、浮雕、边缘检测都是 3x3）
+    if (kernelSize == 3) {
+        return ConvolutionEngine::convolve(image, ConvolutionKernel<3>::fromMatrix(kernel));
+    }
+    if (kernelSize == 5) {
+        return ConvolutionEngine::convolve(image, ConvolutionKernel<5>::fromMatrix(kernel));
+    }
+
     QImage result(image.size(), image.format());
     result.fill(Qt::black);
 
@@ -512,34 +953,6 @@ QImage ImageEditor::applyConvolution(const QImage &image, const QVector<QVector<
     return result;
 }
 
-// 高斯核生成
-QVector<QVector<qreal>> ImageEditor::getGaussianKernel(int size, qreal sigma)
-{
-    QVector<QVector<qreal>> kernel(size, QVector<qreal>(size, 0.0));
-    int center = size / 2;
-    qreal sum = 0.0;
-
-    for (int y = 0; y < size; ++y) {
-        for (int x = 0; x < size; ++x) {
-            qreal dx = x - center;
-            qreal dy = y - center;
-            qreal value = qExp(-(dx * dx + dy * dy) / (2 * sigma * sigma))
-                          / (2 * M_PI * sigma * sigma);
-            kernel[y][x] = value;
-            sum += value;
-        }
-    }
-
-    // 归一化
-    for (int y = 0; y < size; ++y) {
-        for (int x = 0; x < size; ++x) {
-            kernel[y][x] /= sum;
-        }
-    }
-
-    return kernel;
-}
-
 // 锐化核
 QVector<QVector<qreal>> ImageEditor::getSharpenKernel(qreal intensity)
 {
@@ -736,34 +1149,63 @@ QPixmap ImageEditor::addVignette(const QPixmap &original, qreal intensity, const
         return original;
     }
 
-    QPixmap result = original;
-    QImage image = result.toImage();
+    QImage image = original.toImage();
+    addVignetteInPlace(image, intensity, color);
+    return QPixmap::fromImage(image);
+}
+
+QImage ImageEditor::addVignette(const QImage &image, qreal intensity, const QColor &color)
+{
+    QImage result = toWorkingFormat(image);
+    addVignetteInPlace(result, intensity, color);
+    return result;
+}
+
+void ImageEditor::addVignetteInPlace(QImage &image, qreal intensity, const QColor &color)
+{
+    if (image.isNull()) {
+        return;
+    }
+
+    if (!isPixel32(image)) {
+        image = toWorkingFormat(image);
+    }
+    const bool premultiplied = image.format() == QImage::Format_ARGB32_Premultiplied;
+    const QSize size = image.size();
+    uchar *bits = image.bits();
+    const int bytesPerLine = image.bytesPerLine();
+    TileScheduler::forEachStrip(image, 0, [&](int firstRow, int lastRow) {
+        for (int y = firstRow; y < lastRow; ++y) {
+            vignetteLine(reinterpret_cast<QRgb*>(bits + y * bytesPerLine), 0, size.width(), y,
+                         size, intensity, color, premultiplied);
+        }
+    });
+}
 
-    qreal centerX = image.width() / 2.0;
-    qreal centerY = image.height() / 2.0;
+// 处理第 y 行从 x0 开始的 count 个像素，size 为整张图的尺寸
+void ImageEditor::vignetteLine(QRgb *line, int x0, int count, int y, const QSize &size,
+                               qreal intensity, const QColor &color, bool premultiplied)
+{
+    qreal centerX = size.width() / 2.0;
+    qreal centerY = size.height() / 2.0;
     qreal maxDist = qSqrt(centerX * centerX + centerY * centerY);
+    qreal dy = y - centerY;
 
-    for (int y = 0; y < image.height(); ++y) {
-        QRgb *line = reinterpret_cast<QRgb*>(image.scanLine(y));
-        for (int x = 0; x < image.width(); ++x) {
-            qreal dx = x - centerX;
-            qreal dy = y - centerY;
-            qreal distance = qSqrt(dx * dx + dy * dy) / maxDist;
+    for (int i = 0; i < count; ++i) {
+        qreal dx = x0 + i - centerX;
+        qreal distance = qSqrt(dx * dx + dy * dy) / maxDist;
 
-            // 计算暗角强度
-            qreal vignette = 1.0 - distance * intensity;
-            vignette = clamp(vignette);
+        // 计算暗角强度
+        qreal vignette = 1.0 - distance * intensity;
+        vignette = clamp(vignette);
 
-            QRgb pixel = line[x];
-            int r = clamp(qRed(pixel) * vignette + color.red() * (1 - vignette));
-            int g = clamp(qGreen(pixel) * vignette + color.green() * (1 - vignette));
-            int b = clamp(qBlue(pixel) * vignette + color.blue() * (1 - vignette));
+        QRgb pixel = premultiplied ? qUnpremultiply(line[i]) : line[i];
+        int r = clamp(qRed(pixel) * vignette + color.red() * (1 - vignette));
+        int g = clamp(qGreen(pixel) * vignette + color.green() * (1 - vignette));
+        int b = clamp(qBlue(pixel) * vignette + color.blue() * (1 - vignette));
 
-            line[x] = qRgb(r, g, b);
-        }
+        line[i] = qRgb(r, g, b);
     }
-
-    return QPixmap::fromImage(image);
 }
 
 // 移轴模糊
@@ -774,96 +1216,97 @@ QPixmap ImageEditor::addTiltShift(const QPixmap &original, const QPoint &focusCe
         return original;
     }
 
-    QImage image = original.toImage();
-    QImage result = image.copy();
-
-    // 应用渐变模糊
-    for (int y = 0; y < image.height(); ++y) {
-        // 计算该行的模糊强度
-        qreal distance = qAbs(y - focusCenter.y());
-        qreal blurFactor = 0;
-
-        if (distance > focusSize / 2) {
-            blurFactor = (distance - focusSize / 2) / (image.height() / 2.0);
-            blurFactor = clamp(blurFactor) * blurIntensity;
-        }
-
-        if (blurFactor > 0.01) {
-            int blurRadius = static_cast<int>(blurFactor * 20);
-            if (blurRadius > 0) {
-                // 简单水平模糊
-                for (int x = 0; x < image.width(); ++x) {
-                    int rSum = 0, gSum = 0, bSum = 0;
-                    int count = 0;
+    return QPixmap::fromImage(addTiltShift(original.toImage(), focusCenter, focusSize, blurIntensity));
+}
 
-                    for (int dx = -blurRadius; dx <= blurRadius; ++dx) {
-                        int sampleX = clamp(x + dx, 0, image.width() - 1);
-                        QRgb pixel = image.pixel(sampleX, y);
+QImage ImageEditor::addTiltShift(const QImage &original, const QPoint &focusCenter,
+                                 int focusSize, qreal blurIntensity)
+{
+    if (original.isNull()) {
+        return original;
+    }
 
-                        rSum += qRed(pixel);
-                        gSum += qGreen(pixel);
-                        bSum += qBlue(pixel);
-                        count++;
-                    }
+    QImage image = toBlurFormat(original);
+    QImage result = image.copy();
+    uchar *resultBits = result.bits();
+    const int resultBpl = result.bytesPerLine();
+    const int width = image.width();
+
+    // 应用渐变模糊；各行互不依赖，按行条带并行
+    TileScheduler::forEachStrip(image, 0, [&](int firstRow, int lastRow) {
+        QVector<quint32> padded;
+        for (int y = firstRow; y < lastRow; ++y) {
+            // 计算该行的模糊强度
+            qreal distance = qAbs(y - focusCenter.y());
+            qreal blurFactor = 0;
+
+            if (distance > focusSize / 2) {
+                blurFactor = (distance - focusSize / 2) / (image.height() / 2.0);
+                blurFactor = clamp(blurFactor) * blurIntensity;
+            }
 
-                    QRgb *line = reinterpret_cast<QRgb*>(result.scanLine(y));
-                    line[x] = qRgb(rSum / count, gSum / count, bSum / count);
+            if (blurFactor > 0.01) {
+                int blurRadius = static_cast<int>(blurFactor * 20);
+                if (blurRadius > 0) {
+                    // 简单水平模糊：滑动窗口求和，每像素 O(1)
+                    const quint32 span = quint32(2 * blurRadius + 1);
+                    padded.resize(width + 2 * blurRadius);
+                    padRow(reinterpret_cast<const quint32 *>(image.constScanLine(y)),
+                           width, blurRadius, padded.data());
+                    boxRow(padded.constData(), width, blurRadius,
+                           ((1u << kBoxBits) + span / 2) / span,
+                           reinterpret_cast<quint32 *>(resultBits + y * resultBpl));
                 }
             }
         }
-    }
+    });
 
-    return QPixmap::fromImage(result);
+    return result;
 }
 
 // 油画效果
-QPixmap ImageEditor::applyOilPaint(const QPixmap &original, int radius)
-{
-    if (original.isNull() || radius <= 0) {
-        return original;
-    }
-
-    QImage image = original.toImage();
-    QImage result(image.size(), image.format());
-
-    for (int y = radius; y < image.height() - radius; ++y) {
-        QRgb *destLine = reinterpret_cast<QRgb*>(result.scanLine(y));
-
-        for (int x = radius; x < image.width() - radius; ++x) {
-            // 统计区域内的颜色直方图
-            QMap<int, int> intensityCount;
-            QMap<int, QRgb> intensityColor;
-
-            for (int dy = -radius; dy <= radius; ++dy) {
-                const QRgb *srcLine = reinterpret_cast<const QRgb*>(
-                    image.scanLine(y + dy));
-
-                for (int dx = -radius; dx <= radius; ++dx) {
-                    QRgb pixel = srcLine[x + dx];
-                    int intensity = qGray(pixel);
+QPixmap ImageEditor::applyOilPaint(const QPixmap &original, int radius)
+{
+    if (original.isNull() || radius <= 0) {
+        return original;
+    }
 
-                    intensityCount[intensity] = intensityCount.value(intensity, 0) + 1;
-                    intensityColor[intensity] = pixel;
-                }
-            }
+    return QPixmap::fromImage(applyOilPaint(original.toImage(), radius));
+}
 
-            // 找到出现次数最多的强度值
-            int maxCount = 0;
-            int dominantIntensity = 0;
+QImage ImageEditor::applyOilPaint(const QImage &original, int radius)
+{
+    if (original.isNull() || radius <= 0) {
+        return original;
+    }
 
-            for (auto it = intensityCount.begin(); it != intensityCount.end(); ++it) {
-                if (it.value() > maxCount) {
-                    maxCount = it.value();
-                    dominantIntensity = it.key();
-                }
+    QImage image = original;
+    if (image.format() != QImage::Format_RGB32 && image.format() != QImage::Format_ARGB32 &&
+        image.format() != QImage::Format_ARGB32_Premultiplied) {
+        image = image.convertToFormat(QImage::Format_ARGB32);
+    }
+    QImage result(image.size(), image.format());
+    const int width = image.width();
+
+    // 按行条带并行；亮度平面先算好，每个像素只算一次
+    QVector<uchar> gray(width * image.height());
+    uchar *grayData = gray.data();
+    uchar *resultBits = result.bits();
+    const int resultBpl = result.bytesPerLine();
+    TileScheduler::forEachStrip(image, 0, [&](int firstRow, int lastRow) {
+        for (int y = firstRow; y < lastRow; ++y) {
+            const QRgb *line = reinterpret_cast<const QRgb*>(image.constScanLine(y));
+            uchar *g = grayData + y * width;
+            for (int x = 0; x < width; ++x) {
+                g[x] = uchar(qGray(line[x]));
             }
-
-            // 使用该强度对应的颜色
-            destLine[x] = intensityColor[dominantIntensity];
         }
-    }
+    });
+    TileScheduler::forEachStrip(image, radius, [&](int firstRow, int lastRow) {
+        oilPaintRows(image, grayData, radius, resultBits, resultBpl, firstRow, lastRow);
+    });
 
-    return QPixmap::fromImage(result);
+    return result;
 }
 
 // 铅笔素描效果
@@ -875,46 +1318,49 @@ QPixmap ImageEditor::applyPencilSketch(const QPixmap &original,
         return original;
     }
 
-    // 创建灰度图
-    QPixmap grayscale = applyFilter(original, FILTER_GRAYSCALE);
-    QImage grayImage = grayscale.toImage();
+    return QPixmap::fromImage(applyPencilSketch(original.toImage(), pencilIntensity, paperIntensity));
+}
 
-    // 创建边缘图
-    QPixmap edges = applyFilter(original, FILTER_EDGE_DETECT);
-    QImage edgeImage = edges.toImage();
+QImage ImageEditor::applyPencilSketch(const QImage &original,
+                                      qreal pencilIntensity,
+                                      qreal paperIntensity)
+{
+    if (original.isNull()) {
+        return original;
+    }
 
-    // 合并效果
-    QImage result(grayImage.size(), grayImage.format());
+    // 纸张纹理的随机数：每次调用取一个种子，每行一个发生器
+    std::random_device rd;
+    const unsigned int seed = rd();
+
+    // 灰度图与边缘图逐行合并，灰度不单独落成整张图
+    FilterGraph graph;
+    FilterGraph::Node gray = graph.filter(graph.input(), FILTER_GRAYSCALE);
+    FilterGraph::Node edges = graph.filter(graph.input(), FILTER_EDGE_DETECT);
+    FilterGraph::Node sketch = graph.mix(gray, edges,
+        [=](QRgb *line, const QRgb *edgeLine, int, int count, int y) {
+            std::mt19937 gen(seed + unsigned(y));
+            std::uniform_int_distribution<> dis(-20, 20);
+
+            for (int x = 0; x < count; ++x) {
+                int grayValue = qGray(line[x]);
+                int edge = qGray(edgeLine[x]);
+
+                // 铅笔效果：边缘部分变暗
+                int value = grayValue - edge * pencilIntensity;
+                value = clamp(value);
+
+                // 添加纸张纹理效果
+                if (paperIntensity > 0) {
+                    int noise = dis(gen) * paperIntensity;
+                    value = clamp(value + noise);
+                }
 
-    for (int y = 0; y < result.height(); ++y) {
-        QRgb *destLine = reinterpret_cast<QRgb*>(result.scanLine(y));
-        const QRgb *grayLine = reinterpret_cast<const QRgb*>(grayImage.scanLine(y));
-        const QRgb *edgeLine = reinterpret_cast<const QRgb*>(edgeImage.scanLine(y));
-
-        for (int x = 0; x < result.width(); ++x) {
-            int gray = qGray(grayLine[x]);
-            int edge = qGray(edgeLine[x]);
-
-            // 铅笔效果：边缘部分变暗
-            int value = gray - edge * pencilIntensity;
-            value = clamp(value);
-
-            // 添加纸张纹理效果
-            if (paperIntensity > 0) {
-                // 简单随机噪声模拟纸张纹理
-                std::random_device rd;
-                std::mt19937 gen(rd());
-                std::uniform_int_distribution<> dis(-20, 20);
-
-                int noise = dis(gen) * paperIntensity;
-                value = clamp(value + noise);
+                line[x] = qRgb(value, value, value);
             }
+        });
 
-            destLine[x] = qRgb(value, value, value);
-        }
-    }
-
-    return QPixmap::fromImage(result);
+    return graph.evaluate(original, sketch);
 }
 
 // 卡通效果
@@ -924,66 +1370,81 @@ QPixmap ImageEditor::applyCartoon(const QPixmap &original, int edgeThreshold, in
         return original;
     }
 
-    // 1. 边缘检测
-    QPixmap edges = applyFilter(original, FILTER_EDGE_DETECT);
-    QImage edgeImage = edges.toImage();
-
-    // 2. 颜色量化（减少颜色数量）
-    QImage quantized = original.toImage();
-    for (int y = 0; y < quantized.height(); ++y) {
-        QRgb *line = reinterpret_cast<QRgb*>(quantized.scanLine(y));
-        for (int x = 0; x < quantized.width(); ++x) {
-            QRgb pixel = line[x];
-
-            int r = qRed(pixel);
-            int g = qGreen(pixel);
-            int b = qBlue(pixel);
-
-            // 颜色量化
-            r = (r * colorLevels) / 256 * (256 / colorLevels);
-            g = (g * colorLevels) / 256 * (256 / colorLevels);
-            b = (b * colorLevels) / 256 * (256 / colorLevels);
+    return QPixmap::fromImage(applyCartoon(original.toImage(), edgeThreshold, colorLevels));
+}
 
-            line[x] = qRgb(r, g, b);
-        }
+QImage ImageEditor::applyCartoon(const QImage &original, int edgeThreshold, int colorLevels)
+{
+    if (original.isNull()) {
+        return original;
     }
 
-    // 3. 合并：用边缘图作为蒙版
-    QImage result = quantized;
-    for (int y = 0; y < result.height(); ++y) {
-        QRgb *line = reinterpret_cast<QRgb*>(result.scanLine(y));
-        const QRgb *edgeLine = reinterpret_cast<const QRgb*>(edgeImage.scanLine(y));
-
-        for (int x = 0; x < result.width(); ++x) {
-            int edgeValue = qGray(edgeLine[x]);
-
-            if (edgeValue < edgeThreshold) {
-                // 边缘部分变黑
-                line[x] = qRgb(0, 0, 0);
+    // 1. 边缘检测
+    QImage result = toWorkingFormat(original);
+    const QImage edgeImage = applyFilter(result, FILTER_EDGE_DETECT);
+
+    // 2. 颜色量化（减少颜色数量），查表
+    const int levels = qMax(1, colorLevels);
+    quint8 quantize[256];
+    for (int v = 0; v < 256; ++v) {
+        quantize[v] = quint8((v * levels) / 256 * (256 / levels));
+    }
+
+    // 3. 合并：用边缘图作为蒙版。量化和合并在同一遍里按行条带并行完成
+    uchar *resultBits = result.bits();
+    const int resultBpl = result.bytesPerLine();
+    const int width = result.width();
+    TileScheduler::forEachStrip(result, 0, [&](int firstRow, int lastRow) {
+        for (int y = firstRow; y < lastRow; ++y) {
+            QRgb *line = reinterpret_cast<QRgb*>(resultBits + y * resultBpl);
+            const QRgb *edgeLine = reinterpret_cast<const QRgb*>(edgeImage.constScanLine(y));
+
+            for (int x = 0; x < width; ++x) {
+                if (qGray(edgeLine[x]) < edgeThreshold) {
+                    // 边缘部分变黑
+                    line[x] = qRgb(0, 0, 0);
+                } else {
+                    const QRgb pixel = line[x];
+                    line[x] = qRgb(quantize[qRed(pixel)], quantize[qGreen(pixel)], quantize[qBlue(pixel)]);
+                }
             }
         }
-    }
+    });
 
     // 4. 轻微模糊平滑
     result = applyBlurFilter(result, 1);
 
-    return QPixmap::fromImage(result);
+    return result;
 }
 
 // 批量应用滤镜
+// QPixmap 只能在 GUI 线程里转换，先全部转成 QImage 再并行处理
 QVector<QPixmap> ImageEditor::applyFilterToAll(const QVector<QPixmap> &images,
                                                FilterType filter, qreal intensity)
 {
-    QVector<QPixmap> result;
-    result.reserve(images.size());
-
+    QVector<QImage> sources;
+    sources.reserve(images.size());
     for (const QPixmap &image : images) {
-        result.append(applyFilter(image, filter, intensity));
+        sources.append(image.toImage());
+    }
+
+    const QVector<QImage> filtered = applyFilterToAll(sources, filter, intensity);
+
+    QVector<QPixmap> result;
+    result.reserve(filtered.size());
+    for (const QImage &image : filtered) {
+        result.append(QPixmap::fromImage(image));
     }
 
     return result;
 }
 
+QVector<QImage> ImageEditor::applyFilterToAll(const QVector<QImage> &images,
+                                              FilterType filter, qreal intensity)
+{
+    return BatchFilterEngine::run(images, { FilterParams(filter, intensity) });
+}
+
 // 获取滤镜名称
 QString ImageEditor::getFilterName(FilterType filter)
 {
@@ -1094,7 +1555,16 @@ QPixmap ImageEditor::applyMotionBlur(const QPixmap &original, int angle, int dis
         return original;
     }
 
-    QImage image = original.toImage();
+    return QPixmap::fromImage(applyMotionBlur(original.toImage(), angle, distance));
+}
+
+QImage ImageEditor::applyMotionBlur(const QImage &original, int angle, int distance)
+{
+    if (original.isNull() || distance <= 0) {
+        return original;
+    }
+
+    const QImage image = toWorkingFormat(original);
     QImage result(image.size(), image.format());
     result.fill(Qt::transparent);
 
@@ -1103,38 +1573,47 @@ QPixmap ImageEditor::applyMotionBlur(const QPixmap &original, int angle, int dis
     qreal dx = qCos(rad);
     qreal dy = qSin(rad);
 
-    for (int y = 0; y < image.height(); ++y) {
-        QRgb *destLine = reinterpret_cast<QRgb*>(result.scanLine(y));
+    const int width = image.width();
+    const int height = image.height();
+    const uchar *srcBits = image.constBits();
+    const int srcBpl = image.bytesPerLine();
+    uchar *dstBits = result.bits();
+    const int dstBpl = result.bytesPerLine();
 
-        for (int x = 0; x < image.width(); ++x) {
-            qreal rSum = 0, gSum = 0, bSum = 0;
-            int count = 0;
+    TileScheduler::forEachStrip(result, distance, [&](int firstRow, int lastRow) {
+        for (int y = firstRow; y < lastRow; ++y) {
+            QRgb *destLine = reinterpret_cast<QRgb*>(dstBits + y * dstBpl);
+
+            for (int x = 0; x < width; ++x) {
+                qreal rSum = 0, gSum = 0, bSum = 0;
+                int count = 0;
 
-            // 沿着运动方向采样
-            for (int i = -distance; i <= distance; ++i) {
-                int sampleX = x + static_cast<int>(dx * i);
-                int sampleY = y + static_cast<int>(dy * i);
+                // 沿着运动方向采样
+                for (int i = -distance; i <= distance; ++i) {
+                    int sampleX = x + static_cast<int>(dx * i);
+                    int sampleY = y + static_cast<int>(dy * i);
 
-                if (sampleX >= 0 && sampleX < image.width() &&
-                    sampleY >= 0 && sampleY < image.height()) {
-                    QRgb pixel = image.pixel(sampleX, sampleY);
+                    if (sampleX >= 0 && sampleX < width &&
+                        sampleY >= 0 && sampleY < height) {
+                        QRgb pixel = reinterpret_cast<const QRgb*>(srcBits + sampleY * srcBpl)[sampleX];
 
-                    rSum += qRed(pixel);
-                    gSum += qGreen(pixel);
-                    bSum += qBlue(pixel);
-                    count++;
+                        rSum += qRed(pixel);
+                        gSum += qGreen(pixel);
+                        bSum += qBlue(pixel);
+                        count++;
+                    }
                 }
-            }
 
-            if (count > 0) {
-                destLine[x] = qRgb(static_cast<int>(rSum / count),
-                                   static_cast<int>(gSum / count),
-                                   static_cast<int>(bSum / count));
+                if (count > 0) {
+                    destLine[x] = qRgb(static_cast<int>(rSum / count),
+                                       static_cast<int>(gSum / count),
+                                       static_cast<int>(bSum / count));
+                }
             }
         }
-    }
+    });
 
-    return QPixmap::fromImage(result);
+    return result;
 }
 
 // 径向模糊
@@ -1144,52 +1623,72 @@ QPixmap ImageEditor::applyRadialBlur(const QPixmap &original, const QPoint &cent
         return original;
     }
 
-    QImage image = original.toImage();
-    QImage result(image.size(), image.format());
-
-    for (int y = 0; y < image.height(); ++y) {
-        QRgb *destLine = reinterpret_cast<QRgb*>(result.scanLine(y));
-
-        for (int x = 0; x < image.width(); ++x) {
-            // 计算到中心的距离和角度
-            qreal dx = x - center.x();
-            qreal dy = y - center.y();
-            qreal distance = qSqrt(dx * dx + dy * dy);
-            qreal angle = qAtan2(dy, dx);
-
-            qreal rSum = 0, gSum = 0, bSum = 0;
-            int count = 0;
+    return QPixmap::fromImage(applyRadialBlur(original.toImage(), center, strength));
+}
 
-            // 沿着径向采样
-            for (int i = -strength; i <= strength; ++i) {
-                int sampleDistance = static_cast<int>(distance + i);
-                if (sampleDistance < 0) continue;
+QImage ImageEditor::applyRadialBlur(const QImage &original, const QPoint &center, int strength)
+{
+    if (original.isNull() || strength <= 0) {
+        return original;
+    }
 
-                int sampleX = center.x() + static_cast<int>(qCos(angle) * sampleDistance);
-                int sampleY = center.y() + static_cast<int>(qSin(angle) * sampleDistance);
+    const QImage image = toWorkingFormat(original);
+    QImage result(image.size(), image.format());
 
-                if (sampleX >= 0 && sampleX < image.width() &&
-                    sampleY >= 0 && sampleY < image.height()) {
-                    QRgb pixel = image.pixel(sampleX, sampleY);
+    const int width = image.width();
+    const int height = image.height();
+    const uchar *srcBits = image.constBits();
+    const int srcBpl = image.bytesPerLine();
+    uchar *dstBits = result.bits();
+    const int dstBpl = result.bytesPerLine();
+
+    TileScheduler::forEachStrip(result, 0, [&](int firstRow, int lastRow) {
+        for (int y = firstRow; y < lastRow; ++y) {
+            QRgb *destLine = reinterpret_cast<QRgb*>(dstBits + y * dstBpl);
+
+            for (int x = 0; x < width; ++x) {
+                // 计算到中心的距离和角度
+                qreal dx = x - center.x();
+                qreal dy = y - center.y();
+                qreal distance = qSqrt(dx * dx + dy * dy);
+                qreal angle = qAtan2(dy, dx);
+                qreal cosAngle = qCos(angle);
+                qreal sinAngle = qSin(angle);
+
+                qreal rSum = 0, gSum = 0, bSum = 0;
+                int count = 0;
+
+                // 沿着径向采样
+                for (int i = -strength; i <= strength; ++i) {
+                    int sampleDistance = static_cast<int>(distance + i);
+                    if (sampleDistance < 0) continue;
+
+                    int sampleX = center.x() + static_cast<int>(cosAngle * sampleDistance);
+                    int sampleY = center.y() + static_cast<int>(sinAngle * sampleDistance);
+
+                    if (sampleX >= 0 && sampleX < width &&
+                        sampleY >= 0 && sampleY < height) {
+                        QRgb pixel = reinterpret_cast<const QRgb*>(srcBits + sampleY * srcBpl)[sampleX];
 
-                    rSum += qRed(pixel);
-                    gSum += qGreen(pixel);
-                    bSum += qBlue(pixel);
-                    count++;
+                        rSum += qRed(pixel);
+                        gSum += qGreen(pixel);
+                        bSum += qBlue(pixel);
+                        count++;
+                    }
                 }
-            }
 
-            if (count > 0) {
-                destLine[x] = qRgb(static_cast<int>(rSum / count),
-                                   static_cast<int>(gSum / count),
-                                   static_cast<int>(bSum / count));
-            } else {
-                destLine[x] = image.pixel(x, y);
+                if (count > 0) {
+                    destLine[x] = qRgb(static_cast<int>(rSum / count),
+                                       static_cast<int>(gSum / count),
+                                       static_cast<int>(bSum / count));
+                } else {
+                    destLine[x] = reinterpret_cast<const QRgb*>(srcBits + y * srcBpl)[x];
+                }
             }
         }
-    }
+    });
 
-    return QPixmap::fromImage(result);
+    return result;
 }
 
 // 水彩画效果
@@ -1199,37 +1698,49 @@ QPixmap ImageEditor::applyWatercolor(const QPixmap &original, int brushSize)
         return original;
     }
 
-    // 首先应用油画效果
-    QPixmap oilPaint = applyOilPaint(original, brushSize / 2);
-
-    // 然后添加纸张纹理
-    QImage result = oilPaint.toImage();
+    return QPixmap::fromImage(applyWatercolor(original.toImage(), brushSize));
+}
 
-    // 添加轻微噪点模拟水彩纸纹理
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> dis(-10, 10);
-
-    for (int y = 0; y < result.height(); ++y) {
-        QRgb *line = reinterpret_cast<QRgb*>(result.scanLine(y));
-        for (int x = 0; x < result.width(); ++x) {
-            if ((x + y) % 3 == 0) { // 随机间隔添加纹理
-                int noise = dis(gen);
-                QRgb pixel = line[x];
+QImage ImageEditor::applyWatercolor(const QImage &original, int brushSize)
+{
+    if (original.isNull() || brushSize <= 0) {
+        return original;
+    }
 
-                int r = clamp(qRed(pixel) + noise);
-                int g = clamp(qGreen(pixel) + noise);
-                int b = clamp(qBlue(pixel) + noise);
+    // 首先应用油画效果，然后添加纸张纹理
+    QImage result = toWorkingFormat(applyOilPaint(original, brushSize / 2));
 
-                line[x] = qRgb(r, g, b);
+    // 添加轻微噪点模拟水彩纸纹理：每次调用取一个种子，每行一个发生器，按条带并行
+    std::random_device rd;
+    const unsigned int seed = rd();
+    uchar *bits = result.bits();
+    const int bytesPerLine = result.bytesPerLine();
+    const int width = result.width();
+
+    TileScheduler::forEachStrip(result, 0, [&](int firstRow, int lastRow) {
+        for (int y = firstRow; y < lastRow; ++y) {
+            std::mt19937 gen(seed + unsigned(y));
+            std::uniform_int_distribution<> dis(-10, 10);
+            QRgb *line = reinterpret_cast<QRgb*>(bits + y * bytesPerLine);
+            for (int x = 0; x < width; ++x) {
+                if ((x + y) % 3 == 0) { // 随机间隔添加纹理
+                    int noise = dis(gen);
+                    QRgb pixel = line[x];
+
+                    int r = clamp(qRed(pixel) + noise);
+                    int g = clamp(qGreen(pixel) + noise);
+                    int b = clamp(qBlue(pixel) + noise);
+
+                    line[x] = qRgb(r, g, b);
+                }
             }
         }
-    }
+    });
 
     // 轻微模糊让颜色融合
     result = applyBlurFilter(result, 1);
 
-    return QPixmap::fromImage(result);
+    return result;
 }
 
 // 木炭画效果
@@ -1239,34 +1750,50 @@ QPixmap ImageEditor::applyCharcoal(const QPixmap &original, int charcoalSize)
         return original;
     }
 
-    // 创建高对比度灰度图
-    QPixmap grayscale = applyFilter(original, FILTER_GRAYSCALE);
-    QPixmap highContrast = applyAdjustments(grayscale, AdjustParams{0.0, 0.3, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0});
+    return QPixmap::fromImage(applyCharcoal(original.toImage(), charcoalSize));
+}
+
+QImage ImageEditor::applyCharcoal(const QImage &original, int charcoalSize)
+{
+    if (original.isNull() || charcoalSize <= 0) {
+        return original;
+    }
+
+    // 创建高对比度灰度图（同一张图上原地完成）
+    QImage result = toWorkingFormat(original);
+    applyGrayscaleFilter(result);
+    applyAdjustmentsInPlace(result, AdjustParams{0.0, 0.3, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0});
 
     // 应用运动模糊模拟木炭笔触
-    QPixmap charcoal = applyMotionBlur(highContrast, 45, charcoalSize);
+    result = applyMotionBlur(result, 45, charcoalSize);
 
     // 反转颜色
-    QImage result = applyInvertFilter(charcoal.toImage());
+    result = applyInvertFilter(result);
 
-    // 添加颗粒感
+    // 添加颗粒感：同水彩纹理，每行一个发生器，按条带并行
     std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> dis(0, 30);
-
-    for (int y = 0; y < result.height(); ++y) {
-        QRgb *line = reinterpret_cast<QRgb*>(result.scanLine(y));
-        for (int x = 0; x < result.width(); ++x) {
-            if ((x + y) % 4 == 0) { // 添加随机颗粒
-                int grain = dis(gen);
-                int gray = qGray(line[x]);
-                gray = clamp(gray - grain);
-                line[x] = qRgb(gray, gray, gray);
+    const unsigned int seed = rd();
+    uchar *bits = result.bits();
+    const int bytesPerLine = result.bytesPerLine();
+    const int width = result.width();
+
+    TileScheduler::forEachStrip(result, 0, [&](int firstRow, int lastRow) {
+        for (int y = firstRow; y < lastRow; ++y) {
+            std::mt19937 gen(seed + unsigned(y));
+            std::uniform_int_distribution<> dis(0, 30);
+            QRgb *line = reinterpret_cast<QRgb*>(bits + y * bytesPerLine);
+            for (int x = 0; x < width; ++x) {
+                if ((x + y) % 4 == 0) { // 添加随机颗粒
+                    int grain = dis(gen);
+                    int gray = qGray(line[x]);
+                    gray = clamp(gray - grain);
+                    line[x] = qRgb(gray, gray, gray);
+                }
             }
         }
-    }
+    });
 
-    return QPixmap::fromImage(result);
+    return result;
 }
 
 // 亮度调整
@@ -1300,25 +1827,31 @@ QPixmap ImageEditor::adjustHue(const QPixmap &original, qreal value)
         return original;
     }
 
-    QImage image = original.toImage();
-    QImage result = image.copy();
+    return QPixmap::fromImage(adjustHue(original.toImage(), value));
+}
+
+QImage ImageEditor::adjustHue(const QImage &original, qreal value)
+{
+    if (original.isNull()) {
+        return original;
+    }
 
-    for (int y = 0; y < result.height(); ++y) {
-        QRgb *line = reinterpret_cast<QRgb*>(result.scanLine(y));
-        for (int x = 0; x < result.width(); ++x) {
-            QColor color(line[x]);
-            QColor hsv = color.toHsv();
+    QImage result = toWorkingFormat(original);
 
-            qreal hue = hsv.hsvHueF() + value;
-            while (hue < 0) hue += 1.0;
-            while (hue > 1) hue -= 1.0;
+    // HSV 往返只在格点上做一次，之后每像素查表
+    ColorLut lut = ColorLut::bake([value](QRgb pixel) {
+        QColor hsv = QColor(pixel).toHsv();
 
-            hsv.setHsvF(hue, hsv.hsvSaturationF(), hsv.valueF());
-            line[x] = hsv.toRgb().rgb();
-        }
-    }
+        qreal hue = hsv.hsvHueF() + value;
+        while (hue < 0) hue += 1.0;
+        while (hue > 1) hue -= 1.0;
 
-    return QPixmap::fromImage(result);
+        hsv.setHsvF(hue, hsv.hsvSaturationF(), hsv.valueF());
+        return hsv.toRgb().rgb();
+    });
+    lut.apply(result);
+
+    return result;
 }
 
 // 色温调整
@@ -1344,10 +1877,18 @@ QPixmap ImageEditor::adjustGamma(const QPixmap &original, qreal value)
         return original;
     }
 
-    QImage image = original.toImage();
-    QImage result = image.copy();
+    return QPixmap::fromImage(adjustGamma(original.toImage(), value));
+}
+
+QImage ImageEditor::adjustGamma(const QImage &original, qreal value)
+{
+    if (original.isNull() || qAbs(value - 1.0) < 0.01) {
+        return original;
+    }
 
-    // 预计算Gamma表
+    QImage result = toWorkingFormat(original);
+
+    // 预计算Gamma表（按通道独立，放在查找表的一维曲线里）
     QVector<int> gammaTable(256);
     qreal invGamma = 1.0 / value;
 
@@ -1355,109 +1896,118 @@ QPixmap ImageEditor::adjustGamma(const QPixmap &original, qreal value)
         gammaTable[i] = clamp(static_cast<int>(qPow(i / 255.0, invGamma) * 255.0));
     }
 
-    for (int y = 0; y < result.height(); ++y) {
-        QRgb *line = reinterpret_cast<QRgb*>(result.scanLine(y));
-        for (int x = 0; x < result.width(); ++x) {
-            QRgb pixel = line[x];
-
-            int r = gammaTable[qRed(pixel)];
-            int g = gammaTable[qGreen(pixel)];
-            int b = gammaTable[qBlue(pixel)];
-
-            line[x] = qRgb(r, g, b);
-        }
-    }
+    ColorLut::fromCurve(gammaTable).apply(result);
 
-    return QPixmap::fromImage(result);
+    return result;
 }
 
-// 图像混合
-
-
 // 创建遮罩
 QPixmap ImageEditor::createMask(const QSize &size, MaskType type)
 {
-    QPixmap mask(size);
-    mask.fill(Qt::transparent);
-
-    QPainter painter(&mask);
-    painter.setRenderHint(QPainter::Antialiasing);
-    painter.setBrush(Qt::white);
-    painter.setPen(Qt::NoPen);
-
-    QRectF rect(0, 0, size.width(), size.height());
+    QImage coverage;
 
     switch (type) {
     case Circle:
-        painter.drawEllipse(rect);
-        break;
-    case Rectangle:
-        painter.drawRect(rect);
+        coverage = MaskCache::ellipse(size);
         break;
+    case Rectangle: {
+        QPixmap mask(size);
+        mask.fill(Qt::white);
+        return mask;
+    }
     case RoundedRect:
-        painter.drawRoundedRect(rect, 20, 20);
+        coverage = MaskCache::roundedRect(size, 20);
         break;
-    case Heart: {
-        QPainterPath path;
-        qreal width = rect.width();
-        qreal height = rect.height();
-
-        path.moveTo(width / 2, height / 4);
-        path.cubicTo(width * 0.1, height * 0.1,
-                     0, height * 0.3,
-                     width / 2, height * 0.9);
-        path.cubicTo(width, height * 0.3,
-                     width * 0.9, height * 0.1,
-                     width / 2, height / 4);
-        painter.drawPath(path);
+    case Heart:
+        coverage = MaskCache::coverage(QStringLiteral("editor-heart"), size, [](const QRectF &rect) {
+            QPainterPath path;
+            qreal width = rect.width();
+            qreal height = rect.height();
+
+            path.moveTo(width / 2, height / 4);
+            path.cubicTo(width * 0.1, height * 0.1,
+                         0, height * 0.3,
+                         width / 2, height * 0.9);
+            path.cubicTo(width, height * 0.3,
+                         width * 0.9, height * 0.1,
+                         width / 2, height / 4);
+            return path;
+        });
         break;
-    }
-    case Star: {
-        QPainterPath path;
-        QPointF center = rect.center();
-        qreal radius = qMin(rect.width(), rect.height()) / 2;
-
-        for (int i = 0; i < 5; ++i) {
-            qreal angle = 2 * M_PI * i / 5 - M_PI_2;
-            QPointF outer(center.x() + radius * qCos(angle),
-                          center.y() + radius * qSin(angle));
-
-            if (i == 0) path.moveTo(outer);
-            else path.lineTo(outer);
-
-            qreal innerAngle = angle + M_PI / 5;
-            QPointF inner(center.x() + radius * 0.5 * qCos(innerAngle),
-                          center.y() + radius * 0.5 * qSin(innerAngle));
-            path.lineTo(inner);
-        }
-        path.closeSubpath();
-        painter.drawPath(path);
+    case Star:
+        coverage = MaskCache::coverage(QStringLiteral("editor-star"), size, [](const QRectF &rect) {
+            QPainterPath path;
+            QPointF center = rect.center();
+            qreal radius = qMin(rect.width(), rect.height()) / 2;
+
+            for (int i = 0; i < 5; ++i) {
+                qreal angle = 2 * M_PI * i / 5 - M_PI_2;
+                QPointF outer(center.x() + radius * qCos(angle),
+                              center.y() + radius * qSin(angle));
+
+                if (i == 0) path.moveTo(outer);
+                else path.lineTo(outer);
+
+                qreal innerAngle = angle + M_PI / 5;
+                QPointF inner(center.x() + radius * 0.5 * qCos(innerAngle),
+                              center.y() + radius * 0.5 * qSin(innerAngle));
+                path.lineTo(inner);
+            }
+            path.closeSubpath();
+            return path;
+        });
         break;
-    }
     case Ellipse:
-        painter.drawEllipse(rect.adjusted(10, 20, -10, -20));
+        coverage = MaskCache::coverage(QStringLiteral("editor-ellipse"), size, [](const QRectF &rect) {
+            QPainterPath path;
+            path.addEllipse(rect.adjusted(10, 20, -10, -20));
+            return path;
+        });
         break;
-    case Polygon: {
-        QPainterPath path;
-        int sides = 6;
-        QPointF center = rect.center();
-        qreal radius = qMin(rect.width(), rect.height()) / 2;
-
-        for (int i = 0; i <= sides; ++i) {
-            qreal angle = 2 * M_PI * i / sides - M_PI_2;
-            QPointF point(center.x() + radius * qCos(angle),
-                          center.y() + radius * qSin(angle));
-
-            if (i == 0) path.moveTo(point);
-            else path.lineTo(point);
-        }
-        painter.drawPath(path);
+    case Polygon:
+        coverage = MaskCache::coverage(QStringLiteral("editor-polygon"), size, [](const QRectF &rect) {
+            QPainterPath path;
+            int sides = 6;
+            QPointF center = rect.center();
+            qreal radius = qMin(rect.width(), rect.height()) / 2;
+
+            for (int i = 0; i <= sides; ++i) {
+                qreal angle = 2 * M_PI * i / sides - M_PI_2;
+                QPointF point(center.x() + radius * qCos(angle),
+                              center.y() + radius * qSin(angle));
+
+                if (i == 0) path.moveTo(point);
+                else path.lineTo(point);
+            }
+            return path;
+        });
         break;
     }
-    }
 
-    painter.end();
-    return mask;
+    if (coverage.isNull()) {
+        QPixmap mask(size);
+        mask.fill(Qt::transparent);
+        return mask;
+    }
+
+    // 覆盖率 a 对应预乘白色 (a, a, a, a)
+    QImage mask(size, QImage::Format_ARGB32_Premultiplied);
+    const uchar *coverBits = coverage.constBits();
+    const int coverBytesPerLine = coverage.bytesPerLine();
+    uchar *bits = mask.bits();
+    const int bytesPerLine = mask.bytesPerLine();
+    const int width = size.width();
+    TileScheduler::forEachStrip(mask, 0, [&](int firstRow, int lastRow) {
+        for (int y = firstRow; y < lastRow; ++y) {
+            const uchar *cover = coverBits + y * coverBytesPerLine;
+            QRgb *line = reinterpret_cast<QRgb *>(bits + y * bytesPerLine);
+            for (int x = 0; x < width; ++x) {
+                line[x] = cover[x] * 0x01010101u;
+            }
+        }
+    });
+
+    return QPixmap::fromImage(mask);
 }
 
 // 获取主色调
@@ -1510,12 +2060,22 @@ QPixmap ImageEditor::smoothSkin(const QPixmap &original, qreal intensity)
         return original;
     }
 
+    return QPixmap::fromImage(smoothSkin(original.toImage(), intensity));
+}
+
+QImage ImageEditor::smoothSkin(const QImage &original, qreal intensity)
+{
+    if (original.isNull()) {
+        return original;
+    }
+
     // 应用高斯模糊来平滑皮肤
+    const QImage source = toWorkingFormat(original);
     int blurRadius = static_cast<int>(intensity * 10);
-    QPixmap blurred = applyBlur(original, blurRadius);
+    QImage blurred = applyBlur(source, blurRadius);
 
     // 将模糊后的图像与原图混合
-    return blendImages(original, blurred, intensity * 0.5, Normal);
+    return blendImages(source, blurred, intensity * 0.5, Normal);
 }
 
 // 增强眼睛（简化版）
@@ -1535,6 +2095,15 @@ QPixmap ImageEditor::enhanceEyes(const QPixmap &original, qreal intensity)
     return applyAdjustments(original, params);
 }
 
+QImage ImageEditor::enhanceEyes(const QImage &original, qreal intensity)
+{
+    AdjustParams params;
+    params.contrast = intensity * 0.2;
+    params.saturation = intensity * 0.1;
+
+    return applyAdjustments(original, params);
+}
+
 // 美白牙齿（简化版）
 QPixmap ImageEditor::whitenTeeth(const QPixmap &original, qreal intensity)
 {
@@ -1542,29 +2111,28 @@ QPixmap ImageEditor::whitenTeeth(const QPixmap &original, qreal intensity)
         return original;
     }
 
-    QImage image = original.toImage();
-    QImage result = image.copy();
-
-    // 简化版：整体增加蓝色通道，减少红色通道
-    for (int y = 0; y < result.height(); ++y) {
-        QRgb *line = reinterpret_cast<QRgb*>(result.scanLine(y));
-        for (int x = 0; x < result.width(); ++x) {
-            QRgb pixel = line[x];
+    return QPixmap::fromImage(whitenTeeth(original.toImage(), intensity));
+}
 
-            int r = qRed(pixel);
-            int g = qGreen(pixel);
-            int b = qBlue(pixel);
+QImage ImageEditor::whitenTeeth(const QImage &original, qreal intensity)
+{
+    if (original.isNull()) {
+        return original;
+    }
 
-            // 向蓝色偏移（牙齿美白效果）
-            r = clamp(r - intensity * 20);
-            g = clamp(g + intensity * 10);
-            b = clamp(b + intensity * 30);
+    QImage result = toWorkingFormat(original);
 
-            line[x] = qRgb(r, g, b);
-        }
+    // 简化版：整体增加蓝色通道，减少红色通道。各通道独立，用一维曲线即可
+    QVector<int> red(256), green(256), blue(256);
+    for (int v = 0; v < 256; ++v) {
+        // 向蓝色偏移（牙齿美白效果）
+        red[v] = clamp(v - intensity * 20);
+        green[v] = clamp(v + intensity * 10);
+        blue[v] = clamp(v + intensity * 30);
     }
+    ColorLut::fromCurves(red, green, blue).apply(result);
 
-    return QPixmap::fromImage(result);
+    return result;
 }
 
 
@@ -1580,6 +2148,15 @@ QPixmap ImageEditor::applyBlur(const QPixmap &original, int radius)
     return applyFilter(original, FILTER_BLUR, radius / 10.0);
 }
 
+QImage ImageEditor::applyBlur(const QImage &original, int radius)
+{
+    if (original.isNull() || radius <= 0) {
+        return original;
+    }
+
+    return applyFilter(original, FILTER_BLUR, radius / 10.0);
+}
+
 // 图像混合
 QPixmap ImageEditor::blendImages(const QPixmap &base, const QPixmap &overlay,
                                  qreal opacity, BlendMode mode)
@@ -1587,59 +2164,108 @@ QPixmap ImageEditor::blendImages(const QPixmap &base, const QPixmap &overlay,
     if (base.isNull()) return overlay;
     if (overlay.isNull()) return base;
 
+    return QPixmap::fromImage(blendImages(base.toImage(), overlay.toImage(), opacity, mode));
+}
+
+QImage ImageEditor::blendImages(const QImage &base, const QImage &overlay,
+                                qreal opacity, BlendMode mode)
+{
+    if (base.isNull()) return overlay;
+    if (overlay.isNull()) return base;
+
     // 确保overlay与base尺寸相同
-    QPixmap scaledOverlay = overlay.scaled(base.size(), Qt::KeepAspectRatioByExpanding);
+    QImage scaledOverlay = overlay.size() == base.size()
+                               ? overlay
+                               : overlay.scaled(base.size(), Qt::KeepAspectRatioByExpanding);
 
     // 创建结果图像
-    QPixmap result = base.copy();
+    QImage result = toWorkingFormat(base);
     QPainter painter(&result);
+    painter.setCompositionMode(compositionModeFor(mode));
 
-    // 设置混合模式
+    // 设置不透明度
+    painter.setOpacity(opacity);
+
+    // 绘制叠加图像
+    painter.drawImage(0, 0, scaledOverlay);
+    painter.end();
+
+    return result;
+}
+
+// 单通道的可分离混合公式（与 QPainter 对应的合成模式一致），取值 0-255
+int ImageEditor::blendChannel(int base, int overlay, BlendMode mode)
+{
     switch (mode) {
     case Normal:
-        painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
-        break;
+        return overlay;
     case Multiply:
-        painter.setCompositionMode(QPainter::CompositionMode_Multiply);
-        break;
+        return (base * overlay + 127) / 255;
     case Screen:
-        painter.setCompositionMode(QPainter::CompositionMode_Screen);
-        break;
+        return base + overlay - (base * overlay + 127) / 255;
     case Overlay:
-        painter.setCompositionMode(QPainter::CompositionMode_Overlay);
-        break;
-    case SoftLight:
-        painter.setCompositionMode(QPainter::CompositionMode_SoftLight);
-        break;
+        return base < 128 ? (2 * base * overlay + 127) / 255
+                          : 255 - (2 * (255 - base) * (255 - overlay) + 127) / 255;
+    case SoftLight: {
+        const qreal b = base / 255.0;
+        const qreal o = overlay / 255.0;
+        qreal result;
+        if (o <= 0.5) {
+            result = b - (1 - 2 * o) * b * (1 - b);
+        } else {
+            const qreal d = b <= 0.25 ? ((16 * b - 12) * b + 4) * b : qSqrt(b);
+            result = b + (2 * o - 1) * (d - b);
+        }
+        return qBound(0, qRound(result * 255), 255);
+    }
     case HardLight:
-        painter.setCompositionMode(QPainter::CompositionMode_HardLight);
-        break;
+        return overlay < 128 ? (2 * base * overlay + 127) / 255
+                             : 255 - (2 * (255 - base) * (255 - overlay) + 127) / 255;
     case ColorDodge:
-        painter.setCompositionMode(QPainter::CompositionMode_ColorDodge);
-        break;
+        if (base == 0) return 0;
+        return overlay >= 255 ? 255 : qMin(255, base * 255 / (255 - overlay));
     case ColorBurn:
-        painter.setCompositionMode(QPainter::CompositionMode_ColorBurn);
-        break;
+        if (base == 255) return 255;
+        return overlay <= 0 ? 0 : 255 - qMin(255, (255 - base) * 255 / overlay);
     case Darken:
-        painter.setCompositionMode(QPainter::CompositionMode_Darken);
-        break;
+        return qMin(base, overlay);
     case Lighten:
-        painter.setCompositionMode(QPainter::CompositionMode_Lighten);
-        break;
+        return qMax(base, overlay);
     case Difference:
-        painter.setCompositionMode(QPainter::CompositionMode_Difference);
-        break;
+        return qAbs(base - overlay);
     case Exclusion:
-        painter.setCompositionMode(QPainter::CompositionMode_Exclusion);
-        break;
+        return base + overlay - (2 * base * overlay + 127) / 255;
     }
+    return overlay;
+}
 
-    // 设置不透明度
-    painter.setOpacity(opacity);
-
-    // 绘制叠加图像
-    painter.drawPixmap(0, 0, scaledOverlay);
-    painter.end();
-
-    return result;
+QPainter::CompositionMode ImageEditor::compositionModeFor(BlendMode mode)
+{
+    switch (mode) {
+    case Normal:
+        return QPainter::CompositionMode_SourceOver;
+    case Multiply:
+        return QPainter::CompositionMode_Multiply;
+    case Screen:
+        return QPainter::CompositionMode_Screen;
+    case Overlay:
+        return QPainter::CompositionMode_Overlay;
+    case SoftLight:
+        return QPainter::CompositionMode_SoftLight;
+    case HardLight:
+        return QPainter::CompositionMode_HardLight;
+    case ColorDodge:
+        return QPainter::CompositionMode_ColorDodge;
+    case ColorBurn:
+        return QPainter::CompositionMode_ColorBurn;
+    case Darken:
+        return QPainter::CompositionMode_Darken;
+    case Lighten:
+        return QPainter::CompositionMode_Lighten;
+    case Difference:
+        return QPainter::CompositionMode_Difference;
+    case Exclusion:
+        return QPainter::CompositionMode_Exclusion;
+    }
+    return QPainter::CompositionMode_SourceOver;
 }
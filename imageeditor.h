@@ -15,6 +15,8 @@
 #include <QRadialGradient>
 #include <QLinearGradient>
 
+class ColorLut;
+
 // 滤镜类型枚举
 enum FilterType {
     FILTER_NONE = 0,
@@ -94,6 +96,14 @@ struct AdjustParams {
                  qreal e, qreal hi, qreal sh, qreal v)
         : brightness(b), contrast(c), saturation(s), temperature(t),
         exposure(e), highlights(hi), shadows(sh), vibrance(v) {}
+
+    // 全部为 0 时不改变图像
+    bool isIdentity() const
+    {
+        return qFuzzyIsNull(brightness) && qFuzzyIsNull(contrast) && qFuzzyIsNull(saturation) &&
+               qFuzzyIsNull(temperature) && qFuzzyIsNull(exposure) && qFuzzyIsNull(highlights) &&
+               qFuzzyIsNull(shadows) && qFuzzyIsNull(vibrance);
+    }
 };
 
 // 滤镜参数结构体
@@ -105,12 +115,16 @@ struct FilterParams {
     FilterParams(FilterType t = FILTER_NONE, qreal i = 1.0)
         : type(t), intensity(i)
     {}
+
+    bool isIdentity() const { return type == FILTER_NONE && adjust.isIdentity(); }
 };
 
 class ImageEditor : public QObject
 {
     Q_OBJECT
 
+    friend class FilterGraph;   // 滤镜图直接复用下面的逐像素实现和查找表
+
 public:
     explicit ImageEditor(QObject *parent = nullptr);
 
@@ -128,9 +142,11 @@ public:
     static QPixmap applyAdjustments(const QPixmap &original, const AdjustParams &params);
     static QPixmap applyFilterWithParams(const QPixmap &original, const FilterParams &params);
 
-    // 批量操作
+    // 批量操作：多张图并行处理，结果与输入一一对应（大批量异步处理见 BatchFilterEngine）
     static QVector<QPixmap> applyFilterToAll(const QVector<QPixmap> &images,
                                              FilterType filter, qreal intensity = 1.0);
+    static QVector<QImage> applyFilterToAll(const QVector<QImage> &images,
+                                            FilterType filter, qreal intensity = 1.0);
 
     // 高级编辑功能
     static QPixmap addBorder(const QPixmap &original, int borderWidth,
@@ -184,36 +200,102 @@ public:
     static QString getFilterName(FilterType filter);
     static QStringList getAvailableFilters();
 
+    // QImage 接口
+    // 统一在 ARGB32_Premultiplied 上处理：输入只转换一次，组合滤镜内部各步骤之间不再转换，
+    // 也不经过 QPixmap，可在非 GUI 线程调用。上面的 QPixmap 版本只在 GUI 边界转换一次
+    static QImage toWorkingFormat(const QImage &image);
+
+    static QImage cropImage(const QImage &image, const QRect &rect);
+    static QImage resizeImage(const QImage &image, const QSize &size, bool keepAspectRatio = true);
+    static QImage rotateImage(const QImage &image, qreal degrees);
+    static QImage flipHorizontal(const QImage &image);
+    static QImage flipVertical(const QImage &image);
+
+    static QImage applyFilter(const QImage &image, FilterType filter, qreal intensity = 1.0);
+    static QImage applyAdjustments(const QImage &image, const AdjustParams &params);
+    static QImage applyFilterWithParams(const QImage &image, const FilterParams &params);
+
+    static QImage addVignette(const QImage &image, qreal intensity = 0.7,
+                              const QColor &color = Qt::black);
+    static QImage addTiltShift(const QImage &image, const QPoint &focusCenter,
+                               int focusSize = 100, qreal blurIntensity = 0.7);
+
+    static QImage applyBlur(const QImage &image, int radius);
+    static QImage applyMotionBlur(const QImage &image, int angle, int distance);
+    static QImage applyRadialBlur(const QImage &image, const QPoint &center, int strength = 10);
+
+    static QImage applyWatercolor(const QImage &image, int brushSize = 8);
+    static QImage applyOilPaint(const QImage &image, int radius = 4);
+    static QImage applyPencilSketch(const QImage &image, qreal pencilIntensity = 0.5,
+                                    qreal paperIntensity = 0.3);
+    static QImage applyCharcoal(const QImage &image, int charcoalSize = 3);
+    static QImage applyCartoon(const QImage &image, int edgeThreshold = 20, int colorLevels = 8);
+
+    static QImage adjustHue(const QImage &image, qreal value);
+    static QImage adjustGamma(const QImage &image, qreal value);
+
+    static QImage blendImages(const QImage &base, const QImage &overlay,
+                              qreal opacity = 0.5, BlendMode mode = BlendMode::Normal);
+
+    static QImage smoothSkin(const QImage &image, qreal intensity = 0.5);
+    static QImage enhanceEyes(const QImage &image, qreal intensity = 0.3);
+    static QImage whitenTeeth(const QImage &image, qreal intensity = 0.4);
+
+    // 原地版本：32 位格式（RGB32 / ARGB32 / 预乘）直接在原缓冲上改写，其余格式先转成工作格式；
+    // 邻域滤镜把新结果赋回 image
+    static void applyFilterInPlace(QImage &image, FilterType filter, qreal intensity = 1.0);
+    static void applyAdjustmentsInPlace(QImage &image, const AdjustParams &params);
+    static void addVignetteInPlace(QImage &image, qreal intensity = 0.7,
+                                   const QColor &color = Qt::black);
+
 
 
 
 private:
-    // 滤镜实现
-    static QImage applyGrayscaleFilter(const QImage &image);
-    static QImage applySepiaFilter(const QImage &image, qreal intensity = 1.0);
-    static QImage applyVintageFilter(const QImage &image);
+    // 滤镜实现（逐像素的原地处理）
+    static void applyGrayscaleFilter(QImage &image);
+    static void applySepiaFilter(QImage &image, qreal intensity = 1.0);
+    static void applyVintageFilter(QImage &image);
+    static void applyLomoFilter(QImage &image, qreal intensity = 1.0);
+    static void applyCrossProcessFilter(QImage &image);
     static QImage applyBlurFilter(const QImage &image, int radius);
     static QImage applySharpenFilter(const QImage &image, qreal intensity = 1.0);
     static QImage applyEmbossFilter(const QImage &image);
     static QImage applyEdgeDetectFilter(const QImage &image);
     static QImage applyInvertFilter(const QImage &image);
-    static QImage applyLomoFilter(const QImage &image, qreal intensity = 1.0);
     static QImage applyCinematicFilter(const QImage &image);
-    static QImage applyCrossProcessFilter(const QImage &image);
+
+    // 逐像素滤镜对应的查找表
+    static ColorLut grayscaleLut();
+    static ColorLut sepiaLut(qreal intensity);
+    static ColorLut crossProcessLut();
+    static bool pointFilterLut(FilterType filter, qreal intensity, ColorLut *lut);
+    static ColorLut adjustmentLut(const AdjustParams &params, qreal averageLuminance);
 
     // 卷积滤波
     static QImage applyConvolution(const QImage &image, const QVector<QVector<qreal>> &kernel);
-    static QVector<QVector<qreal>> getGaussianKernel(int size, qreal sigma);
     static QVector<QVector<qreal>> getSharpenKernel(qreal intensity);
     static QVector<QVector<qreal>> getEmbossKernel();
     static QVector<QVector<qreal>> getEdgeDetectKernel();
 
+    // 快速模糊：可分离高斯 / 滑动窗口盒式模糊，定点运算，边缘像素按夹取延伸
+    static QImage gaussianBlur(const QImage &image, int radius, qreal sigma);
+    static QImage boxBlur(const QImage &image, int radius, int passes = 1);
+    static QImage approximateGaussianBlur(const QImage &image, qreal sigma);   // 三次盒式模糊逼近高斯
+    static QVector<int> getGaussianWeights(int radius, qreal sigma);           // 一维 Q16 权重，和为 65536
+
     // 颜色处理
+    static bool hasAdjustments(const AdjustParams &params);
+    static qreal estimateAverageLuminance(const QImage &image);   // 抽样估计
+    static QRgb adjustPixel(QRgb pixel, const AdjustParams &params, qreal averageLuminance);
     static QRgb adjustPixelBrightness(QRgb pixel, qreal value);
     static QRgb adjustPixelContrast(QRgb pixel, qreal value, qreal average);
     static QRgb adjustPixelSaturation(QRgb pixel, qreal value);
     static QRgb adjustPixelTemperature(QRgb pixel, qreal value);
-    static QRgb blendPixels(QRgb base, QRgb overlay, qreal opacity, BlendMode mode);
+    static QPainter::CompositionMode compositionModeFor(BlendMode mode);
+    static int blendChannel(int base, int overlay, BlendMode mode);
+    static void vignetteLine(QRgb *line, int x0, int count, int y, const QSize &size,
+                             qreal intensity, const QColor &color, bool premultiplied);
 
     // 工具函数
     static qreal clamp(qreal value, qreal min = 0.0, qreal max = 1.0);
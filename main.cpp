@@ -32,6 +32,8 @@
 #include <QDebug>
 #include <mainwindow2.h>
 #include <QStandardPaths>
+#include <QThread>
+#include "tilescheduler.h"
 
 int main(int argc, char *argv[])
 {
@@ -57,6 +59,9 @@ int main(int argc, char *argv[])
     // }
     QApplication app(argc, argv);
 
+    // 滤镜并行时给摄像头采集线程留一个核
+    TileScheduler::setMaxThreads(qMax(1, QThread::idealThreadCount() - 1));
+
     // 设置应用程序信息
     QApplication::setApplicationName("BigHeadPicture");
     QApplication::setOrganizationName("MyCompany");
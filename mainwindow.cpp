@@ -1,6 +1,7 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
 #include "editablepixmapitem.h"
+#include "tiledexporter.h"
 #include <QFileDialog>
 #include <QMessageBox>
 #include <QStandardPaths>
@@ -9,8 +10,23 @@
 #include <QCloseEvent>
 #include <QInputDialog>
 #include <QSpinBox>
+#include <QSlider>
+#include <QDialog>
+#include <QDialogButtonBox>
+#include <QFormLayout>
+#include <QStyleOptionGraphicsItem>
 #include <QDebug>
 
+namespace {
+
+// 场景中代理图的最大长边
+const qreal kMaxDisplaySide = 1600.0;
+
+// 场景坐标对应的打印分辨率：按 exportDpi 导出时放大 exportDpi / kSceneDpi 倍
+const qreal kSceneDpi = 150.0;
+
+} // namespace
+
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::MainWindow)
@@ -21,6 +37,10 @@ MainWindow::MainWindow(QWidget *parent)
     , imageCapture(nullptr)
     , cameraActive(false)
     , zoomFactor(1.0)
+    , previewRenderer(new PreviewRenderer(this))
+    , previewTarget(nullptr)
+    , commitOnRefine(false)
+    , exportDpi(300)
 {
     ui->setupUi(this);
 
@@ -169,6 +189,12 @@ void MainWindow::initConnections()
     connect(ui->zoomSlider, &QSlider::valueChanged,
             this, &MainWindow::onZoomSliderValueChanged);
 
+    // 预览连接
+    connect(previewRenderer, &PreviewRenderer::previewReady,
+            this, &MainWindow::onPreviewReady);
+    connect(previewRenderer, &PreviewRenderer::refined,
+            this, &MainWindow::onPreviewRefined);
+
     // 相机连接
     if (imageCapture) {
         connect(imageCapture, &QCameraImageCapture::imageCaptured,
@@ -206,17 +232,21 @@ void MainWindow::onImageCaptured(int id, const QImage &preview)
 {
     Q_UNUSED(id);
 
-    QPixmap pixmap = QPixmap::fromImage(preview);
-    addPhotoToScene(pixmap);
+    addPhotoToScene(preview);
 
     // 显示预览消息
     ui->statusBar->showMessage("拍照成功，已添加到海报", 2000);
 }
 
-void MainWindow::addPhotoToScene(const QPixmap &pixmap)
+void MainWindow::addPhotoToScene(const QImage &image)
 {
-    EditablePixmapItem *item = new EditablePixmapItem(pixmap);
+    // 场景里只放长边不超过 kMaxDisplaySide 的代理，原图留在图元和编辑历史里（共享同一份像素）
+    EditHistory *history = new EditHistory(image, &checkpoints);
+    const qreal longSide = qMax(image.width(), image.height());
+    const qreal displayScale = longSide > kMaxDisplaySide ? kMaxDisplaySide / longSide : 1.0;
+    EditablePixmapItem *item = new EditablePixmapItem(history->source(), displayScale);
     item->setEditable(true);
+    histories.insert(item, history);
 
     connect(item, &EditablePixmapItem::itemSelected,
             this, &MainWindow::onPhotoSelected);
@@ -263,6 +293,9 @@ void MainWindow::updateToolButtons()
     ui->actionRotate->setEnabled(hasSelection);
     ui->actionFilter->setEnabled(hasSelection);
 
+    ui->actionUndo->setEnabled(!undoItems.isEmpty());
+    ui->actionRedo->setEnabled(!redoItems.isEmpty());
+
     ui->btnSave->setEnabled(hasPhotos);
     ui->btnExport->setEnabled(hasPhotos);
     ui->btnClear->setEnabled(hasPhotos);
@@ -329,10 +362,8 @@ void MainWindow::applyTemplate(const QString &templateName)
         // 设置位置和大小
         item->setPos(x, y);
 
-        // 调整图片大小以适应位置
-        QPixmap pixmap = item->pixmap();
-        QPixmap scaled = pixmap.scaled(width, height, Qt::KeepAspectRatio, Qt::SmoothTransformation);
-        item->setPixmap(scaled);
+        // 调整图片大小以适应位置（每次都从原图金字塔缩放，不在上一次的结果上再缩）
+        item->fitToSize(QSizeF(width, height));
     }
 
     scene->update();
@@ -359,9 +390,9 @@ void MainWindow::onBtnLoadClicked()
     }
 
     foreach (QString fileName, fileNames) {
-        QPixmap pixmap(fileName);
-        if (!pixmap.isNull()) {
-            addPhotoToScene(pixmap);
+        QImage image(fileName);
+        if (!image.isNull()) {
+            addPhotoToScene(image);
         } else {
             QMessageBox::warning(this, "错误", QString("无法加载图片: %1").arg(fileName));
         }
@@ -377,11 +408,8 @@ void MainWindow::onBtnCropClicked()
     }
 
     // 这里可以打开一个裁剪对话框，为了简单，我们直接裁剪一半
-    QPixmap pixmap = selectedItem->pixmap();
-    QRect cropRect = QRect(0, 0, pixmap.width() / 2, pixmap.height() / 2);
-    selectedItem->crop(cropRect);
+    recordEdit(selectedItem, EditOperation::crop(QRectF(0, 0, 0.5, 0.5)));
 
-    scene->update();
     ui->statusBar->showMessage("已裁剪图片", 2000);
 }
 
@@ -403,20 +431,184 @@ void MainWindow::onBtnFilterClicked()
     }
 
     // 这里可以打开滤镜选择对话框，为了简单，我们直接应用一个滤镜
-    QPixmap pixmap = selectedItem->pixmap();
-    ImageEditor editor;
-    QPixmap filtered = editor.applyFilter(pixmap, FILTER_SEPIA);
-    selectedItem->setPixmap(filtered);
+    // 先显示代理图上的效果，全分辨率结果在后台算好后再写回
+    beginPreview(selectedItem);
+    commitOnRefine = true;
+    previewRenderer->setSettleDelay(0);
+    previewRenderer->setFilterParams(FilterParams(FILTER_SEPIA));
 
-    scene->update();
     ui->statusBar->showMessage("已应用滤镜", 2000);
 }
 
 void MainWindow::onBtnAdjustClicked()
 {
+    if (!selectedItem) {
+        return;
+    }
+
     // 打开调整对话框（亮度、对比度等）
-    // 这里暂时不实现
-    QMessageBox::information(this, "提示", "调整功能暂未实现");
+    // 拖动滑块时只在代理图上预览，确定后才写回图元
+    beginPreview(selectedItem);
+    previewRenderer->setSettleDelay(250);
+
+    QDialog dialog(this);
+    dialog.setWindowTitle("调整");
+    QFormLayout *layout = new QFormLayout(&dialog);
+
+    FilterParams params;
+    const QStringList names = { "亮度", "对比度", "饱和度", "色温" };
+    qreal *values[] = { &params.adjust.brightness, &params.adjust.contrast,
+                        &params.adjust.saturation, &params.adjust.temperature };
+    for (int i = 0; i < names.size(); ++i) {
+        QSlider *slider = new QSlider(Qt::Horizontal, &dialog);
+        slider->setRange(-100, 100);
+        slider->setValue(0);
+        qreal *value = values[i];
+        connect(slider, &QSlider::valueChanged, this, [this, &params, value](int v) {
+            *value = v / 100.0;
+            refinedImage = QImage();
+            previewRenderer->setFilterParams(params);
+        });
+        layout->addRow(names.at(i), slider);
+    }
+
+    QDialogButtonBox *buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, &dialog);
+    connect(buttons, &QDialogButtonBox::accepted, &dialog, &QDialog::accept);
+    connect(buttons, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+    layout->addRow(buttons);
+
+    if (dialog.exec() == QDialog::Accepted) {
+        commitPreview();
+        ui->statusBar->showMessage("已调整图片", 2000);
+    } else {
+        cancelPreview();
+    }
+}
+
+void MainWindow::beginPreview(EditablePixmapItem *item)
+{
+    cancelPreview();
+    previewTarget = item;
+    // 上一次预览留下的滤镜链不能带进新的预览
+    previewRenderer->setFilterChain(QVector<FilterParams>());
+    EditHistory *history = histories.value(item);
+    previewRenderer->setSource(history ? history->current() : item->sourceImage());
+    previewRenderer->setDisplayScale(previewDisplayScale());
+}
+
+// 写回全分辨率结果；后台还没算完就当场算
+void MainWindow::commitPreview()
+{
+    if (!previewTarget) {
+        return;
+    }
+
+    // 没有实际改动（例如调整对话框直接按确定）时不记录历史，也不存检查点
+    const QVector<FilterParams> chain = previewRenderer->filterChain();
+    bool identity = true;
+    for (const FilterParams &params : chain) {
+        identity = identity && params.isIdentity();
+    }
+    if (identity) {
+        cancelPreview();
+        return;
+    }
+
+    QImage result = refinedImage.isNull() ? previewRenderer->renderFull() : refinedImage;
+    previewRenderer->cancel();
+    EditablePixmapItem *item = previewTarget;
+    item->clearPreview();
+    previewTarget = nullptr;
+    refinedImage = QImage();
+    commitOnRefine = false;
+    recordEdit(item, EditOperation::filter(chain), result);
+}
+
+void MainWindow::cancelPreview()
+{
+    previewRenderer->cancel();
+    if (previewTarget) {
+        previewTarget->clearPreview();
+    }
+    previewTarget = nullptr;
+    refinedImage = QImage();
+    commitOnRefine = false;
+}
+
+qreal MainWindow::previewDisplayScale() const
+{
+    if (!previewTarget) {
+        return zoomFactor;
+    }
+    return zoomFactor * previewTarget->scale() * historyDisplayFactor(previewTarget);
+}
+
+// 图元显示的是历史图像按 displayFactor 缩放后的结果（模板布局会把图缩小显示）
+qreal MainWindow::historyDisplayFactor(EditablePixmapItem *item) const
+{
+    return item->sourceScale();
+}
+
+void MainWindow::recordEdit(EditablePixmapItem *item, const EditOperation &op, const QImage &result)
+{
+    EditHistory *history = histories.value(item);
+    if (!history) {
+        return;
+    }
+
+    const qreal factor = historyDisplayFactor(item);
+    history->push(op, result);
+    undoItems.append(item);
+
+    // 新的编辑让所有图片的重做记录失效
+    for (EditablePixmapItem *redoItem : qAsConst(redoItems)) {
+        if (EditHistory *redoHistory = histories.value(redoItem)) {
+            redoHistory->discardRedo();
+        }
+    }
+    redoItems.clear();
+
+    showHistoryState(item, factor);
+}
+
+void MainWindow::showHistoryState(EditablePixmapItem *item, qreal displayFactor)
+{
+    EditHistory *history = histories.value(item);
+    if (!history) {
+        return;
+    }
+
+    item->setSourceImage(history->current(), displayFactor);
+    scene->update();
+    updateToolButtons();
+}
+
+void MainWindow::forgetHistory(EditablePixmapItem *item)
+{
+    delete histories.take(item);
+    undoItems.removeAll(item);
+    redoItems.removeAll(item);
+}
+
+void MainWindow::onPreviewReady(const QImage &image, qreal scale)
+{
+    Q_UNUSED(scale);
+    if (previewTarget) {
+        previewTarget->setPreview(QPixmap::fromImage(image));
+    }
+}
+
+void MainWindow::onPreviewRefined(const QImage &image)
+{
+    if (!previewTarget) {
+        return;
+    }
+    refinedImage = image;
+    if (commitOnRefine) {
+        commitPreview();
+    } else {
+        previewTarget->setPreview(QPixmap::fromImage(image));
+    }
 }
 
 void MainWindow::onBtnCustomTemplateClicked()
@@ -510,11 +702,16 @@ void MainWindow::onBtnClearClicked()
 
 void MainWindow::clearAllPhotos()
 {
+    cancelPreview();
     foreach (EditablePixmapItem *item, photoItems) {
         scene->removeItem(item);
         delete item;
     }
     photoItems.clear();
+    qDeleteAll(histories);
+    histories.clear();
+    undoItems.clear();
+    redoItems.clear();
     selectedItem = nullptr;
 
     updateToolButtons();
@@ -526,8 +723,12 @@ void MainWindow::clearAllPhotos()
 void MainWindow::onPhotoDeleted(EditablePixmapItem *item)
 {
     if (item) {
+        if (previewTarget == item) {
+            cancelPreview();
+        }
         scene->removeItem(item);
         photoItems.removeOne(item);
+        forgetHistory(item);
 
         if (selectedItem == item) {
             selectedItem = nullptr;
@@ -545,6 +746,7 @@ void MainWindow::onZoomSliderValueChanged(int value)
     QTransform transform;
     transform.scale(zoomFactor, zoomFactor);
     ui->graphicsView->setTransform(transform);
+    previewRenderer->setDisplayScale(previewDisplayScale());
 
     ui->statusBar->showMessage(QString("缩放: %1%").arg(value), 1000);
 }
@@ -587,14 +789,38 @@ void MainWindow::onActionFitView()
 
 void MainWindow::onActionUndo()
 {
-    // 实现撤销功能
-    ui->statusBar->showMessage("撤销功能暂未实现");
+    if (undoItems.isEmpty()) {
+        ui->statusBar->showMessage("没有可撤销的操作", 2000);
+        return;
+    }
+
+    cancelPreview();
+    EditablePixmapItem *item = undoItems.takeLast();
+    EditHistory *history = histories.value(item);
+    const qreal factor = historyDisplayFactor(item);
+    history->undo();
+    redoItems.append(item);
+    showHistoryState(item, factor);
+
+    ui->statusBar->showMessage("已撤销", 2000);
 }
 
 void MainWindow::onActionRedo()
 {
-    // 实现重做功能
-    ui->statusBar->showMessage("重做功能暂未实现");
+    if (redoItems.isEmpty()) {
+        ui->statusBar->showMessage("没有可重做的操作", 2000);
+        return;
+    }
+
+    cancelPreview();
+    EditablePixmapItem *item = redoItems.takeLast();
+    EditHistory *history = histories.value(item);
+    const qreal factor = historyDisplayFactor(item);
+    history->redo();
+    undoItems.append(item);
+    showHistoryState(item, factor);
+
+    ui->statusBar->showMessage("已重做", 2000);
 }
 
 void MainWindow::onActionAbout()
@@ -710,7 +936,7 @@ void MainWindow::onActionExport()
     QString defaultName = QString("高清海报_%1").arg(QDateTime::currentDateTime().toString("yyyyMMdd_hhmmss"));
     QString fileName = QFileDialog::getSaveFileName(this,
                                                     tr("导出高清海报"), defaultName,
-                                                    tr("PNG图片 (*.png);;JPEG图片 (*.jpg *.jpeg);;PDF文档 (*.pdf)"));
+                                                    tr("PNG图片 (*.png);;JPEG图片 (*.jpg *.jpeg);;TIFF图片 (*.tif *.tiff);;PDF文档 (*.pdf)"));
 
     if (!fileName.isEmpty()) {
         // 获取文件格式
@@ -718,10 +944,23 @@ void MainWindow::onActionExport()
         if (fileName.endsWith(".jpg", Qt::CaseInsensitive) ||
             fileName.endsWith(".jpeg", Qt::CaseInsensitive)) {
             format = "JPG";
+        } else if (fileName.endsWith(".tif", Qt::CaseInsensitive) ||
+                   fileName.endsWith(".tiff", Qt::CaseInsensitive)) {
+            format = "TIFF";
         } else if (fileName.endsWith(".pdf", Qt::CaseInsensitive)) {
             format = "PDF";
         }
 
+        if (format != "PDF") {
+            bool ok = false;
+            const int dpi = QInputDialog::getInt(this, "导出高清海报", "分辨率 (DPI):",
+                                                 exportDpi, 72, 1200, 50, &ok);
+            if (!ok) {
+                return;
+            }
+            exportDpi = dpi;
+        }
+
         // 如果是PDF，使用特定方法
         if (format == "PDF") {
             exportToPdf(fileName);
@@ -758,27 +997,41 @@ void MainWindow::updateStatusBar()
 // 实现 exportHighQuality 方法
 void MainWindow::exportHighQuality(const QString &fileName, const QString &format)
 {
-    // 高清导出 - 使用更大的分辨率
+    // 高清导出 - 按条带渲染、边渲染边写文件，输出再大也只占几个条带的内存
     QRectF totalRect = scene->itemsBoundingRect();
-    QSize originalSize = totalRect.size().toSize();
-
-    // 高清尺寸（2倍）
-    QSize hdSize = originalSize * 2;
-    QImage image(hdSize, QImage::Format_ARGB32);
-    image.fill(Qt::white);
-
-    QPainter painter(&image);
-    painter.setRenderHint(QPainter::Antialiasing);
-    painter.setRenderHint(QPainter::SmoothPixmapTransform);
+    if (totalRect.isEmpty()) {
+        return;
+    }
 
-    // 缩放渲染
-    painter.scale(2.0, 2.0);
-    scene->render(&painter);
-    painter.end();
+    // 输出分辨率由 DPI 决定（默认 300 DPI 即场景的 2 倍）
+    const qreal scale = exportDpi / kSceneDpi;
+
+    TiledExporter exporter;
+    exporter.setSceneRect(totalRect);
+    exporter.setScale(scale);
+    exporter.setDpi(exportDpi);
+    exporter.setBackground(Qt::white);
+    exporter.setQuality(100);   // 100%质量
+
+    // 按叠放顺序交给导出器；每张图取与输出分辨率相当的金字塔级别
+    const QList<QGraphicsItem*> items = scene->items(totalRect, Qt::IntersectsItemBoundingRect,
+                                                     Qt::AscendingOrder);
+    for (QGraphicsItem *graphicsItem : items) {
+        EditablePixmapItem *item = qgraphicsitem_cast<EditablePixmapItem*>(graphicsItem);
+        if (!item || !item->isVisible()) {
+            continue;
+        }
+        const QTransform itemToScene = item->sceneTransform();
+        const qreal lod = QStyleOptionGraphicsItem::levelOfDetailFromTransform(
+            itemToScene * QTransform::fromScale(scale, scale));
+        QTransform imageToItem;
+        const QImage image = item->imageForScale(lod, &imageToItem);
+        exporter.addLayer(image, imageToItem * itemToScene, item->effectiveOpacity());
+    }
 
-    // 保存图像
-    if (!image.save(fileName, format.toLatin1(), 100)) { // 100%质量
-        QMessageBox::critical(this, "导出失败", "无法导出高清图像");
+    const TiledExporter::Format fallback = format == "JPG" ? TiledExporter::Jpeg : TiledExporter::Png;
+    if (!exporter.exportTo(fileName, TiledExporter::formatForFile(fileName, fallback))) {
+        QMessageBox::critical(this, "导出失败", QString("无法导出高清图像: %1").arg(exporter.errorString()));
     }
 }
 
@@ -833,9 +1086,12 @@ void MainWindow::cropSelectedPhoto()
     if (!cropRect.isValid()) return;
 
     if (ok && cropRect.isValid()) {
-        QPixmap original = selectedItem->pixmap();
-        QPixmap cropped = ImageEditor::cropImage(original, cropRect);
-        selectedItem->setPixmap(cropped);
+        // 按比例记录，历史里的原图分辨率与显示的不同
+        const QSizeF size = selectedItem->pixmap().size();
+        recordEdit(selectedItem, EditOperation::crop(QRectF(cropRect.x() / size.width(),
+                                                            cropRect.y() / size.height(),
+                                                            cropRect.width() / size.width(),
+                                                            cropRect.height() / size.height())));
         ui->statusBar->showMessage("图片已裁剪", 2000);
     }
 }
@@ -845,9 +1101,7 @@ void MainWindow::rotateSelectedPhoto(qreal angle)
 {
     if (!selectedItem) return;
 
-    QPixmap original = selectedItem->pixmap();
-    QPixmap rotated = ImageEditor::rotateImage(original, angle);
-    selectedItem->setPixmap(rotated);
+    recordEdit(selectedItem, EditOperation::rotate(angle));
 }
 
 // 实现 applyFilterToSelected 方法
@@ -858,9 +1112,7 @@ void MainWindow::applyFilterToSelected(const QString &filterName)
     // 这里可以根据filterName应用不同的滤镜
     // 简化版：应用灰度滤镜
 
-    QPixmap original = selectedItem->pixmap();
-    QPixmap filtered = ImageEditor::applyFilter(original, FILTER_GRAYSCALE);
-    selectedItem->setPixmap(filtered);
+    recordEdit(selectedItem, EditOperation::filter(QVector<FilterParams>() << FilterParams(FILTER_GRAYSCALE)));
 
     ui->statusBar->showMessage(QString("已应用滤镜: %1").arg(filterName), 2000);
 }
@@ -916,5 +1168,6 @@ void MainWindow::setupCustomGridTemplate(int rows, int cols)
 
 MainWindow::~MainWindow()
 {
+    qDeleteAll(histories);
     delete ui;
 }
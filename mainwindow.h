@@ -9,9 +9,12 @@
 #include <QCameraImageCapture>
 #include <QListWidgetItem>
 #include <QMap>
+#include <QHash>
 #include <QPrinter>
 
 #include "imageeditor.h"
+#include "previewrenderer.h"
+#include "edithistory.h"
 
 QT_BEGIN_NAMESPACE
 namespace Ui {
@@ -81,6 +84,10 @@ private slots:
     void updateStatusBar();
     void updateToolButtons();
 
+    // 交互预览
+    void onPreviewReady(const QImage &image, qreal scale);
+    void onPreviewRefined(const QImage &image);
+
     void exportToPdf(const QString &fileName);
     void setupCustomGridTemplate(int rows, int cols);
 
@@ -106,6 +113,21 @@ private:
     QPixmap currentPoster;
     qreal zoomFactor;
 
+    // 交互预览：参数变化时只在代理图上出预览，停下后后台按原图重算
+    PreviewRenderer *previewRenderer;
+    EditablePixmapItem *previewTarget;
+    QImage refinedImage;            // 当前参数的全分辨率结果，还没算完时为空
+    bool commitOnRefine;            // 全分辨率结果一到就写回图元（单次滤镜按钮）
+
+    // 编辑历史：每张图片一份，按操作顺序记下改动的图元，撤销/重做按这个顺序走
+    QHash<EditablePixmapItem*, EditHistory*> histories;
+    CheckpointStore checkpoints;    // 所有历史共用的检查点预算
+    QList<EditablePixmapItem*> undoItems;
+    QList<EditablePixmapItem*> redoItems;
+
+    // 高清导出的分辨率
+    int exportDpi;
+
     // 初始化方法
     void initUI();
     void initCamera();
@@ -115,7 +137,7 @@ private:
     // 工具方法
     void setupDefaultTemplates();
     void applyTemplate(const QString &templateName);
-    void addPhotoToScene(const QPixmap &pixmap);
+    void addPhotoToScene(const QImage &image);
     void removePhotoFromScene(EditablePixmapItem *item);
     void clearAllPhotos();
     void savePosterImage(const QString &fileName, const QString &format);
@@ -125,6 +147,14 @@ private:
     void cropSelectedPhoto();
     void rotateSelectedPhoto(qreal angle);
     void applyFilterToSelected(const QString &filterName);
+    void beginPreview(EditablePixmapItem *item);
+    void commitPreview();
+    void cancelPreview();
+    qreal previewDisplayScale() const;
+    void recordEdit(EditablePixmapItem *item, const EditOperation &op, const QImage &result = QImage());
+    void showHistoryState(EditablePixmapItem *item, qreal displayFactor);
+    qreal historyDisplayFactor(EditablePixmapItem *item) const;
+    void forgetHistory(EditablePixmapItem *item);
 
     // 工具方法
     QPixmap createPosterPreview();
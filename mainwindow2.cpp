@@ -26,43 +26,28 @@ MainWindow2::MainWindow2(QWidget *parent)
 
 void MainWindow2::initializeCamera()
 {
-    // 尝试不同的摄像头打开方法
-    int cameraIndex = 9;  // 默认摄像头
-
-    // 方法1: 使用设备路径
-    QString devicePath = QString("/dev/video%1").arg(cameraIndex);
-    cap.open(devicePath.toStdString(), cv::CAP_V4L2);
-
-    if (!cap.isOpened()) {
-        // 方法2: 使用索引和V4L2后端
-        cap.open(cameraIndex, cv::CAP_V4L2);
-    }
-
-    if (!cap.isOpened()) {
-        // 方法3: 尝试自动检测
-        cap.open(cameraIndex);
-    }
-
-    if (cap.isOpened()) {
-       std::cout << "摄像头打开成功\n";
-
-        // 设置摄像头参数
-        cap.set(cv::CAP_PROP_FRAME_WIDTH, 640);
-        cap.set(cv::CAP_PROP_FRAME_HEIGHT, 480);
-        cap.set(cv::CAP_PROP_FPS, 30);
-        cap.set(cv::CAP_PROP_FOURCC, cv::VideoWriter::fourcc('M', 'J', 'P', 'G'));
-
-        // 验证设置
-        double width = cap.get(cv::CAP_PROP_FRAME_WIDTH);
-        double height = cap.get(cv::CAP_PROP_FRAME_HEIGHT);
-        double fps = cap.get(cv::CAP_PROP_FPS);
-        std::cout<< "摄像头参数: " << width << "x" << height << " FPS:" << fps<<std::endl;
-
-        // 启动定时器
-        // 设置定时器，每30ms更新一帧（约33fps）
+    // 设备、格式、分辨率、帧率由 CameraProfile 枚举协商（有存档直接用），
+    // 预览用低分辨率流，拍照时取高分辨率帧
+    CameraTargets targets;
+    targets.previewWidth = 640;
+    targets.previewHeight = 480;
+    targets.previewFps = 30;
+    cam.setTargets(targets);
+    cam.setFrameMode(CameraManager::RawMjpeg);
+    connect(&cam, &CameraManager::stillCaptured, this, &MainWindow2::showCaptured);
+
+    if (cam.start()) {
+        const CameraProfile &profile = cam.profile();
+        std::cout << "摄像头打开成功: " << profile.device.toStdString()
+                  << " 预览 " << profile.preview.fourccString().toStdString() << " "
+                  << profile.preview.width << "x" << profile.preview.height
+                  << " FPS:" << profile.preview.fps
+                  << " 拍照 " << profile.still.width << "x" << profile.still.height << std::endl;
+
+        // 启动定时器，间隔跟预览帧率一致，不空转
         timer = new QTimer(this);
         connect(timer, &QTimer::timeout, this, &MainWindow2::updateFrame);
-        timer->start(10);  // 33fps
+        timer->start(qMax(10, qRound(1000.0 / cam.previewFps())));
 
     } else {
         printf("错误无法打开摄像头！\n"
@@ -77,7 +62,7 @@ void MainWindow2::initializeCamera()
 
 MainWindow2::~MainWindow2()
 {
-    cap.release();
+    cam.stop();
     delete ui;
 }
 
@@ -129,19 +114,12 @@ void MainWindow2::updateFrame()
     //     videoLabel->setPixmap(QPixmap::fromImage(img).scaled(
     //         videoLabel->size(), Qt::KeepAspectRatio, Qt::SmoothTransformation));
     // }
-    if (!cap.isOpened()) return;
-
-    cv::Mat frame;
-    bool success = cap.read(frame);
-
-    if (!success || frame.empty()) {
-        std::cout << "读取帧失败"<<std::endl;
-        return;
-    }
+    // 采集线程还没送来新帧就不重画
+    if (!cam.grabPreview(currentFrame) || currentFrame.empty()) return;
 
     // 转换颜色空间
     cv::Mat rgbFrame;
-    cv::cvtColor(frame, rgbFrame, cv::COLOR_BGR2RGB);
+    cv::cvtColor(currentFrame, rgbFrame, cv::COLOR_BGR2RGB);
 
     // 显示图像
     QImage img(rgbFrame.data, rgbFrame.cols, rgbFrame.rows,
@@ -155,9 +133,16 @@ void MainWindow2::updateFrame()
 
 void MainWindow2::takePhoto()
 {
-    if (currentFrame.empty()) return;
+    // 拍照用全分辨率帧，不用缩小解码的预览帧；帧在采集线程里取，到了走 showCaptured()
+    captureBtn->setEnabled(false);
+    cam.requestStill();
+}
 
-    capturedImage = currentFrame.clone();
+void MainWindow2::showCaptured(const cv::Mat &frame)
+{
+    captureBtn->setEnabled(true);
+    if (frame.empty()) return;
+    capturedImage = frame;
     isCaptured = true;
 
     // 显示捕获的图像
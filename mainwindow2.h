@@ -6,6 +6,7 @@
 #include <QLabel>
 #include <QPushButton>
 #include "opencv2/opencv.hpp"
+#include "backend/CameraManager.h"
 
 namespace Ui {
 class MainWindow2;
@@ -22,11 +23,12 @@ public:
 private slots:
     void updateFrame();          // 更新帧
     void takePhoto();            // 拍照
+    void showCaptured(const cv::Mat &frame);   // 采集线程送回拍照帧
     void savePhoto();            // 保存照片
 
 private:
-    cv::VideoCapture cap;        // OpenCV视频捕获对象
-    QTimer *timer;               // 定时器用于更新画面
+    CameraManager cam;           // 采集线程 + 协商出的设备/格式
+    QTimer *timer = nullptr;     // 定时器用于更新画面
     QLabel *videoLabel;          // 显示视频的标签
     QPushButton *captureBtn;     // 拍照按钮
     QPushButton *saveBtn;        // 保存按钮
@@ -0,0 +1,200 @@
+#include "maskcache.h"
+#include "simdsupport.h"
+#include "tilescheduler.h"
+#include <QCache>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QPainter>
+#include <climits>
+#include <cstring>
+
+namespace {
+
+const qint64 kDefaultBudgetBytes = 32 * 1024 * 1024;
+
+struct MaskStore {
+    QMutex mutex;
+    QCache<QString, QImage> masks;     // cost 为 KB
+
+    MaskStore() { masks.setMaxCost(int(kDefaultBudgetBytes / 1024)); }
+};
+
+MaskStore &store()
+{
+    static MaskStore instance;
+    return instance;
+}
+
+#if defined(SIMD_USE_SSE2)
+// 覆盖率乘法，一次 4 个像素：每个通道 t = p·a，结果 (t + (t >> 8) + 0x80) >> 8，与 multiply() 逐位一致
+int scaleByCoverageSse2(QRgb *line, const uchar *coverage, int count)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i half = _mm_set1_epi16(0x80);
+    int x = 0;
+    for (; x + 4 <= count; x += 4) {
+        quint32 cover;
+        std::memcpy(&cover, coverage + x, 4);
+        if (cover == 0xffffffffu) {
+            continue;
+        }
+        __m128i *p = reinterpret_cast<__m128i *>(line + x);
+        if (cover == 0) {
+            _mm_storeu_si128(p, zero);
+            continue;
+        }
+        const __m128i a16 = _mm_unpacklo_epi8(_mm_cvtsi32_si128(int(cover)), zero);
+        const __m128i a = _mm_unpacklo_epi16(a16, a16);            // a0 a0 a1 a1 a2 a2 a3 a3
+        const __m128i alo = _mm_unpacklo_epi32(a, a);               // 像素 0、1 的四个通道
+        const __m128i ahi = _mm_unpackhi_epi32(a, a);               // 像素 2、3
+
+        const __m128i px = _mm_loadu_si128(p);
+        __m128i lo = _mm_mullo_epi16(_mm_unpacklo_epi8(px, zero), alo);
+        __m128i hi = _mm_mullo_epi16(_mm_unpackhi_epi8(px, zero), ahi);
+        lo = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), half), 8);
+        hi = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), half), 8);
+        _mm_storeu_si128(p, _mm_packus_epi16(lo, hi));
+    }
+    return x;
+}
+#elif defined(SIMD_USE_NEON)
+// 同 SSE2：vtbl 把每个覆盖率复制到四个通道，vmull 扩成 16 位相乘
+int scaleByCoverageNeon(QRgb *line, const uchar *coverage, int count)
+{
+    static const uint8_t kLowIndex[8] = { 0, 0, 0, 0, 1, 1, 1, 1 };
+    static const uint8_t kHighIndex[8] = { 2, 2, 2, 2, 3, 3, 3, 3 };
+    const uint8x8_t lowIndex = vld1_u8(kLowIndex);
+    const uint8x8_t highIndex = vld1_u8(kHighIndex);
+    const uint16x8_t half = vdupq_n_u16(0x80);
+    int x = 0;
+    for (; x + 4 <= count; x += 4) {
+        quint32 cover;
+        std::memcpy(&cover, coverage + x, 4);
+        if (cover == 0xffffffffu) {
+            continue;
+        }
+        uint8_t *p = reinterpret_cast<uint8_t *>(line + x);
+        if (cover == 0) {
+            vst1q_u8(p, vdupq_n_u8(0));
+            continue;
+        }
+        const uint8x8_t a = vreinterpret_u8_u32(vdup_n_u32(cover));
+        const uint8x16_t px = vld1q_u8(p);
+        uint16x8_t lo = vmull_u8(vget_low_u8(px), vtbl1_u8(a, lowIndex));
+        uint16x8_t hi = vmull_u8(vget_high_u8(px), vtbl1_u8(a, highIndex));
+        lo = vaddq_u16(vaddq_u16(lo, vshrq_n_u16(lo, 8)), half);
+        hi = vaddq_u16(vaddq_u16(hi, vshrq_n_u16(hi, 8)), half);
+        vst1q_u8(p, vcombine_u8(vshrn_n_u16(lo, 8), vshrn_n_u16(hi, 8)));
+    }
+    return x;
+}
+#endif
+
+} // namespace
+
+QImage MaskCache::coverage(const QString &key, const QSize &size, const PathBuilder &builder)
+{
+    if (size.isEmpty()) {
+        return QImage();
+    }
+
+    const QString cacheKey = key + QLatin1Char('@') + QString::number(size.width()) +
+                             QLatin1Char('x') + QString::number(size.height());
+    MaskStore &s = store();
+    {
+        QMutexLocker locker(&s.mutex);
+        if (const QImage *cached = s.masks.object(cacheKey)) {
+            return *cached;
+        }
+    }
+
+    // 光栅化放在锁外，两个线程同时错过时各画一次，结果相同
+    QImage mask(size, QImage::Format_Alpha8);
+    mask.fill(0);
+    QPainter painter(&mask);
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.fillPath(builder(QRectF(QPointF(0, 0), QSizeF(size))), Qt::black);
+    painter.end();
+
+    QMutexLocker locker(&s.mutex);
+    const qint64 bytes = qint64(mask.bytesPerLine()) * mask.height();
+    s.masks.insert(cacheKey, new QImage(mask), int(qMax<qint64>(1, bytes / 1024)));
+    return mask;
+}
+
+QImage MaskCache::ellipse(const QSize &size)
+{
+    return coverage(QStringLiteral("ellipse"), size, [](const QRectF &rect) {
+        QPainterPath path;
+        path.addEllipse(rect);
+        return path;
+    });
+}
+
+QImage MaskCache::roundedRect(const QSize &size, qreal radius)
+{
+    return coverage(QStringLiteral("rounded:") + QString::number(radius), size, [radius](const QRectF &rect) {
+        QPainterPath path;
+        path.addRoundedRect(rect, radius, radius);
+        return path;
+    });
+}
+
+void MaskCache::apply(QImage &image, const QImage &mask, const QPoint &offset)
+{
+    const QRect area = QRect(offset, mask.size()).intersected(image.rect());
+    if (area.isEmpty()) {
+        return;
+    }
+    Q_ASSERT(image.format() == QImage::Format_ARGB32_Premultiplied);
+    Q_ASSERT(mask.format() == QImage::Format_Alpha8);
+
+    uchar *bits = image.bits();
+    const int bytesPerLine = image.bytesPerLine();
+    const uchar *maskBits = mask.constBits();
+    const int maskBytesPerLine = mask.bytesPerLine();
+    const int left = area.x();
+    const int width = area.width();
+    const int top = area.y();
+
+    TileScheduler::forEachStrip(area.height(), bytesPerLine, 0, [&](int firstRow, int lastRow) {
+        for (int row = firstRow; row < lastRow; ++row) {
+            QRgb *line = reinterpret_cast<QRgb *>(bits + (top + row) * bytesPerLine) + left;
+            const uchar *cover = maskBits + (top + row - offset.y()) * maskBytesPerLine + (left - offset.x());
+            applyLine(line, cover, width);
+        }
+    });
+}
+
+// SSE2 / NEON 处理凑满 4 个的像素（指令集选择见 simdsupport.h），余下的走标量
+void MaskCache::applyLine(QRgb *line, const uchar *coverage, int count)
+{
+    int x = 0;
+#if defined(SIMD_USE_SSE2)
+    x = scaleByCoverageSse2(line, coverage, count);
+#elif defined(SIMD_USE_NEON)
+    x = scaleByCoverageNeon(line, coverage, count);
+#endif
+    for (; x < count; ++x) {
+        const uint a = coverage[x];
+        if (a == 0) {
+            line[x] = 0;
+        } else if (a != 255) {
+            line[x] = multiply(line[x], a);
+        }
+    }
+}
+
+void MaskCache::setBudget(qint64 bytes)
+{
+    MaskStore &s = store();
+    QMutexLocker locker(&s.mutex);
+    s.masks.setMaxCost(int(qBound<qint64>(0, bytes / 1024, INT_MAX)));
+}
+
+void MaskCache::clear()
+{
+    MaskStore &s = store();
+    QMutexLocker locker(&s.mutex);
+    s.masks.clear();
+}
@@ -0,0 +1,45 @@
+#ifndef MASKCACHE_H
+#define MASKCACHE_H
+
+#include <QImage>
+#include <QPainterPath>
+#include <QSize>
+#include <QString>
+#include <functional>
+
+// 形状遮罩缓存
+// 遮罩按 (形状, 尺寸) 只光栅化一次成 8 位覆盖率图（Format_Alpha8，抗锯齿），
+// 之后每次使用只是逐像素乘一遍，不再走 QPainter 的路径裁剪。
+// 海报槽位、ImageEditor::createMask 和大头照的圆形头像共用同一个缓存，可在工作线程中调用
+class MaskCache
+{
+public:
+    // 路径以 QRectF(0, 0, size) 为外框构造
+    typedef std::function<QPainterPath(const QRectF &)> PathBuilder;
+
+    // key 标识形状（包括圆角半径等参数），同一个 key 必须总是对应同一个 builder
+    static QImage coverage(const QString &key, const QSize &size, const PathBuilder &builder);
+
+    static QImage ellipse(const QSize &size);
+    static QImage roundedRect(const QSize &size, qreal radius);
+
+    // 预乘格式的 image 从 offset 处起逐像素乘以遮罩覆盖率，遮罩以外的部分不动
+    static void apply(QImage &image, const QImage &mask, const QPoint &offset = QPoint());
+    // 单行版本：line 为预乘像素，coverage 为同样长度的覆盖率
+    static void applyLine(QRgb *line, const uchar *coverage, int count);
+
+    // 预乘像素的四个通道同时乘以 a / 255（两个通道一组，结果四舍五入）
+    static inline QRgb multiply(QRgb pixel, uint a)
+    {
+        uint rb = (pixel & 0x00ff00ffu) * a;
+        rb = ((rb + ((rb >> 8) & 0x00ff00ffu) + 0x00800080u) >> 8) & 0x00ff00ffu;
+        uint ag = ((pixel >> 8) & 0x00ff00ffu) * a;
+        ag = (ag + ((ag >> 8) & 0x00ff00ffu) + 0x00800080u) & 0xff00ff00u;
+        return rb | ag;
+    }
+
+    static void setBudget(qint64 bytes);
+    static void clear();
+};
+
+#endif // MASKCACHE_H
@@ -0,0 +1,81 @@
+#include "mippyramid.h"
+#include "imageeditor.h"
+#include "tilescheduler.h"
+#include <QtMath>
+#include <cmath>
+
+namespace {
+
+// 2x2 像素平均，两个通道一组
+inline QRgb average4(QRgb a, QRgb b, QRgb c, QRgb d)
+{
+    const uint rb = (a & 0x00ff00ffu) + (b & 0x00ff00ffu) + (c & 0x00ff00ffu) + (d & 0x00ff00ffu);
+    const uint ag = ((a >> 8) & 0x00ff00ffu) + ((b >> 8) & 0x00ff00ffu) +
+                    ((c >> 8) & 0x00ff00ffu) + ((d >> 8) & 0x00ff00ffu);
+    return (((rb + 0x00020002u) >> 2) & 0x00ff00ffu) | ((((ag + 0x00020002u) >> 2) & 0x00ff00ffu) << 8);
+}
+
+} // namespace
+
+MipPyramid::MipPyramid(const QImage &image, int minSize)
+{
+    setImage(image, minSize);
+}
+
+void MipPyramid::setImage(const QImage &image, int minSize)
+{
+    m_levels.clear();
+    if (image.isNull()) {
+        return;
+    }
+    m_levels.append(ImageEditor::toWorkingFormat(image));
+    while (qMax(m_levels.last().width(), m_levels.last().height()) > minSize * 2) {
+        m_levels.append(downsample(m_levels.last()));
+    }
+}
+
+int MipPyramid::levelForScale(qreal scale) const
+{
+    if (m_levels.isEmpty() || scale >= 1.0 || scale <= 0) {
+        return 0;
+    }
+    return qBound(0, int(qFloor(std::log2(1.0 / scale))), m_levels.size() - 1);
+}
+
+int MipPyramid::levelForWidth(int width) const
+{
+    int level = 0;
+    while (level + 1 < m_levels.size() && m_levels.at(level + 1).width() >= width) {
+        ++level;
+    }
+    return level;
+}
+
+// 长宽各减半，奇数的最后一行/列与前一行/列合并
+QImage MipPyramid::downsample(const QImage &image)
+{
+    const int srcWidth = image.width();
+    const int srcHeight = image.height();
+    QImage result(qMax(1, srcWidth / 2), qMax(1, srcHeight / 2), QImage::Format_ARGB32_Premultiplied);
+
+    const uchar *srcBits = image.constBits();
+    const int srcBytesPerLine = image.bytesPerLine();
+    uchar *dstBits = result.bits();
+    const int dstBytesPerLine = result.bytesPerLine();
+    const int width = result.width();
+
+    TileScheduler::forEachStrip(result, 0, [&](int firstRow, int lastRow) {
+        for (int y = firstRow; y < lastRow; ++y) {
+            const QRgb *row0 = reinterpret_cast<const QRgb *>(srcBits + 2 * y * srcBytesPerLine);
+            const QRgb *row1 = reinterpret_cast<const QRgb *>(
+                srcBits + qMin(2 * y + 1, srcHeight - 1) * srcBytesPerLine);
+            QRgb *dst = reinterpret_cast<QRgb *>(dstBits + y * dstBytesPerLine);
+            for (int x = 0; x < width; ++x) {
+                const int x0 = 2 * x;
+                const int x1 = qMin(x0 + 1, srcWidth - 1);
+                dst[x] = average4(row0[x0], row0[x1], row1[x0], row1[x1]);
+            }
+        }
+    });
+    return result;
+}
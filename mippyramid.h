@@ -0,0 +1,34 @@
+#ifndef MIPPYRAMID_H
+#define MIPPYRAMID_H
+
+#include <QImage>
+#include <QVector>
+
+// 图像金字塔：level(0) 为原图（工作格式），每往上一级长宽各减半（2x2 平均），
+// 一直到长边不超过 2 * minSize。显示/预览按需要的分辨率取最接近的一级，避免每次从原图缩放
+class MipPyramid
+{
+public:
+    MipPyramid() {}
+    explicit MipPyramid(const QImage &image, int minSize = 256);
+
+    void setImage(const QImage &image, int minSize = 256);
+    void clear() { m_levels.clear(); }
+
+    bool isEmpty() const { return m_levels.isEmpty(); }
+    int levelCount() const { return m_levels.size(); }
+    const QImage &level(int index) const { return m_levels.at(index); }
+    const QImage &source() const { return m_levels.first(); }
+
+    // 缩放比例 scale（相对原图）对应的级别：不小于该比例的最小一级
+    int levelForScale(qreal scale) const;
+    // 宽度不小于 width 的最小一级
+    int levelForWidth(int width) const;
+
+    static QImage downsample(const QImage &image);
+
+private:
+    QVector<QImage> m_levels;
+};
+
+#endif // MIPPYRAMID_H
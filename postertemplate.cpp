@@ -8,6 +8,18 @@
 #include <QPainterPath>
 #include <QLinearGradient>
 #include <QRandomGenerator>
+#include <QDataStream>
+#include <QThread>
+#include "maskcache.h"
+#include "tilescheduler.h"
+#include <atomic>
+#include <climits>
+
+namespace {
+
+const qint64 kDefaultLayerCacheBytes = 128 * 1024 * 1024;
+
+} // namespace
 
 PosterTemplate::PosterTemplate(QObject *parent)
     : QObject(parent)
@@ -19,6 +31,7 @@ PosterTemplate::PosterTemplate(QObject *parent)
     , m_randomScale(false)
 {
     setupDefaultSlots();
+    setCacheBudget(kDefaultLayerCacheBytes);
 }
 
 PosterTemplate::~PosterTemplate()
@@ -343,8 +356,68 @@ QPixmap PosterTemplate::generatePoster(const QVector<QPixmap> &photos,
         return QPixmap();
     }
 
-    // 创建画布
-    QPixmap poster(outputSize);
+    // 先查缓存：照片、槽位参数和输出尺寸都没变的槽位直接复用上次的图层
+    int slotCount = qMin(m_photoSlots.size(), photos.size());
+    QVector<QImage> layers(slotCount);
+    QVector<QPoint> origins(slotCount);
+    QVector<QByteArray> keys(slotCount);
+    QVector<int> pending;
+    for (int i = 0; i < slotCount; ++i) {
+        keys[i] = slotCacheKey(photos[i], m_photoSlots[i], outputSize);
+        if (const SlotLayer *cached = m_layerCache.object(keys[i])) {
+            layers[i] = cached->image;
+            origins[i] = cached->origin;
+        } else {
+            pending.append(i);
+        }
+    }
+
+    // 工作线程里不能碰 QPixmap，先在调用线程转成 QImage
+    QVector<QImage> sources(slotCount);
+    for (int i : pending) {
+        sources[i] = photos[i].toImage();
+    }
+
+    // 各槽位的裁剪、缩放、旋转和遮罩并行处理，每个槽位得到一张已经带遮罩的图层
+    QImage *layerData = layers.data();
+    QPoint *originData = origins.data();
+    // 进度只在调用线程上发：工作线程只计数，调用线程每干完一个槽位报一次当前总数。
+    // 从池线程发出的信号对 GUI 线程的接收者是排队的，会在 100% 之后才到
+    std::atomic<int> prepared(slotCount - pending.size());
+    QThread *callerThread = QThread::currentThread();
+    int reported = -1;
+
+    TileScheduler::parallelFor(pending.size(), [&](int k) {
+        const int i = pending.at(k);
+        const PhotoSlot &slot = m_photoSlots[i];
+        QRectF targetRect = calculateAbsoluteRect(slot.position, outputSize);
+        QImage processedPhoto = processPhoto(sources[i], slot, targetRect.size().toSize());
+        layerData[i] = renderSlot(processedPhoto, slot, targetRect, &originData[i]);
+
+        // 发送进度信号（准备阶段占 90%）
+        prepared.fetch_add(1);
+        if (QThread::currentThread() == callerThread) {
+            const int percent = prepared.load() * 90 / slotCount;
+            if (percent > reported) {
+                reported = percent;
+                emit generationProgress(percent);
+            }
+        }
+    });
+    if (reported < 90) {
+        emit generationProgress(90);
+    }
+
+    for (int i : pending) {
+        if (!layers[i].isNull()) {
+            const qint64 bytes = qint64(layers[i].bytesPerLine()) * layers[i].height();
+            m_layerCache.insert(keys[i], new SlotLayer{layers[i], origins[i]},
+                                int(qMax<qint64>(1, bytes / 1024)));
+        }
+    }
+
+    // 按槽位顺序合成，结果与线程调度无关
+    QImage poster(outputSize, QImage::Format_ARGB32_Premultiplied);
     poster.fill(Qt::transparent);
 
     QPainter painter(&poster);
@@ -355,27 +428,37 @@ QPixmap PosterTemplate::generatePoster(const QVector<QPixmap> &photos,
     drawBackground(painter, backgroundColor, backgroundImage);
 
     // 绘制照片
-    int slotCount = qMin(m_photoSlots.size(), photos.size());
     for (int i = 0; i < slotCount; ++i) {
         const PhotoSlot &slot = m_photoSlots[i];
-        const QPixmap &photo = photos[i];
-
-        // 计算实际位置
-        QRectF targetRect = calculateAbsoluteRect(slot.position, outputSize);
-
-        // 处理照片
-        QPixmap processedPhoto = processPhoto(photo, slot, targetRect.size().toSize());
-
-        // 绘制照片
-        drawPhoto(painter, processedPhoto, slot, targetRect);
+        if (layers[i].isNull()) {
+            continue;
+        }
+        painter.drawImage(origins[i], layers[i]);
 
-        // 发送进度信号
-        emit generationProgress((i + 1) * 100 / slotCount);
+        // 绘制边框
+        drawBorder(painter, slot, calculateAbsoluteRect(slot.position, outputSize));
     }
 
     painter.end();
+    emit generationProgress(100);
 
-    return poster;
+    return QPixmap::fromImage(poster);
+}
+
+void PosterTemplate::setCacheBudget(qint64 bytes)
+{
+    m_layerCache.setMaxCost(int(qBound<qint64>(0, bytes / 1024, INT_MAX)));
+}
+
+// 图层只取决于照片内容、槽位的几何/遮罩参数和输出尺寸（边框在合成时画，不参与）
+QByteArray PosterTemplate::slotCacheKey(const QPixmap &photo, const PhotoSlot &slot, const QSize &outputSize)
+{
+    QByteArray key;
+    QDataStream stream(&key, QIODevice::WriteOnly);
+    stream << photo.cacheKey() << outputSize
+           << slot.position << slot.sourceRect << slot.rotation << slot.scale
+           << slot.anchorPoint << slot.maskType << slot.cornerRadius << slot.keepAspectRatio;
+    return key;
 }
 
 QPixmap PosterTemplate::generatePreview(const QVector<QPixmap> &photos, const QSize &previewSize)
@@ -394,13 +477,13 @@ void PosterTemplate::drawBackground(QPainter &painter, const QColor &bgColor, co
     }
 }
 
-QPixmap PosterTemplate::processPhoto(const QPixmap &original, const PhotoSlot &slot, const QSize &targetSize)
+QImage PosterTemplate::processPhoto(const QImage &original, const PhotoSlot &slot, const QSize &targetSize) const
 {
     if (original.isNull() || targetSize.isEmpty()) {
-        return QPixmap();
+        return QImage();
     }
 
-    QPixmap photo = original;
+    QImage photo = original;
 
     // 1. 裁剪源区域
     if (slot.sourceRect.isValid() &&
@@ -427,15 +510,24 @@ QPixmap PosterTemplate::processPhoto(const QPixmap &original, const PhotoSlot &s
     return photo;
 }
 
-void PosterTemplate::drawPhoto(QPainter &painter, const QPixmap &photo, const PhotoSlot &slot, const QRectF &targetRect)
+// 把照片画进槽位所在的整像素区域，再乘以缓存的遮罩覆盖率抠出形状；*origin 为图层在海报上的位置
+QImage PosterTemplate::renderSlot(const QImage &photo, const PhotoSlot &slot, const QRectF &targetRect,
+                                  QPoint *origin) const
 {
-    if (photo.isNull()) return;
+    // 取整到像素，同样大小的槽位可以共用一张遮罩
+    const QRect layerRect = targetRect.toRect();
+    *origin = layerRect.topLeft();
+    if (photo.isNull() || layerRect.isEmpty()) {
+        return QImage();
+    }
 
-    // 保存 painter 状态
-    painter.save();
+    QImage layer(layerRect.size(), QImage::Format_ARGB32_Premultiplied);
+    layer.fill(Qt::transparent);
 
-    // 应用遮罩
-    applyMask(painter, slot.maskType, targetRect, slot.cornerRadius);
+    QPainter painter(&layer);
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.setRenderHint(QPainter::SmoothPixmapTransform);
+    painter.translate(-layerRect.topLeft());
 
     // 计算绘制位置（考虑锚点）
     QPointF drawPos = targetRect.topLeft();
@@ -446,13 +538,17 @@ void PosterTemplate::drawPhoto(QPainter &painter, const QPixmap &photo, const Ph
     }
 
     // 绘制照片
-    painter.drawPixmap(drawPos, photo);
+    painter.drawImage(drawPos, photo);
+
+    painter.end();
 
-    // 恢复 painter 状态
-    painter.restore();
+    // 应用遮罩：矩形遮罩就是图层本身，不用再乘
+    const QImage mask = maskCoverage(slot.maskType, layerRect.size(), slot.cornerRadius);
+    if (!mask.isNull()) {
+        MaskCache::apply(layer, mask);
+    }
 
-    // 绘制边框
-    drawBorder(painter, slot, targetRect);
+    return layer;
 }
 
 void PosterTemplate::drawBorder(QPainter &painter, const PhotoSlot &slot, const QRectF &rect)
@@ -479,27 +575,26 @@ void PosterTemplate::drawBorder(QPainter &painter, const PhotoSlot &slot, const
     }
 }
 
-void PosterTemplate::applyMask(QPainter &painter, const QString &maskType, const QRectF &rect, qreal cornerRadius)
+// 遮罩覆盖率图，矩形或默认返回空图
+QImage PosterTemplate::maskCoverage(const QString &maskType, const QSize &size, qreal cornerRadius) const
 {
-    QPainterPath clipPath;
-
     if (maskType == "circle") {
-        clipPath.addEllipse(rect);
+        return MaskCache::ellipse(size);
     } else if (maskType == "heart") {
-        clipPath = createHeartPath(rect);
+        return MaskCache::coverage(QStringLiteral("poster-heart"), size, [this](const QRectF &rect) {
+            return createHeartPath(rect);
+        });
     } else if (maskType == "star") {
-        clipPath = createStarPath(rect, 5);
+        return MaskCache::coverage(QStringLiteral("poster-star"), size, [this](const QRectF &rect) {
+            return createStarPath(rect, 5);
+        });
     } else if (maskType == "rounded") {
-        clipPath.addRoundedRect(rect, cornerRadius, cornerRadius);
-    } else {
-        // 矩形或默认
-        clipPath.addRect(rect);
+        return MaskCache::roundedRect(size, cornerRadius);
     }
-
-    painter.setClipPath(clipPath);
+    return QImage();
 }
 
-QRectF PosterTemplate::calculateAbsoluteRect(const QRectF &relativeRect, const QSize &canvasSize)
+QRectF PosterTemplate::calculateAbsoluteRect(const QRectF &relativeRect, const QSize &canvasSize) const
 {
     qreal x = relativeRect.x() * canvasSize.width();
     qreal y = relativeRect.y() * canvasSize.height();
@@ -509,7 +604,7 @@ QRectF PosterTemplate::calculateAbsoluteRect(const QRectF &relativeRect, const Q
     return QRectF(x, y, width, height);
 }
 
-QRectF PosterTemplate::calculateSourceRect(const QRectF &relativeRect, const QSize &photoSize)
+QRectF PosterTemplate::calculateSourceRect(const QRectF &relativeRect, const QSize &photoSize) const
 {
     qreal x = relativeRect.x() * photoSize.width();
     qreal y = relativeRect.y() * photoSize.height();
@@ -535,7 +630,7 @@ qreal PosterTemplate::getRandomScaleFactor() const
     return 1.0;
 }
 
-QPainterPath PosterTemplate::createRectanglePath(const QRectF &rect, qreal cornerRadius)
+QPainterPath PosterTemplate::createRectanglePath(const QRectF &rect, qreal cornerRadius) const
 {
     QPainterPath path;
     if (cornerRadius > 0) {
@@ -546,14 +641,14 @@ QPainterPath PosterTemplate::createRectanglePath(const QRectF &rect, qreal corne
     return path;
 }
 
-QPainterPath PosterTemplate::createCirclePath(const QRectF &rect)
+QPainterPath PosterTemplate::createCirclePath(const QRectF &rect) const
 {
     QPainterPath path;
     path.addEllipse(rect);
     return path;
 }
 
-QPainterPath PosterTemplate::createHeartPath(const QRectF &rect)
+QPainterPath PosterTemplate::createHeartPath(const QRectF &rect) const
 {
     QPainterPath path;
 
@@ -575,7 +670,7 @@ QPainterPath PosterTemplate::createHeartPath(const QRectF &rect)
     return path;
 }
 
-QPainterPath PosterTemplate::createStarPath(const QRectF &rect, int points)
+QPainterPath PosterTemplate::createStarPath(const QRectF &rect, int points) const
 {
     QPainterPath path;
 
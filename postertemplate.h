@@ -2,8 +2,12 @@
 #define POSTERTEMPLATE_H
 
 #include <QObject>
+#include <QCache>
+#include <QByteArray>
 #include <QPainter>
 #include <QPixmap>
+#include <QImage>
+#include <QPainterPath>
 #include <QVector>
 #include <QRectF>
 #include <QSize>
@@ -116,6 +120,10 @@ public:
     void setRandomScale(bool enabled) { m_randomScale = enabled; }
     bool getRandomScale() const { return m_randomScale; }
 
+    // 槽位图层缓存（已裁剪、缩放、旋转并带遮罩），超出预算时淘汰最久未用的
+    void setCacheBudget(qint64 bytes);
+    void clearCache() { m_layerCache.clear(); }
+
     // 模板保存/加载
     bool saveTemplate(const QString &filePath);
     bool loadTemplate(const QString &filePath);
@@ -148,19 +156,29 @@ private:
     bool m_randomRotation;
     bool m_randomScale;
 
+    // 处理好的槽位图层，键见 slotCacheKey()，cost 为 KB
+    struct SlotLayer {
+        QImage image;
+        QPoint origin;
+    };
+    QCache<QByteArray, SlotLayer> m_layerCache;
+
     // 私有方法
     void setupDefaultSlots();
 
     // 绘制方法
     void drawBackground(QPainter &painter, const QColor &bgColor, const QPixmap &bgImage);
-    QPixmap processPhoto(const QPixmap &original, const PhotoSlot &slot, const QSize &targetSize);
-    void drawPhoto(QPainter &painter, const QPixmap &photo, const PhotoSlot &slot, const QRectF &targetRect);
+    // 以下两步在工作线程里并行执行，只读模板状态
+    QImage processPhoto(const QImage &original, const PhotoSlot &slot, const QSize &targetSize) const;
+    QImage renderSlot(const QImage &photo, const PhotoSlot &slot, const QRectF &targetRect,
+                      QPoint *origin) const;
     void drawBorder(QPainter &painter, const PhotoSlot &slot, const QRectF &rect);
-    void applyMask(QPainter &painter, const QString &maskType, const QRectF &rect, qreal cornerRadius);
+    QImage maskCoverage(const QString &maskType, const QSize &size, qreal cornerRadius) const;
 
     // 工具方法
-    QRectF calculateAbsoluteRect(const QRectF &relativeRect, const QSize &canvasSize);
-    QRectF calculateSourceRect(const QRectF &relativeRect, const QSize &photoSize);
+    QRectF calculateAbsoluteRect(const QRectF &relativeRect, const QSize &canvasSize) const;
+    QRectF calculateSourceRect(const QRectF &relativeRect, const QSize &photoSize) const;
+    static QByteArray slotCacheKey(const QPixmap &photo, const PhotoSlot &slot, const QSize &outputSize);
     qreal getRandomRotationAngle() const;
     qreal getRandomScaleFactor() const;
 
@@ -171,10 +189,10 @@ private:
     QVector<QRectF> calculateSpiralLayout(int count, const QSize &canvasSize);
 
     // 遮罩路径
-    QPainterPath createRectanglePath(const QRectF &rect, qreal cornerRadius = 0);
-    QPainterPath createCirclePath(const QRectF &rect);
-    QPainterPath createHeartPath(const QRectF &rect);
-    QPainterPath createStarPath(const QRectF &rect, int points = 5);
+    QPainterPath createRectanglePath(const QRectF &rect, qreal cornerRadius = 0) const;
+    QPainterPath createCirclePath(const QRectF &rect) const;
+    QPainterPath createHeartPath(const QRectF &rect) const;
+    QPainterPath createStarPath(const QRectF &rect, int points = 5) const;
 };
 
 #endif // POSTERTEMPLATE_H
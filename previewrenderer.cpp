@@ -0,0 +1,199 @@
+#include "previewrenderer.h"
+#include <QRunnable>
+#include <QElapsedTimer>
+
+namespace {
+
+const int kDefaultSettleDelay = 250;
+const qint64 kMaxPreviewPixels = 2560 * 1600;       // 代理图不超过一块大屏
+const qint64 kSlowPreviewMs = 16;                   // 超过一帧就降一级
+const qint64 kFastPreviewMs = 4;
+
+} // namespace
+
+// 后台全分辨率渲染，结果带着开始时的参数版本排队送回 GUI 线程
+class PreviewRefineTask : public QRunnable
+{
+public:
+    PreviewRefineTask(PreviewRenderer *renderer, const QImage &source,
+                      const QVector<FilterParams> &chain, int generation)
+        : renderer(renderer), source(source), chain(chain), generation(generation) {}
+
+    void run() override
+    {
+        QImage result = PreviewRenderer::applyChain(source, chain, &renderer->m_generation, generation);
+        if (!result.isNull()) {
+            QMetaObject::invokeMethod(renderer, "deliverRefined", Qt::QueuedConnection,
+                                      Q_ARG(QImage, result), Q_ARG(int, generation));
+        }
+        renderer->m_refining.fetch_sub(1);
+    }
+
+private:
+    PreviewRenderer *renderer;
+    QImage source;
+    QVector<FilterParams> chain;
+    int generation;
+};
+
+PreviewRenderer::PreviewRenderer(QObject *parent)
+    : QObject(parent)
+    , m_displayScale(1.0)
+    , m_levelBias(0)
+    , m_generation(0)
+    , m_refining(0)
+{
+    m_previewTimer.setSingleShot(true);
+    m_previewTimer.setInterval(0);
+    connect(&m_previewTimer, &QTimer::timeout, this, &PreviewRenderer::updatePreview);
+
+    m_settleTimer.setSingleShot(true);
+    m_settleTimer.setInterval(kDefaultSettleDelay);
+    connect(&m_settleTimer, &QTimer::timeout, this, &PreviewRenderer::startRefine);
+
+    // 同一时刻只有一个全分辨率渲染，它内部的滤镜照常按条带并行
+    m_pool.setMaxThreadCount(1);
+}
+
+PreviewRenderer::~PreviewRenderer()
+{
+    cancel();
+    m_pool.waitForDone();
+}
+
+void PreviewRenderer::setSource(const QImage &image)
+{
+    cancel();
+    m_levelBias = 0;
+    m_pyramid.setImage(image);
+    scheduleUpdate();
+}
+
+void PreviewRenderer::setDisplayScale(qreal scale)
+{
+    if (scale <= 0 || qFuzzyCompare(scale, m_displayScale)) {
+        return;
+    }
+    const int before = previewLevel();
+    m_displayScale = scale;
+    if (previewLevel() != before) {
+        m_previewTimer.start();
+    }
+}
+
+void PreviewRenderer::setFilterChain(const QVector<FilterParams> &chain)
+{
+    m_chain = chain;
+    scheduleUpdate();
+}
+
+void PreviewRenderer::setFilterParams(const FilterParams &params)
+{
+    setFilterChain(QVector<FilterParams>() << params);
+}
+
+void PreviewRenderer::setSettleDelay(int msec)
+{
+    m_settleTimer.setInterval(qMax(0, msec));
+}
+
+QImage PreviewRenderer::renderFull()
+{
+    cancel();
+    if (!hasSource()) {
+        return QImage();
+    }
+    return applyChain(m_pyramid.source(), m_chain, nullptr, 0);
+}
+
+void PreviewRenderer::cancel()
+{
+    ++m_generation;
+    m_previewTimer.stop();
+    m_settleTimer.stop();
+}
+
+// 显示比例对应的级别，再保证代理图不超过 kMaxPreviewPixels
+int PreviewRenderer::previewLevel() const
+{
+    if (m_pyramid.isEmpty()) {
+        return 0;
+    }
+    const int last = m_pyramid.levelCount() - 1;
+    int level = qBound(0, m_pyramid.levelForScale(m_displayScale) + m_levelBias, last);
+    while (level < last &&
+           qint64(m_pyramid.level(level).width()) * m_pyramid.level(level).height() > kMaxPreviewPixels) {
+        ++level;
+    }
+    return level;
+}
+
+void PreviewRenderer::scheduleUpdate()
+{
+    ++m_generation;
+    m_previewTimer.start();
+    m_settleTimer.start();
+}
+
+void PreviewRenderer::updatePreview()
+{
+    if (!hasSource()) {
+        return;
+    }
+
+    const int level = previewLevel();
+    QElapsedTimer timer;
+    timer.start();
+    QImage preview = applyChain(m_pyramid.level(level), m_chain, nullptr, 0);
+    const qint64 elapsed = timer.elapsed();
+
+    // 按实际耗时调整下次的级别，拖动时保持每帧都能出图
+    if (elapsed > kSlowPreviewMs && level < m_pyramid.levelCount() - 1) {
+        ++m_levelBias;
+    } else if (elapsed < kFastPreviewMs && m_levelBias > 0) {
+        --m_levelBias;
+    }
+
+    if (level == 0) {
+        // 代理就是原图，不用再后台重算
+        m_settleTimer.stop();
+        emit previewReady(preview, 1.0);
+        emit refined(preview);
+        return;
+    }
+    emit previewReady(preview, qreal(preview.width()) / m_pyramid.source().width());
+}
+
+void PreviewRenderer::startRefine()
+{
+    if (!hasSource()) {
+        return;
+    }
+    m_refining.fetch_add(1);
+    m_pool.start(new PreviewRefineTask(this, m_pyramid.source(), m_chain, m_generation.load()));
+}
+
+void PreviewRenderer::deliverRefined(const QImage &image, int generation)
+{
+    // 排队期间参数又变了，丢弃
+    if (generation == m_generation.load()) {
+        emit refined(image);
+    }
+}
+
+// generation 不为空时每一步之前检查是否已作废，作废返回空图
+QImage PreviewRenderer::applyChain(const QImage &image, const QVector<FilterParams> &chain,
+                                   const std::atomic<int> *generation, int expected)
+{
+    QImage result = image;
+    for (const FilterParams &params : chain) {
+        if (generation && generation->load() != expected) {
+            return QImage();
+        }
+        result = ImageEditor::applyFilterWithParams(result, params);
+    }
+    if (generation && generation->load() != expected) {
+        return QImage();
+    }
+    return result;
+}
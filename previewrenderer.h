@@ -0,0 +1,80 @@
+#ifndef PREVIEWRENDERER_H
+#define PREVIEWRENDERER_H
+
+#include "imageeditor.h"
+#include "mippyramid.h"
+#include <QObject>
+#include <QImage>
+#include <QVector>
+#include <QTimer>
+#include <QThreadPool>
+#include <atomic>
+
+// 交互预览
+// 拖动滑块时滤镜链只在缩小的代理图上执行（按当前显示比例从 mip 金字塔里选一级），立即出预览；
+// 停止操作 settleDelay 毫秒后在后台线程按原图分辨率重新渲染，期间参数再变就作废重来。
+// 预览在调用线程（GUI 线程）同步生成，全分辨率结果通过 refined 信号排队送回。
+class PreviewRenderer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit PreviewRenderer(QObject *parent = nullptr);
+    ~PreviewRenderer();
+
+    // 设置原图并重建金字塔；会取消正在进行的全分辨率渲染
+    void setSource(const QImage &image);
+    QImage source() const { return m_pyramid.isEmpty() ? QImage() : m_pyramid.source(); }
+    bool hasSource() const { return !m_pyramid.isEmpty(); }
+
+    // 显示比例：屏幕像素 / 原图像素（视图缩放 × 图元缩放）
+    void setDisplayScale(qreal scale);
+    qreal displayScale() const { return m_displayScale; }
+
+    void setFilterChain(const QVector<FilterParams> &chain);
+    void setFilterParams(const FilterParams &params);
+    QVector<FilterParams> filterChain() const { return m_chain; }
+
+    void setSettleDelay(int msec);
+    int settleDelay() const { return m_settleTimer.interval(); }
+
+    // 立即按当前参数同步渲染全分辨率结果（确认编辑时用）；会取消后台渲染
+    QImage renderFull();
+
+    void cancel();
+    bool isRefining() const { return m_refining.load() > 0; }
+
+    // 代理图所在的金字塔级别（0 为原图）
+    int previewLevel() const;
+
+signals:
+    // scale 为 image 相对原图的缩放比例
+    void previewReady(const QImage &image, qreal scale);
+    void refined(const QImage &image);
+
+private slots:
+    void updatePreview();
+    void startRefine();
+    void deliverRefined(const QImage &image, int generation);
+
+private:
+    friend class PreviewRefineTask;
+
+    void scheduleUpdate();
+    static QImage applyChain(const QImage &image, const QVector<FilterParams> &chain,
+                             const std::atomic<int> *generation, int expected);
+
+    MipPyramid m_pyramid;
+    QVector<FilterParams> m_chain;
+    qreal m_displayScale;
+    int m_levelBias;                    // 预览太慢时再降一级
+
+    QTimer m_previewTimer;              // 合并同一轮事件循环里的多次参数变化
+    QTimer m_settleTimer;
+
+    QThreadPool m_pool;
+    std::atomic<int> m_generation;      // 参数每变一次加一，后台任务据此判断是否作废
+    std::atomic<int> m_refining;
+};
+
+#endif // PREVIEWRENDERER_H
@@ -1,5 +1,6 @@
 import QtQuick 2.15
 import QtQuick.Controls 2.15
+import CustomPicture.Live 1.0
 
 ApplicationWindow {
     visible: true
@@ -15,17 +16,12 @@ ApplicationWindow {
             onClicked: backend.capture()
         }
 
-        Image {
-            id: liveImg
+        // 后端直接推帧，渲染线程原地更新纹理（等比居中）
+        LiveVideoItem {
+            id: liveView
             width: 600
             height: 800
-            fillMode: Image.PreserveAspectFit
-            source: "image://live/0"
-
-            Connections {
-                target: backend
-                function onLiveChanged() { liveImg.source = ""; liveImg.source = "image://live/0"; }
-            }
+            source: backend
         }
     }
 }
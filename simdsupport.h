@@ -0,0 +1,20 @@
+#ifndef SIMDSUPPORT_H
+#define SIMDSUPPORT_H
+
+// 编译期指令集选择，卷积引擎和遮罩共用
+// 按编译器开启的目标特性定义 SIMD_USE_AVX2 / SIMD_USE_SSE2 / SIMD_USE_NEON 并引入对应的内建函数头；
+// 都没有时不定义任何宏，调用方走标量路径
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SIMD_USE_AVX2 1
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SIMD_USE_SSE2 1
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SIMD_USE_NEON 1
+#endif
+
+#endif // SIMDSUPPORT_H
@@ -0,0 +1,535 @@
+#include "tiledexporter.h"
+#include "tilescheduler.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QPainter>
+#include <QtEndian>
+#include <QtMath>
+#include <QDebug>
+#include <memory>
+#include <csetjmp>
+#include <cstdio>
+#include <cstring>
+#include <zlib.h>
+extern "C" {
+#include <jpeglib.h>
+}
+
+namespace {
+
+const int kDefaultBandHeight = 256;
+const int kTiffRowsPerStrip = 64;
+
+// 按扫描行写文件：open 之后按从上到下的顺序送 RGB888 条带，最后 close
+class ScanlineWriter
+{
+public:
+    virtual ~ScanlineWriter() {}
+    virtual bool open(const QString &fileName, const QSize &size, int dpi, int quality) = 0;
+    virtual bool writeRows(const QImage &rgb) = 0;
+    virtual bool close() = 0;
+
+    QString error;
+};
+
+// PNG：IHDR + pHYs + 流式 deflate 的 IDAT + IEND，每行用 Sub 滤波
+class PngWriter : public ScanlineWriter
+{
+public:
+    PngWriter() : streamOpen(false) {}
+
+    ~PngWriter() override
+    {
+        if (streamOpen) {
+            deflateEnd(&stream);
+        }
+    }
+
+    bool open(const QString &fileName, const QSize &size, int dpi, int quality) override
+    {
+        Q_UNUSED(quality);
+        file.setFileName(fileName);
+        if (!file.open(QIODevice::WriteOnly)) {
+            error = file.errorString();
+            return false;
+        }
+        width = size.width();
+
+        static const char signature[] = { '\x89', 'P', 'N', 'G', '\r', '\n', '\x1a', '\n' };
+        file.write(signature, sizeof(signature));
+
+        QByteArray header(13, '\0');
+        qToBigEndian<quint32>(size.width(), header.data());
+        qToBigEndian<quint32>(size.height(), header.data() + 4);
+        header[8] = 8;      // 位深
+        header[9] = 2;      // RGB
+        writeChunk("IHDR", header);
+
+        if (dpi > 0) {
+            const quint32 pixelsPerMeter = quint32(qRound(dpi / 0.0254));
+            QByteArray physical(9, '\0');
+            qToBigEndian<quint32>(pixelsPerMeter, physical.data());
+            qToBigEndian<quint32>(pixelsPerMeter, physical.data() + 4);
+            physical[8] = 1;    // 单位：米
+            writeChunk("pHYs", physical);
+        }
+
+        std::memset(&stream, 0, sizeof(stream));
+        if (deflateInit(&stream, Z_DEFAULT_COMPRESSION) != Z_OK) {
+            error = "zlib 初始化失败";
+            return false;
+        }
+        streamOpen = true;
+        filtered.resize(1 + width * 3);
+        output.resize(256 * 1024);
+        return true;
+    }
+
+    bool writeRows(const QImage &rgb) override
+    {
+        uchar *row = reinterpret_cast<uchar *>(filtered.data());
+        for (int y = 0; y < rgb.height(); ++y) {
+            const uchar *src = rgb.constScanLine(y);
+            row[0] = 1;     // Sub
+            std::memcpy(row + 1, src, 3);
+            for (int i = 3; i < width * 3; ++i) {
+                row[1 + i] = uchar(src[i] - src[i - 3]);
+            }
+            if (!deflateData(row, filtered.size(), Z_NO_FLUSH)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool close() override
+    {
+        if (!deflateData(nullptr, 0, Z_FINISH)) {
+            return false;
+        }
+        deflateEnd(&stream);
+        streamOpen = false;
+        writeChunk("IEND", QByteArray());
+        file.close();
+        if (file.error() != QFileDevice::NoError) {
+            error = file.errorString();
+            return false;
+        }
+        return true;
+    }
+
+private:
+    // 压缩输出攒满一块就写成一个 IDAT
+    bool deflateData(const uchar *data, int size, int flush)
+    {
+        stream.next_in = const_cast<Bytef *>(data);
+        stream.avail_in = uInt(size);
+        int status;
+        do {
+            stream.next_out = reinterpret_cast<Bytef *>(output.data());
+            stream.avail_out = uInt(output.size());
+            status = deflate(&stream, flush);
+            if (status == Z_STREAM_ERROR) {
+                error = "zlib 压缩失败";
+                return false;
+            }
+            const int produced = output.size() - int(stream.avail_out);
+            if (produced > 0) {
+                writeChunk("IDAT", QByteArray::fromRawData(output.constData(), produced));
+            }
+        } while (stream.avail_out == 0 || (flush == Z_FINISH && status != Z_STREAM_END));
+        return true;
+    }
+
+    void writeChunk(const char *type, const QByteArray &data)
+    {
+        uchar length[4];
+        qToBigEndian<quint32>(quint32(data.size()), length);
+        file.write(reinterpret_cast<const char *>(length), 4);
+        file.write(type, 4);
+        file.write(data);
+
+        uLong crc = crc32(0, reinterpret_cast<const Bytef *>(type), 4);
+        crc = crc32(crc, reinterpret_cast<const Bytef *>(data.constData()), uInt(data.size()));
+        uchar crcBytes[4];
+        qToBigEndian<quint32>(quint32(crc), crcBytes);
+        file.write(reinterpret_cast<const char *>(crcBytes), 4);
+    }
+
+    QFile file;
+    int width;
+    z_stream stream;
+    bool streamOpen;
+    QByteArray filtered;
+    QByteArray output;
+};
+
+// libjpeg 默认出错时直接 exit()，改成跳回调用处
+struct JpegErrorManager {
+    jpeg_error_mgr pub;
+    jmp_buf jump;
+    char message[JMSG_LENGTH_MAX];
+};
+
+void jpegErrorExit(j_common_ptr info)
+{
+    JpegErrorManager *manager = reinterpret_cast<JpegErrorManager *>(info->err);
+    (*info->err->format_message)(info, manager->message);
+    longjmp(manager->jump, 1);
+}
+
+class JpegWriter : public ScanlineWriter
+{
+public:
+    JpegWriter() : file(nullptr), started(false)
+    {
+        info.err = jpeg_std_error(&errorManager.pub);
+        errorManager.pub.error_exit = jpegErrorExit;
+        jpeg_create_compress(&info);
+    }
+
+    ~JpegWriter() override
+    {
+        jpeg_destroy_compress(&info);
+        if (file) {
+            fclose(file);
+        }
+    }
+
+    bool open(const QString &fileName, const QSize &size, int dpi, int quality) override
+    {
+        file = fopen(QFile::encodeName(fileName).constData(), "wb");
+        if (!file) {
+            error = QString("无法打开文件: %1").arg(fileName);
+            return false;
+        }
+        if (setjmp(errorManager.jump)) {
+            error = QString::fromLocal8Bit(errorManager.message);
+            return false;
+        }
+
+        jpeg_stdio_dest(&info, file);
+        info.image_width = JDIMENSION(size.width());
+        info.image_height = JDIMENSION(size.height());
+        info.input_components = 3;
+        info.in_color_space = JCS_RGB;
+        jpeg_set_defaults(&info);
+        jpeg_set_quality(&info, qBound(0, quality, 100), TRUE);
+        if (dpi > 0) {
+            info.density_unit = 1;      // 每英寸
+            info.X_density = UINT16(dpi);
+            info.Y_density = UINT16(dpi);
+        }
+        jpeg_start_compress(&info, TRUE);
+        started = true;
+        return true;
+    }
+
+    bool writeRows(const QImage &rgb) override
+    {
+        if (setjmp(errorManager.jump)) {
+            error = QString::fromLocal8Bit(errorManager.message);
+            return false;
+        }
+        for (int y = 0; y < rgb.height(); ++y) {
+            JSAMPROW row = const_cast<JSAMPROW>(rgb.constScanLine(y));
+            jpeg_write_scanlines(&info, &row, 1);
+        }
+        return true;
+    }
+
+    bool close() override
+    {
+        if (setjmp(errorManager.jump)) {
+            error = QString::fromLocal8Bit(errorManager.message);
+            return false;
+        }
+        if (started) {
+            jpeg_finish_compress(&info);
+            started = false;
+        }
+        const bool ok = fclose(file) == 0;
+        file = nullptr;
+        if (!ok) {
+            error = "写入文件失败";
+        }
+        return ok;
+    }
+
+private:
+    jpeg_compress_struct info;
+    JpegErrorManager errorManager;
+    FILE *file;
+    bool started;
+};
+
+// TIFF：未压缩 RGB，小端。尺寸已知，目录和条带偏移全部预先算好写在前面，像素数据按行顺序追加
+class TiffWriter : public ScanlineWriter
+{
+public:
+    bool open(const QString &fileName, const QSize &size, int dpi, int quality) override
+    {
+        Q_UNUSED(quality);
+        width = size.width();
+        const quint64 rowBytes = quint64(width) * 3;
+        const int strips = (size.height() + kTiffRowsPerStrip - 1) / kTiffRowsPerStrip;
+
+        const int entryCount = 13;
+        const quint32 ifdOffset = 8;
+        const quint32 ifdSize = 2 + entryCount * 12 + 4;
+        const quint32 bitsOffset = ifdOffset + ifdSize;             // 3 个 SHORT，补到 8 字节
+        const quint32 xResOffset = bitsOffset + 8;
+        const quint32 yResOffset = xResOffset + 8;
+        const quint32 offsetsOffset = yResOffset + 8;
+        const quint32 countsOffset = offsetsOffset + 4 * strips;
+        const quint32 dataOffset = countsOffset + 4 * strips;
+        if (dataOffset + rowBytes * size.height() > 0xffffffffULL) {
+            error = "TIFF 文件超过 4GB";
+            return false;
+        }
+
+        file.setFileName(fileName);
+        if (!file.open(QIODevice::WriteOnly)) {
+            error = file.errorString();
+            return false;
+        }
+
+        QByteArray header;
+        header.append("II", 2);
+        appendShort(header, 42);
+        appendLong(header, ifdOffset);
+
+        appendShort(header, entryCount);
+        appendEntry(header, 256, 4, 1, quint32(width));                 // ImageWidth
+        appendEntry(header, 257, 4, 1, quint32(size.height()));         // ImageLength
+        appendEntry(header, 258, 3, 3, bitsOffset);                     // BitsPerSample
+        appendEntry(header, 259, 3, 1, 1);                              // Compression: 无
+        appendEntry(header, 262, 3, 1, 2);                              // Photometric: RGB
+        appendEntry(header, 273, 4, strips, strips == 1 ? dataOffset : offsetsOffset);  // StripOffsets
+        appendEntry(header, 277, 3, 1, 3);                              // SamplesPerPixel
+        appendEntry(header, 278, 4, 1, kTiffRowsPerStrip);              // RowsPerStrip
+        appendEntry(header, 279, 4, strips,                             // StripByteCounts
+                    strips == 1 ? quint32(rowBytes * size.height()) : countsOffset);
+        appendEntry(header, 282, 5, 1, xResOffset);                     // XResolution
+        appendEntry(header, 283, 5, 1, yResOffset);                     // YResolution
+        appendEntry(header, 284, 3, 1, 1);                              // PlanarConfiguration
+        appendEntry(header, 296, 3, 1, 2);                              // ResolutionUnit: 英寸
+        appendLong(header, 0);                                          // 没有下一个目录
+
+        appendShort(header, 8);
+        appendShort(header, 8);
+        appendShort(header, 8);
+        appendShort(header, 0);
+        const quint32 resolution = quint32(dpi > 0 ? dpi : 72);
+        appendLong(header, resolution);
+        appendLong(header, 1);
+        appendLong(header, resolution);
+        appendLong(header, 1);
+
+        for (int i = 0; i < strips; ++i) {
+            appendLong(header, quint32(dataOffset + rowBytes * kTiffRowsPerStrip * i));
+        }
+        for (int i = 0; i < strips; ++i) {
+            const int rows = qMin(kTiffRowsPerStrip, size.height() - i * kTiffRowsPerStrip);
+            appendLong(header, quint32(rowBytes * rows));
+        }
+
+        return file.write(header) == header.size();
+    }
+
+    bool writeRows(const QImage &rgb) override
+    {
+        for (int y = 0; y < rgb.height(); ++y) {
+            const qint64 rowBytes = qint64(width) * 3;
+            if (file.write(reinterpret_cast<const char *>(rgb.constScanLine(y)), rowBytes) != rowBytes) {
+                error = file.errorString();
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool close() override
+    {
+        file.close();
+        if (file.error() != QFileDevice::NoError) {
+            error = file.errorString();
+            return false;
+        }
+        return true;
+    }
+
+private:
+    static void appendShort(QByteArray &data, quint16 value)
+    {
+        uchar bytes[2];
+        qToLittleEndian<quint16>(value, bytes);
+        data.append(reinterpret_cast<const char *>(bytes), 2);
+    }
+
+    static void appendLong(QByteArray &data, quint32 value)
+    {
+        uchar bytes[4];
+        qToLittleEndian<quint32>(value, bytes);
+        data.append(reinterpret_cast<const char *>(bytes), 4);
+    }
+
+    // 值能放进 4 字节时 value 直接是值（SHORT 放在低位），否则是偏移
+    static void appendEntry(QByteArray &data, quint16 tag, quint16 type, quint32 count, quint32 value)
+    {
+        appendShort(data, tag);
+        appendShort(data, type);
+        appendLong(data, count);
+        if (type == 3 && count == 1) {
+            appendShort(data, quint16(value));
+            appendShort(data, 0);
+        } else {
+            appendLong(data, value);
+        }
+    }
+
+    QFile file;
+    int width;
+};
+
+} // namespace
+
+TiledExporter::TiledExporter()
+    : m_scale(1.0)
+    , m_dpi(300)
+    , m_background(Qt::white)
+    , m_bandHeight(kDefaultBandHeight)
+    , m_quality(95)
+{
+}
+
+void TiledExporter::addLayer(const QImage &image, const QTransform &transform, qreal opacity)
+{
+    if (image.isNull()) {
+        return;
+    }
+    Layer layer;
+    layer.image = image;
+    layer.transform = transform;
+    layer.opacity = opacity;
+    m_layers.append(layer);
+}
+
+QSize TiledExporter::outputSize() const
+{
+    return (m_sceneRect.size() * m_scale).toSize();
+}
+
+TiledExporter::Format TiledExporter::formatForFile(const QString &fileName, Format fallback)
+{
+    const QString suffix = QFileInfo(fileName).suffix().toLower();
+    if (suffix == "png") {
+        return Png;
+    }
+    if (suffix == "jpg" || suffix == "jpeg") {
+        return Jpeg;
+    }
+    if (suffix == "tif" || suffix == "tiff") {
+        return Tiff;
+    }
+    return fallback;
+}
+
+// 按批渲染：每批同时画 maxThreads 个条带，画完按顺序交给编码器，再画下一批
+bool TiledExporter::exportTo(const QString &fileName, Format format,
+                             const std::function<bool(int, int)> &progress)
+{
+    m_error.clear();
+    const QSize size = outputSize();
+    if (size.isEmpty()) {
+        m_error = "导出范围为空";
+        return false;
+    }
+
+    std::unique_ptr<ScanlineWriter> writer;
+    switch (format) {
+    case Png:
+        writer.reset(new PngWriter);
+        break;
+    case Jpeg:
+        writer.reset(new JpegWriter);
+        break;
+    case Tiff:
+        writer.reset(new TiffWriter);
+        break;
+    }
+    if (!writer->open(fileName, size, m_dpi, m_quality)) {
+        m_error = writer->error;
+        return false;
+    }
+
+    const int bandHeight = qMax(1, m_bandHeight);
+    const int bandCount = (size.height() + bandHeight - 1) / bandHeight;
+    const int batchSize = qMax(1, TileScheduler::maxThreads());
+    QVector<QImage> bands(batchSize);
+    QVector<QImage> rgbBands(batchSize);
+    QImage *bandData = bands.data();
+    QImage *rgbData = rgbBands.data();
+
+    for (int first = 0; first < bandCount; first += batchSize) {
+        const int count = qMin(batchSize, bandCount - first);
+        TileScheduler::parallelFor(count, [&](int i) {
+            const int firstRow = (first + i) * bandHeight;
+            const int rows = qMin(bandHeight, size.height() - firstRow);
+            QImage &band = bandData[i];
+            if (band.width() != size.width() || band.height() != rows) {
+                band = QImage(size.width(), rows, QImage::Format_ARGB32_Premultiplied);
+            }
+            // 条带内部不再分条并行，并行度已经落在条带之间
+            TileScheduler::SerialScope serial;
+            renderBand(band, firstRow);
+            rgbData[i] = band.convertToFormat(QImage::Format_RGB888);
+        });
+
+        for (int i = 0; i < count; ++i) {
+            if (!writer->writeRows(rgbData[i])) {
+                m_error = writer->error;
+                return false;
+            }
+            rgbData[i] = QImage();
+        }
+
+        const int written = qMin(size.height(), (first + count) * bandHeight);
+        if (progress && !progress(written, size.height())) {
+            writer->close();
+            QFile::remove(fileName);
+            m_error = "导出已取消";
+            return false;
+        }
+    }
+
+    if (!writer->close()) {
+        m_error = writer->error;
+        return false;
+    }
+    return true;
+}
+
+void TiledExporter::renderBand(QImage &band, int firstRow) const
+{
+    band.fill(m_background);
+
+    QTransform base;
+    base.translate(0, -firstRow);
+    base.scale(m_scale, m_scale);
+    base.translate(-m_sceneRect.left(), -m_sceneRect.top());
+
+    const QRectF bandRect(0, 0, band.width(), band.height());
+    QPainter painter(&band);
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.setRenderHint(QPainter::SmoothPixmapTransform);
+    for (const Layer &layer : m_layers) {
+        const QTransform transform = layer.transform * base;
+        if (!transform.mapRect(QRectF(layer.image.rect())).intersects(bandRect)) {
+            continue;
+        }
+        painter.setTransform(transform);
+        painter.setOpacity(layer.opacity);
+        painter.drawImage(QPointF(0, 0), layer.image);
+    }
+}
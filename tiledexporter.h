@@ -0,0 +1,64 @@
+#ifndef TILEDEXPORTER_H
+#define TILEDEXPORTER_H
+
+#include <QImage>
+#include <QTransform>
+#include <QColor>
+#include <QRectF>
+#include <QString>
+#include <QVector>
+#include <functional>
+
+// 分带流式导出
+// 把海报按水平条带渲染，渲染好一批就按扫描行交给编码器写盘（PNG 用 zlib、JPEG 用 libjpeg、
+// TIFF 直接写未压缩条带），整张大图从不在内存里出现：
+// 峰值内存约为 并发数 × 条带高度 × 宽度 × 4 字节，与输出尺寸无关。
+// 渲染只读 addLayer() 时交进来的图像快照，不碰 QGraphicsScene，所以条带可以在多个线程里同时画
+class TiledExporter
+{
+public:
+    enum Format { Png, Jpeg, Tiff };
+
+    TiledExporter();
+
+    // 输出范围（场景坐标）和缩放（每场景单位多少输出像素）
+    void setSceneRect(const QRectF &rect) { m_sceneRect = rect; }
+    void setScale(qreal scale) { m_scale = scale; }
+    void setDpi(int dpi) { m_dpi = dpi; }       // 只写入文件的分辨率信息，不影响像素尺寸
+    void setBackground(const QColor &color) { m_background = color; }
+    void setBandHeight(int rows) { m_bandHeight = rows; }
+    void setQuality(int quality) { m_quality = quality; }   // JPEG 质量 (0-100)
+
+    // image 的像素坐标经 transform 映射到场景坐标；按添加顺序从下往上画
+    void addLayer(const QImage &image, const QTransform &transform, qreal opacity = 1.0);
+    void clearLayers() { m_layers.clear(); }
+
+    QSize outputSize() const;
+
+    // 进度回调参数为已写出的行数和总行数，返回 false 中止导出
+    bool exportTo(const QString &fileName, Format format,
+                  const std::function<bool(int, int)> &progress = std::function<bool(int, int)>());
+    QString errorString() const { return m_error; }
+
+    static Format formatForFile(const QString &fileName, Format fallback = Png);
+
+private:
+    struct Layer {
+        QImage image;
+        QTransform transform;
+        qreal opacity;
+    };
+
+    void renderBand(QImage &band, int firstRow) const;
+
+    QRectF m_sceneRect;
+    qreal m_scale;
+    int m_dpi;
+    QColor m_background;
+    int m_bandHeight;
+    int m_quality;
+    QVector<Layer> m_layers;
+    QString m_error;
+};
+
+#endif // TILEDEXPORTER_H
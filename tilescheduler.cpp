@@ -0,0 +1,181 @@
+#include "tilescheduler.h"
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+#include <QVector>
+#include <QWaitCondition>
+#include <atomic>
+
+namespace {
+
+// 一个条带的目标大小：A55 的 L2 较小，条带连同输出一起能留在缓存里
+const int kStripBytes = 128 * 1024;
+const int kMinStripRows = 8;
+
+std::atomic<int> g_maxThreads{0};
+thread_local bool t_inWorker = false;
+
+int defaultThreads()
+{
+    return qMax(1, QThread::idealThreadCount());
+}
+
+QThreadPool *schedulerPool()
+{
+    static QThreadPool *pool = [] {
+        QThreadPool *p = new QThreadPool;
+        p->setMaxThreadCount(qMax(1, defaultThreads() - 1));
+        return p;
+    }();
+    return pool;
+}
+
+struct ParallelJob {
+    const std::function<void(int)> *fn = nullptr;
+    int count = 0;
+    std::atomic<int> next{0};
+
+    QMutex mutex;
+    QWaitCondition finished;
+    int pending = 0;              // 已提交、还没结束（或还没被收回）的辅助任务
+
+    void drain()
+    {
+        int i;
+        while ((i = next.fetch_add(1, std::memory_order_relaxed)) < count) {
+            (*fn)(i);
+        }
+    }
+
+    void helperDone()
+    {
+        QMutexLocker locker(&mutex);
+        if (--pending == 0) {
+            finished.wakeAll();
+        }
+    }
+};
+
+class HelperTask : public QRunnable
+{
+public:
+    explicit HelperTask(ParallelJob *job) : job(job) { setAutoDelete(false); }
+
+    void run() override
+    {
+        t_inWorker = true;
+        job->drain();
+        t_inWorker = false;
+        job->helperDone();
+    }
+
+private:
+    ParallelJob *job;
+};
+
+} // namespace
+
+void TileScheduler::setMaxThreads(int threads)
+{
+    const int n = threads > 0 ? threads : defaultThreads();
+    g_maxThreads.store(n);
+    schedulerPool()->setMaxThreadCount(qMax(1, n - 1));
+}
+
+int TileScheduler::maxThreads()
+{
+    const int n = g_maxThreads.load();
+    return n > 0 ? n : defaultThreads();
+}
+
+void TileScheduler::parallelFor(int count, const std::function<void(int)> &fn)
+{
+    if (count <= 0) {
+        return;
+    }
+
+    const int helpers = qMin(count - 1, maxThreads() - 1);
+    if (helpers <= 0 || t_inWorker) {
+        for (int i = 0; i < count; ++i) {
+            fn(i);
+        }
+        return;
+    }
+
+    ParallelJob job;
+    job.fn = &fn;
+    job.count = count;
+    job.pending = helpers;
+
+    QThreadPool *pool = schedulerPool();
+    QVector<HelperTask *> tasks;
+    tasks.reserve(helpers);
+    for (int i = 0; i < helpers; ++i) {
+        tasks.append(new HelperTask(&job));
+        pool->start(tasks.last());
+    }
+
+    // 调用线程一起干（期间再嵌套调用按串行处理）；干完后把还没轮到线程的任务收回
+    const bool wasInWorker = t_inWorker;
+    t_inWorker = true;
+    job.drain();
+    t_inWorker = wasInWorker;
+    for (HelperTask *task : tasks) {
+        if (pool->tryTake(task)) {
+            job.helperDone();
+        }
+    }
+
+    {
+        QMutexLocker locker(&job.mutex);
+        while (job.pending > 0) {
+            job.finished.wait(&job.mutex);
+        }
+    }
+    qDeleteAll(tasks);
+}
+
+TileScheduler::SerialScope::SerialScope()
+    : previous(t_inWorker)
+{
+    t_inWorker = true;
+}
+
+TileScheduler::SerialScope::~SerialScope()
+{
+    t_inWorker = previous;
+}
+
+int TileScheduler::stripRows(int height, int bytesPerLine, int halo)
+{
+    int rows = kStripBytes / qMax(1, bytesPerLine);
+
+    // 至少切成 线程数 x 2 份，线程之间能互相补位
+    const int parts = maxThreads() * 2;
+    rows = qMin(rows, (height + parts - 1) / parts);
+
+    return qMax(rows, qMax(kMinStripRows, 2 * halo));
+}
+
+void TileScheduler::forEachStrip(int height, int bytesPerLine, int halo,
+                                 const std::function<void(int, int)> &fn)
+{
+    if (height <= 0) {
+        return;
+    }
+
+    const int rows = stripRows(height, bytesPerLine, halo);
+    const int strips = (height + rows - 1) / rows;
+    parallelFor(strips, [&](int i) {
+        const int first = i * rows;
+        fn(first, qMin(height, first + rows));
+    });
+}
+
+void TileScheduler::forEachStrip(const QImage &image, int halo,
+                                 const std::function<void(int, int)> &fn)
+{
+    forEachStrip(image.height(), image.bytesPerLine(), halo, fn);
+}
@@ -0,0 +1,45 @@
+#ifndef TILESCHEDULER_H
+#define TILESCHEDULER_H
+
+#include <QImage>
+#include <functional>
+
+// 图像滤镜的分块并行调度
+// 把图像按行切成适合缓存大小的条带，交给专用线程池执行，调用线程也参与干活；
+// 还没开始的任务在调用线程干完后直接收回，不会排队等线程。
+// 在池里的线程中再次调用（滤镜嵌套）时退化为串行，避免互相等待。
+class TileScheduler
+{
+public:
+    // 全局并发数（包括调用线程）。<= 0 恢复为 CPU 核数；
+    // 摄像头采集占一个核时可以设成 核数 - 1
+    static void setMaxThreads(int threads);
+    static int maxThreads();
+
+    // 对 [0, count) 的每个下标并行执行 fn，返回时全部完成
+    static void parallelFor(int count, const std::function<void(int)> &fn);
+
+    // 按行条带并行执行 fn(firstRow, lastRow)。
+    // halo 为邻域滤镜每侧需要多读的行数，条带高度不会小于它的两倍，避免重复读取占比过高
+    static void forEachStrip(int height, int bytesPerLine, int halo,
+                             const std::function<void(int, int)> &fn);
+    static void forEachStrip(const QImage &image, int halo,
+                             const std::function<void(int, int)> &fn);
+
+    static int stripRows(int height, int bytesPerLine, int halo);
+
+    // 作用域内当前线程上的调度都按串行执行。
+    // 外层已经按任务（例如按图片）并行时使用，避免每个任务再去抢同一批线程
+    class SerialScope
+    {
+    public:
+        SerialScope();
+        ~SerialScope();
+
+    private:
+        Q_DISABLE_COPY(SerialScope)
+        bool previous;
+    };
+};
+
+#endif // TILESCHEDULER_H